@@ -3,7 +3,20 @@
 #include "MainDlg.h"
 
 #include "AboutDlg.h"
+#include "PropertyCompareDlg.h"
+#include "PropertyQueryDlg.h"
+#include "RepeatedSubtreesDlg.h"
+#include "TreeHistoryDlg.h"
+#include "detail_load_scheduler.h"
 #include "flash_area.h"
+#include "metadata_cache.h"
+#include "object_kind.h"
+#include "property_chain.h"
+#include "row_diff.h"
+#include "subtree_shape.h"
+#include "xaml_builder.h"
+
+#define EXTRA_DEBUG 0
 
 namespace {
 
@@ -11,6 +24,60 @@ namespace {
 // Otherwise, multiple redraw operations can make the UI very slow.
 constexpr UINT kRedrawTreeDelay = 200;
 
+// Delay applying filters while the user is typing.
+constexpr UINT kElementFilterDelay = 200;
+constexpr UINT kAttributeFilterDelay = 50;
+
+// Delay between the stages of loading the details of an element selected
+// with the keyboard. Timer messages are only handled when there's no pending
+// input, so a held arrow key doesn't wait for each element to load.
+constexpr UINT kLoadStageDelay = USER_TIMER_MINIMUM;
+
+// The neighbors of the selected tree item are prefetched when idle, starting
+// kPrefetchDelay ms after the selection was loaded.
+constexpr UINT kPrefetchDelay = 100;
+constexpr size_t kPrefetchNeighborCount = 2;
+
+// Pinned properties are sampled every m_watchInterval ms. Each timer tick
+// samples for at most kWatchSampleBudget, the remaining watches are sampled
+// on the next tick, kWatchSliceDelay ms later.
+constexpr UINT kWatchIntervals[] = {100, 500, 2000};
+constexpr auto kWatchSampleBudget = std::chrono::milliseconds(4);
+constexpr UINT kWatchSliceDelay = USER_TIMER_MINIMUM;
+constexpr size_t kWatchSummaryPoints = 32;
+
+// The "History" column, see ResetAttributesListColumns.
+constexpr int kAttributeHistoryColumn = 11;
+
+// How watched properties are read. Common properties are read with their
+// typed accessor, which is much cheaper than fetching the whole property
+// chain.
+enum class WatchAccessor {
+    Chain,
+    ActualWidth,
+    ActualHeight,
+    Opacity,
+    Visibility,
+};
+
+// The property crawler fetches property chains for at most kCrawlSliceBudget
+// per slice, leaving kCrawlSliceDelay ms between slices for the app to render
+// and handle input.
+constexpr auto kCrawlSliceBudget = std::chrono::milliseconds(8);
+constexpr UINT kCrawlSliceDelay = 50;
+
+// Property chains of exported elements are fetched for at most
+// kExportSliceBudget per slice, kExportSliceDelay ms apart. Meanwhile, worker
+// threads format the fetched chains and write them to the file.
+constexpr auto kExportSliceBudget = std::chrono::milliseconds(12);
+constexpr UINT kExportSliceDelay = 20;
+
+// How often the title is updated with the out-of-scope mutation count.
+constexpr UINT kUpdateTitleDelay = 1000;
+
+// Maximum number of entries in the repeated subtrees report.
+constexpr size_t kRepeatedSubtreesMaxResults = 200;
+
 // https://github.com/sumatrapdfreader/sumatrapdf/blob/9a2183db3c3db5cbf242ac9d8f8576750f581096/src/utils/WinUtil.cpp#L2863
 void TreeViewExpandRecursively(HWND hTree, HTREEITEM hItem, DWORD flag) {
     while (hItem) {
@@ -36,157 +103,155 @@ bool IsTreeItemInView(CTreeItem treeItem) {
     return intersectionRect.IntersectRect(rect, clientRect);
 }
 
-// https://stackoverflow.com/a/35277401
-void ListViewSetTopIndex(CListViewCtrl listView, int index) {
-    CSize itemSpacing;
-    listView.GetItemSpacing(itemSpacing, TRUE);
+// Measures the list texts of a combo box with its font, see
+// https://stackoverflow.com/a/41088729. The device context is only acquired
+// for the first measured text, so that no GDI calls are made if all texts are
+// already in a TextWidthCache.
+class ComboTextMeasurer {
+   public:
+    explicit ComboTextMeasurer(CComboBox combo)
+        : m_combo(combo), m_font(combo.GetFont()) {}
+
+    ~ComboTextMeasurer() {
+        if (m_dc) {
+            m_dc.SelectFont(m_oldFont);
+            m_combo.ReleaseDC(m_dc);
+        }
+    }
 
-    CSize scrollsize(0, (index - listView.GetTopIndex()) * itemSpacing.cy);
-    listView.Scroll(scrollsize);
-}
+    ComboTextMeasurer(const ComboTextMeasurer&) = delete;
+    ComboTextMeasurer& operator=(const ComboTextMeasurer&) = delete;
 
-// https://stackoverflow.com/a/41088729
-int GetRequiredComboDroppedWidth(CComboBox rCombo) {
-    CString str;
-    CSize sz;
-    int dx = 0;
-    TEXTMETRIC tm;
-    CDCHandle pDC = rCombo.GetDC();
-    CFontHandle pFont = rCombo.GetFont();
+    TextWidthCache::FontKey FontKey() const {
+        return reinterpret_cast<UINT_PTR>(m_font.m_hFont);
+    }
 
-    // Select the listbox font, save the old font
-    CFontHandle pOldFont = pDC.SelectFont(pFont);
-    // Get the text metrics for avg char width
-    pDC.GetTextMetrics(&tm);
+    int operator()(std::wstring_view text) {
+        if (!m_dc) {
+            m_dc = m_combo.GetDC();
+            m_oldFont = m_dc.SelectFont(m_font);
 
-    for (int i = 0; i < rCombo.GetCount(); i++) {
-        rCombo.GetLBText(i, str);
-        pDC.GetTextExtent(str, -1, &sz);
+            TEXTMETRIC tm;
+            m_dc.GetTextMetrics(&tm);
+            m_aveCharWidth = tm.tmAveCharWidth;
+        }
 
-        // Add the avg width to prevent clipping
-        sz.cx += tm.tmAveCharWidth;
+        CSize sz;
+        m_dc.GetTextExtent(text.data(), static_cast<int>(text.size()), &sz);
 
-        if (sz.cx > dx)
-            dx = sz.cx;
+        // Add the avg width to prevent clipping
+        return sz.cx + m_aveCharWidth;
     }
-    // Select the old font back into the DC
-    pDC.SelectFont(pOldFont);
-    rCombo.ReleaseDC(pDC);
 
+   private:
+    CComboBox m_combo;
+    CFontHandle m_font;
+    CDCHandle m_dc;
+    CFontHandle m_oldFont;
+    int m_aveCharWidth = 0;
+};
+
+int ComboDroppedWidthForText(int textWidth) {
     // Adjust the width for the vertical scroll bar and the left and right
     // border.
-    dx += ::GetSystemMetrics(SM_CXVSCROLL) + 2 * ::GetSystemMetrics(SM_CXEDGE);
-
-    return dx;
+    return textWidth + ::GetSystemMetrics(SM_CXVSCROLL) +
+           2 * ::GetSystemMetrics(SM_CXEDGE);
 }
 
-// Can be carefully used to pass a guid of a different version of an interface,
-// and use the resulting object with functions that are the same in both
-// interface versions.
-template <typename To,
-          typename From,
-          std::enable_if_t<winrt::impl::is_com_interface_v<To>, int> = 0>
-winrt::impl::com_ref<To> try_as_with_guid_unsafe(From* ptr,
-                                                 winrt::guid guid) noexcept {
-    if (!ptr) {
-        return nullptr;
-    }
+template <typename UIElement>
+CRect GetRelativeElementRect(const UIElement& uiElement) {
+    auto offset =
+        uiElement.TransformToVisual(nullptr).TransformPoint(wf::Point(0, 0));
+    auto size = uiElement.ActualSize();
 
-    void* result{};
-    ptr->QueryInterface(guid, &result);
-    return winrt::impl::wrap_as_result<To>(result);
-}
-
-// 1.2.220727.1-experimental1 - 1.2.220909.2-experimental2
-// {A81014CD-55C1-506E-AA79-D9AC96DB9B8E}
-constexpr winrt::guid IID_IDesktopWindowXamlSource_WinUI_1{
-    0xa81014cd,
-    0x55c1,
-    0x506e,
-    {0xaa, 0x79, 0xd9, 0xac, 0x96, 0xdb, 0x9b, 0x8e}};
-
-// 1.3.230202101-experimental1 - 1.4.230518007-experimental1
-// {F2AA238F-1C21-581E-AADC-7D6EC5320F56}
-constexpr winrt::guid IID_IDesktopWindowXamlSource_WinUI_2{
-    0xf2aa238f,
-    0x1c21,
-    0x581e,
-    {0xaa, 0xdc, 0x7d, 0x6e, 0xc5, 0x32, 0x0f, 0x56}};
-
-std::optional<CRect> GetRelativeElementRect(wf::IInspectable element) {
-    std::optional<wf::Point> offset;
-    std::optional<wf::Numerics::float2> size;
-    if (auto uiElement = element.try_as<wux::UIElement>()) {
-        offset = uiElement.TransformToVisual(nullptr).TransformPoint(
-            wf::Point(0, 0));
-        size = uiElement.ActualSize();
-    } else if (auto uiElement = element.try_as<mux::UIElement>()) {
-        offset = uiElement.TransformToVisual(nullptr).TransformPoint(
-            wf::Point(0, 0));
-        size = uiElement.ActualSize();
-    }
-
-    if (offset && size) {
-        CRect rect;
-        rect.left = std::lroundf(offset->X);
-        rect.top = std::lroundf(offset->Y);
-        rect.right = rect.left + std::lroundf(size->x);
-        rect.bottom = rect.top + std::lroundf(size->y);
+    CRect rect;
+    rect.left = std::lroundf(offset.X);
+    rect.top = std::lroundf(offset.Y);
+    rect.right = rect.left + std::lroundf(size.x);
+    rect.bottom = rect.top + std::lroundf(size.y);
 
-        return rect;
+    return rect;
+}
+
+std::optional<CRect> GetRelativeElementRect(const wf::IInspectable& element,
+                                            ObjectKind kind) {
+    if (IsWuxUIElement(kind)) {
+        return GetRelativeElementRect(element.as<wux::UIElement>());
+    } else if (IsMuxUIElement(kind)) {
+        return GetRelativeElementRect(element.as<mux::UIElement>());
     }
 
     return std::nullopt;
 }
 
-std::optional<CRect> GetRootElementRect(wf::IInspectable element,
-                                        HWND* outWnd = nullptr) {
-    std::optional<wf::Rect> bounds;
-    winrt::Windows::UI::Core::CoreWindow coreWindow = nullptr;
-    if (auto window = element.try_as<wux::Window>()) {
-        bounds = window.Bounds();
-        if (outWnd) {
-            coreWindow = window.CoreWindow();
-        }
-    } else if (auto window = element.try_as<mux::Window>()) {
-        bounds = window.Bounds();
-        if (outWnd) {
-            coreWindow = window.CoreWindow();
-        }
-    }
+template <typename Window>
+CRect GetWindowBoundsRect(const Window& window, HWND* outWnd) {
+    auto bounds = window.Bounds();
 
-    if (bounds) {
-        CRect rect;
-        rect.left = std::lroundf(bounds->X);
-        rect.top = std::lroundf(bounds->Y);
-        rect.right = rect.left + std::lroundf(bounds->Width);
-        rect.bottom = rect.top + std::lroundf(bounds->Height);
+    CRect rect;
+    rect.left = std::lroundf(bounds.X);
+    rect.top = std::lroundf(bounds.Y);
+    rect.right = rect.left + std::lroundf(bounds.Width);
+    rect.bottom = rect.top + std::lroundf(bounds.Height);
 
-        if (outWnd && coreWindow) {
+    if (outWnd) {
+        if (auto coreWindow = window.CoreWindow()) {
             if (auto coreInterop = coreWindow.try_as<ICoreWindowInterop>()) {
                 coreInterop->get_WindowHandle(outWnd);
             }
         }
-
-        return rect;
     }
 
+    return rect;
+}
+
+template <typename DesktopWindowXamlSource>
+HWND GetXamlSourceWindow(const DesktopWindowXamlSource& desktopWindowXamlSource) {
+    auto appWindowId = desktopWindowXamlSource.SiteBridge().WindowId();
+    return winrt::Microsoft::UI::GetWindowFromWindowId(appWindowId);
+}
+
+std::optional<CRect> GetRootElementRect(const wf::IInspectable& element,
+                                        ObjectKind kind,
+                                        HWND* outWnd = nullptr) {
     CWindow nativeWnd;
-    if (auto nativeSource = element.try_as<IDesktopWindowXamlSourceNative>()) {
-        nativeSource->get_WindowHandle(&nativeWnd.m_hWnd);
-    } else if (auto desktopWindowXamlSource =
-                   element.try_as<mux::Hosting::DesktopWindowXamlSource>()) {
-        auto appWindowId = desktopWindowXamlSource.SiteBridge().WindowId();
-        nativeWnd = winrt::Microsoft::UI::GetWindowFromWindowId(appWindowId);
-    } else if (auto desktopWindowXamlSource = try_as_with_guid_unsafe<
-                   mux::Hosting::DesktopWindowXamlSource>(
-                   reinterpret_cast<::IInspectable*>(winrt::get_abi(element)),
-                   IID_IDesktopWindowXamlSource_WinUI_2)) {
-        auto appWindowId = desktopWindowXamlSource.SiteBridge().WindowId();
-        nativeWnd = winrt::Microsoft::UI::GetWindowFromWindowId(appWindowId);
-    } else if (auto nativeSource =
-                   element.try_as<IDesktopWindowXamlSourceNative_WinUI>()) {
-        nativeSource->get_WindowHandle(&nativeWnd.m_hWnd);
+    switch (kind) {
+        case ObjectKind::WuxWindow:
+            return GetWindowBoundsRect(element.as<wux::Window>(), outWnd);
+
+        case ObjectKind::MuxWindow:
+            return GetWindowBoundsRect(element.as<mux::Window>(), outWnd);
+
+        case ObjectKind::WuxDesktopWindowXamlSource:
+            if (auto nativeSource =
+                    element.try_as<IDesktopWindowXamlSourceNative>()) {
+                nativeSource->get_WindowHandle(&nativeWnd.m_hWnd);
+            }
+            break;
+
+        case ObjectKind::MuxDesktopWindowXamlSource:
+            nativeWnd = GetXamlSourceWindow(
+                element.as<mux::Hosting::DesktopWindowXamlSource>());
+            break;
+
+        case ObjectKind::MuxDesktopWindowXamlSourceWinUI2:
+            if (auto desktopWindowXamlSource = try_as_with_guid_unsafe<
+                    mux::Hosting::DesktopWindowXamlSource>(
+                    reinterpret_cast<::IInspectable*>(winrt::get_abi(element)),
+                    IID_IDesktopWindowXamlSource_WinUI_2)) {
+                nativeWnd = GetXamlSourceWindow(desktopWindowXamlSource);
+            }
+            break;
+
+        case ObjectKind::MuxDesktopWindowXamlSourceWinUI1:
+            if (auto nativeSource =
+                    element.try_as<IDesktopWindowXamlSourceNative_WinUI>()) {
+                nativeSource->get_WindowHandle(&nativeWnd.m_hWnd);
+            }
+            break;
+
+        default:
+            break;
     }
 
     if (nativeWnd) {
@@ -220,81 +285,191 @@ std::optional<CRect> GetRootElementRect(wf::IInspectable element,
     return std::nullopt;
 }
 
-// https://stackoverflow.com/a/5665377
-std::wstring EscapeXmlAttribute(std::wstring_view data) {
-    std::wstring buffer;
-    buffer.reserve(data.size());
-    for (size_t pos = 0; pos != data.size(); ++pos) {
-        switch (data[pos]) {
-            case '&':
-                buffer.append(L"&amp;");
-                break;
-            case '\"':
-                buffer.append(L"&quot;");
-                break;
-            // case '\'':
-            //     buffer.append(L"&apos;");
-            //     break;
-            case '<':
-                buffer.append(L"&lt;");
-                break;
-            case '>':
-                buffer.append(L"&gt;");
-                break;
-            default:
-                buffer.append(&data[pos], 1);
-                break;
-        }
+std::wstring_view BstrView(BSTR bstr) {
+    return {bstr, bstr ? SysStringLen(bstr) : 0};
+}
+
+// Returns nullptr and sets hr on failure.
+std::shared_ptr<const PropertyChain> LoadPropertyChain(
+    IVisualTreeService3* visualTreeService,
+    InstanceHandle handle,
+    HRESULT* hr) {
+    unsigned int sourceCount = 0;
+    PropertyChainSource* pPropertySources = nullptr;
+    unsigned int propertyCount = 0;
+    PropertyChainValue* pPropertyValues = nullptr;
+    *hr = visualTreeService->GetPropertyValuesChain(
+        handle, &sourceCount, &pPropertySources, &propertyCount,
+        &pPropertyValues);
+    if (FAILED(*hr)) {
+        return nullptr;
     }
 
-    return buffer;
+    size_t textLength = 0;
+    for (unsigned int i = 0; i < sourceCount; i++) {
+        const auto& src = pPropertySources[i];
+        textLength += BstrView(src.TargetType).size() +
+                      BstrView(src.Name).size() + 2;
+    }
+
+    for (unsigned int i = 0; i < propertyCount; i++) {
+        const auto& v = pPropertyValues[i];
+        textLength += BstrView(v.Type).size() +
+                      BstrView(v.DeclaringType).size() +
+                      BstrView(v.ValueType).size() +
+                      BstrView(v.ItemType).size() + BstrView(v.Value).size() +
+                      BstrView(v.PropertyName).size() + 6;
+    }
+
+    auto chain = std::make_shared<PropertyChain>();
+    chain->Reserve(sourceCount, propertyCount, textLength);
+
+    for (unsigned int i = 0; i < sourceCount; i++) {
+        const auto& src = pPropertySources[i];
+        chain->AddSource({
+            .handle = src.Handle,
+            .targetType = chain->AddText(BstrView(src.TargetType)),
+            .name = chain->AddText(BstrView(src.Name)),
+            .source = src.Source,
+        });
+    }
+
+    for (unsigned int i = 0; i < propertyCount; i++) {
+        const auto& v = pPropertyValues[i];
+        chain->AddValue({
+            .index = v.Index,
+            .sourceIndex = v.PropertyChainIndex,
+            .type = chain->AddText(BstrView(v.Type)),
+            .declaringType = chain->AddText(BstrView(v.DeclaringType)),
+            .valueType = chain->AddText(BstrView(v.ValueType)),
+            .itemType = chain->AddText(BstrView(v.ItemType)),
+            .value = chain->AddText(BstrView(v.Value)),
+            .propertyName = chain->AddText(BstrView(v.PropertyName)),
+            .metadataBits = v.MetadataBits,
+            .overridden = !!v.Overridden,
+        });
+    }
+
+    // Not documented, but it makes sense that the arrays have to be
+    // freed and this seems to be working.
+    CoTaskMemFree(pPropertySources);
+    CoTaskMemFree(pPropertyValues);
+
+    return chain;
+}
+
+std::wstring MetadataBitsToString(hyper metadataBits) {
+    std::wstring str;
+
+#define APPEND_BIT_TO_STR(x)   \
+    if (metadataBits & x) {    \
+        str += TEXT(#x) L", "; \
+        metadataBits &= ~x;    \
+    }
+
+    APPEND_BIT_TO_STR(IsValueHandle);
+    APPEND_BIT_TO_STR(IsPropertyReadOnly);
+    APPEND_BIT_TO_STR(IsValueCollection);
+    APPEND_BIT_TO_STR(IsValueCollectionReadOnly);
+    APPEND_BIT_TO_STR(IsValueBindingExpression);
+    APPEND_BIT_TO_STR(IsValueNull);
+    APPEND_BIT_TO_STR(IsValueHandleAndEvaluatedValue);
+
+#undef APPEND_BIT_TO_STR
+
+    if (metadataBits) {
+        str += std::to_wstring(metadataBits) + L", ";
+    }
+
+    if (!str.empty()) {
+        str.resize(str.length() - 2);
+    }
+
+    return str;
+}
+
+std::wstring BaseValueSourceToString(BaseValueSource source) {
+    std::wstring str;
+
+#define CASE_TO_STR(x)  \
+    case x:             \
+        str = TEXT(#x); \
+        break;
+
+    switch (source) {
+        CASE_TO_STR(BaseValueSourceUnknown);
+        CASE_TO_STR(BaseValueSourceDefault);
+        CASE_TO_STR(BaseValueSourceBuiltInStyle);
+        CASE_TO_STR(BaseValueSourceStyle);
+        CASE_TO_STR(BaseValueSourceLocal);
+        CASE_TO_STR(Inherited);
+        CASE_TO_STR(DefaultStyleTrigger);
+        CASE_TO_STR(TemplateTrigger);
+        CASE_TO_STR(StyleTrigger);
+        CASE_TO_STR(ImplicitStyleReference);
+        CASE_TO_STR(ParentTemplate);
+        CASE_TO_STR(ParentTemplateTrigger);
+        CASE_TO_STR(Animation);
+        CASE_TO_STR(Coercion);
+        CASE_TO_STR(BaseValueSourceVisualState);
+        default:
+            str = std::to_wstring(source);
+            break;
+    }
+
+#undef CASE_TO_STR
+
+    return str;
 }
 
-std::wstring GetResourceDictionaryXamlFromXamlSetters(
-    const std::wstring_view type,
-    const std::wstring_view xamlStyleSetters) {
-    std::wstring xaml =
+// A resource dictionary with a style which has a single setter, to let the
+// XAML parser create the setter value.
+std::wstring GetResourceDictionaryXamlForSetter(std::wstring_view type,
+                                                std::wstring_view property,
+                                                std::wstring_view valueXaml) {
+    XamlBuilder builder;
+    builder.Text(
         LR"(<ResourceDictionary
     xmlns="http://schemas.microsoft.com/winfx/2006/xaml/presentation"
     xmlns:x="http://schemas.microsoft.com/winfx/2006/xaml"
     xmlns:d="http://schemas.microsoft.com/expression/blend/2008"
     xmlns:mc="http://schemas.openxmlformats.org/markup-compatibility/2006"
-    xmlns:muxc="using:Microsoft.UI.Xaml.Controls")";
+    xmlns:muxc="using:Microsoft.UI.Xaml.Controls")");
 
     if (auto pos = type.rfind('.'); pos != type.npos) {
-        auto typeNamespace = std::wstring_view(type).substr(0, pos);
-        auto typeName = std::wstring_view(type).substr(pos + 1);
-
-        xaml += L"\n    xmlns:uwpspy=\"using:";
-        xaml += EscapeXmlAttribute(typeNamespace);
-        xaml +=
-            L"\">\n"
-            L"    <Style TargetType=\"uwpspy:";
-        xaml += EscapeXmlAttribute(typeName);
-        xaml += L"\">\n";
+        builder.Text(L"\n    xmlns:uwpspy=\"using:")
+            .Attribute(type.substr(0, pos))
+            .Text(
+                L"\">\n"
+                L"    <Style TargetType=\"uwpspy:")
+            .Attribute(type.substr(pos + 1))
+            .Text(L"\">\n");
     } else {
-        xaml +=
-            L">\n"
-            L"    <Style TargetType=\"";
-        xaml += EscapeXmlAttribute(type);
-        xaml += L"\">\n";
+        builder
+            .Text(
+                L">\n"
+                L"    <Style TargetType=\"")
+            .Attribute(type)
+            .Text(L"\">\n");
     }
 
-    xaml += xamlStyleSetters;
-
-    xaml +=
-        L"    </Style>\n"
-        L"</ResourceDictionary>";
-
-    return xaml;
+    builder.Text(L"        <Setter Property=\"")
+        .Attribute(property)
+        .Text(
+            L"\">\n"
+            L"            <Setter.Value>\n")
+        .Text(valueXaml)
+        .Text(
+            L"\n"
+            L"            </Setter.Value>\n"
+            L"        </Setter>\n"
+            L"    </Style>\n"
+            L"</ResourceDictionary>");
+
+    return builder.Build();
 }
 
-wux::Style GetStyleFromXamlSettersWux(
-    const std::wstring_view type,
-    const std::wstring_view xamlStyleSetters) {
-    std::wstring xaml =
-        GetResourceDictionaryXamlFromXamlSetters(type, xamlStyleSetters);
-
+wux::Style GetStyleFromXamlWux(std::wstring_view xaml) {
     auto resourceDictionary =
         wux::Markup::XamlReader::Load(xaml).as<wux::ResourceDictionary>();
 
@@ -302,12 +477,7 @@ wux::Style GetStyleFromXamlSettersWux(
     return styleInspectable.as<wux::Style>();
 }
 
-mux::Style GetStyleFromXamlSettersMux(
-    const std::wstring_view type,
-    const std::wstring_view xamlStyleSetters) {
-    std::wstring xaml =
-        GetResourceDictionaryXamlFromXamlSetters(type, xamlStyleSetters);
-
+mux::Style GetStyleFromXamlMux(std::wstring_view xaml) {
     auto resourceDictionary =
         mux::Markup::XamlReader::Load(xaml).as<mux::ResourceDictionary>();
 
@@ -315,36 +485,167 @@ mux::Style GetStyleFromXamlSettersMux(
     return styleInspectable.as<mux::Style>();
 }
 
-wf::IInspectable StyleValueFromXaml(wf::IInspectable element,
+wf::IInspectable StyleValueFromXaml(ObjectKind kind,
+                                    const std::wstring_view className,
                                     const std::wstring_view name,
                                     const std::wstring_view value) {
-    std::wstring xaml;
-
-    xaml += L"        <Setter Property=\"";
-    xaml += EscapeXmlAttribute(name);
-    xaml += L"\"";
-    xaml +=
-        L">\n"
-        L"            <Setter.Value>\n";
-    xaml += value;
-    xaml +=
-        L"\n"
-        L"            </Setter.Value>\n"
-        L"        </Setter>\n";
-
-    auto className = winrt::get_class_name(element);
-
-    if (auto uiElement = element.try_as<wux::UIElement>()) {
-        auto style = GetStyleFromXamlSettersWux(className, xaml);
+    if (IsWuxUIElement(kind)) {
+        auto style = GetStyleFromXamlWux(
+            GetResourceDictionaryXamlForSetter(className, name, value));
         return style.Setters().GetAt(0).as<wux::Setter>().Value();
-    } else if (auto uiElement = element.try_as<mux::UIElement>()) {
-        auto style = GetStyleFromXamlSettersMux(className, xaml);
+    } else if (IsMuxUIElement(kind)) {
+        auto style = GetStyleFromXamlMux(
+            GetResourceDictionaryXamlForSetter(className, name, value));
         return style.Setters().GetAt(0).as<mux::Setter>().Value();
     }
 
     winrt::throw_hresult(E_NOTIMPL);
 }
 
+// Whether a value parsed from XAML can be set on several elements. Most
+// objects can only have one owner, e.g. elements, transforms, geometries and
+// projections. Brushes, templates and styles are commonly shared as
+// resources, and boxed values are immutable.
+bool IsShareableXamlValue(const wf::IInspectable& value) {
+    return value.try_as<wf::IPropertyValue>() ||
+           value.try_as<wux::Media::Brush>() ||
+           value.try_as<wux::FrameworkTemplate>() ||
+           value.try_as<wux::Style>() || value.try_as<mux::Media::Brush>() ||
+           value.try_as<mux::FrameworkTemplate>() ||
+           value.try_as<mux::Style>();
+}
+
+WatchAccessor WatchAccessorForProperty(std::wstring_view propertyName,
+                                       ObjectKind kind) {
+    bool frameworkElement = kind == ObjectKind::WuxFrameworkElement ||
+                            kind == ObjectKind::MuxFrameworkElement;
+    bool uiElement = frameworkElement || IsWuxUIElement(kind) ||
+                     IsMuxUIElement(kind);
+
+    if (frameworkElement && propertyName == L"ActualWidth") {
+        return WatchAccessor::ActualWidth;
+    }
+
+    if (frameworkElement && propertyName == L"ActualHeight") {
+        return WatchAccessor::ActualHeight;
+    }
+
+    if (uiElement && propertyName == L"Opacity") {
+        return WatchAccessor::Opacity;
+    }
+
+    if (uiElement && propertyName == L"Visibility") {
+        return WatchAccessor::Visibility;
+    }
+
+    return WatchAccessor::Chain;
+}
+
+template <typename UIElement, typename FrameworkElement>
+std::wstring ReadTypedProperty(const wf::IInspectable& object,
+                               WatchAccessor accessor) {
+    switch (accessor) {
+        case WatchAccessor::ActualWidth:
+            return std::format(L"{}",
+                               object.as<FrameworkElement>().ActualWidth());
+
+        case WatchAccessor::ActualHeight:
+            return std::format(L"{}",
+                               object.as<FrameworkElement>().ActualHeight());
+
+        case WatchAccessor::Opacity:
+            return std::format(L"{}", object.as<UIElement>().Opacity());
+
+        case WatchAccessor::Visibility: {
+            auto visibility = object.as<UIElement>().Visibility();
+            return visibility == decltype(visibility)::Visible ? L"Visible"
+                                                               : L"Collapsed";
+        }
+
+        case WatchAccessor::Chain:
+            break;
+    }
+
+    throw winrt::hresult_invalid_argument();
+}
+
+// Identifies the app and the XAML frameworks it uses by their paths,
+// modification times, sizes and file versions. The modification time alone
+// isn't enough, e.g. package deployment can preserve it across versions.
+std::wstring GetMetadataCacheKey() {
+    std::wstring key;
+
+    auto appendModule = [&key](HMODULE module) {
+        WCHAR path[MAX_PATH];
+        switch (GetModuleFileName(module, path, ARRAYSIZE(path))) {
+            case 0:
+            case ARRAYSIZE(path):
+                return;
+        }
+
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesEx(path, GetFileExInfoStandard, &data)) {
+            return;
+        }
+
+        std::uint64_t fileSize =
+            (std::uint64_t{data.nFileSizeHigh} << 32) | data.nFileSizeLow;
+
+        std::wstring version;
+        DWORD versionInfoSize = GetFileVersionInfoSize(path, nullptr);
+        if (versionInfoSize) {
+            std::vector<BYTE> versionInfo(versionInfoSize);
+            VS_FIXEDFILEINFO* fixedFileInfo;
+            UINT fixedFileInfoSize;
+            if (GetFileVersionInfo(path, 0, versionInfoSize,
+                                   versionInfo.data()) &&
+                VerQueryValue(versionInfo.data(), L"\\",
+                              reinterpret_cast<void**>(&fixedFileInfo),
+                              &fixedFileInfoSize) &&
+                fixedFileInfoSize >= sizeof(VS_FIXEDFILEINFO)) {
+                version = std::format(
+                    L"{}.{}.{}.{}", HIWORD(fixedFileInfo->dwFileVersionMS),
+                    LOWORD(fixedFileInfo->dwFileVersionMS),
+                    HIWORD(fixedFileInfo->dwFileVersionLS),
+                    LOWORD(fixedFileInfo->dwFileVersionLS));
+            }
+        }
+
+        key += std::format(L"{}|{:08X}{:08X}|{}|{}\n", path,
+                           data.ftLastWriteTime.dwHighDateTime,
+                           data.ftLastWriteTime.dwLowDateTime,
+                           fileSize, version);
+    };
+
+    appendModule(nullptr);
+
+    for (PCWSTR framework :
+         {L"Windows.UI.Xaml.dll", L"Microsoft.UI.Xaml.dll"}) {
+        if (HMODULE module = GetModuleHandle(framework)) {
+            appendModule(module);
+        }
+    }
+
+    return key;
+}
+
+// A file per key, next to UWPSpy.dll.
+std::wstring GetMetadataCachePath(std::wstring_view key) {
+    WCHAR location[MAX_PATH];
+    switch (GetModuleFileName(_Module.GetModuleInstance(), location,
+                              ARRAYSIZE(location))) {
+        case 0:
+        case ARRAYSIZE(location):
+            return std::wstring();
+    }
+
+    std::wstring_view dllPath = location;
+    auto directory = dllPath.substr(0, dllPath.find_last_of(L'\\') + 1);
+
+    return std::format(L"{}UWPSpy-metadata-{:016X}.bin", directory,
+                       MetadataCache::Hash(key));
+}
+
 }  // namespace
 
 CMainDlg::CMainDlg(winrt::com_ptr<IXamlDiagnostics> diagnostics,
@@ -352,7 +653,10 @@ CMainDlg::CMainDlg(winrt::com_ptr<IXamlDiagnostics> diagnostics,
     : m_elementTree(this, 1),
       m_visualTreeService(diagnostics.as<IVisualTreeService3>()),
       m_xamlDiagnostics(std::move(diagnostics)),
-      m_eventCallback(std::move(eventCallback)) {}
+      m_eventCallback(std::move(eventCallback)) {
+    // Before any element is added, so that their types are looked up in it.
+    LoadMetadataCache();
+}
 
 void CMainDlg::Hide() {
     ShowWindow(SW_HIDE);
@@ -400,6 +704,9 @@ void CMainDlg::ElementAdded(const ParentChildRelation& parentChildRelation,
         .parentHandle = parentChildRelation.Parent,
         .itemTitle = itemTitle,
         .treeItem = nullptr,
+        .typeHash = SubtreeShape::TypeHash(elementType),
+        .shapeHash = 0,
+        .subtreeSize = 0,
     };
 
     auto [itElementItem, inserted] =
@@ -407,13 +714,42 @@ void CMainDlg::ElementAdded(const ParentChildRelation& parentChildRelation,
     if (!inserted) {
         // Element already exists, I'm not sure what that means but let's remove
         // the existing element from the tree and hope that it works.
+        // The scope is kept if it's the element, which is added right back.
+        bool scoped = element.Handle == m_scopeHandle;
+        if (scoped) {
+            m_scopeHandle = 0;
+        }
+
         ElementRemoved(element.Handle);
+
+        if (scoped) {
+            m_scopeHandle = element.Handle;
+        }
+
         const auto [itElementItem2, inserted2] =
             m_elementItems.try_emplace(element.Handle, std::move(elementItem));
         ATLASSERT(inserted2);
         itElementItem = itElementItem2;
     }
 
+    // The following is kept for the whole tree, not only for the scope, so
+    // that changing or clearing the scope rebuilds the tree view without
+    // querying the app: the element maps, the ancestor index, the tree
+    // history, the crawled properties and the subtree shapes. Each update is
+    // amortized O(1) for a new leaf. Attaching elements which were added
+    // before their parent is linear in their number. Only the tree view work
+    // below is skipped for elements outside of the scope.
+    m_ancestorIndex.Insert(element.Handle, parentChildRelation.Parent);
+    if (m_crawlProperties) {
+        m_propertyCrawler.Add(element.Handle);
+        ScheduleCrawl();
+    }
+    m_treeHistory.RecordAdd(GetTickCount64(), element.Handle,
+                            parentChildRelation.Parent,
+                            parentChildRelation.ChildIndex,
+                            itElementItem->second.itemTitle);
+    InvalidateSubtreeShape(parentChildRelation.Parent);
+
     HTREEITEM parentItem = nullptr;
     HTREEITEM insertAfter = TVI_LAST;
 
@@ -444,14 +780,33 @@ void CMainDlg::ElementAdded(const ParentChildRelation& parentChildRelation,
             // ATLASSERT(FALSE);
             children.push_back(element.Handle);
         }
+    } else {
+        m_parentToChildren[0].push_back(element.Handle);
+    }
 
-        auto it = m_elementItems.find(parentChildRelation.Parent);
-        if (it == m_elementItems.end()) {
-            return;
+    // With a filter, the scope test is an O(log n) ancestor index query.
+    if (!m_elementFilter.IsEmpty()) {
+        AddFilteredElementToTree(element.Handle, itElementItem->second);
+        return;
+    }
+
+    // Otherwise, only elements with a parent in the tree view are in scope,
+    // which makes the scope test a single lookup.
+    if (element.Handle != m_scopeHandle) {
+        if (parentChildRelation.Parent) {
+            auto it = m_elementItems.find(parentChildRelation.Parent);
+            if (it == m_elementItems.end()) {
+                return;
+            }
+
+            parentItem = it->second.treeItem;
         }
 
-        parentItem = it->second.treeItem;
-        if (!parentItem) {
+        if (!parentItem && (parentChildRelation.Parent || m_scopeHandle)) {
+            if (m_scopeHandle) {
+                m_outOfScopeMutationCount++;
+            }
+
             return;
         }
     }
@@ -503,8 +858,12 @@ void CMainDlg::ElementRemoved(InstanceHandle handle) {
         };
 
         clearTreeItemRecursive(handle, &it->second);
+    } else if (m_scopeHandle) {
+        m_outOfScopeMutationCount++;
     }
 
+    InvalidateSubtreeShape(it->second.parentHandle);
+
     auto itChildrenOfParent = m_parentToChildren.find(it->second.parentHandle);
     if (itChildrenOfParent != m_parentToChildren.end()) {
         auto& children = itChildrenOfParent->second;
@@ -512,7 +871,34 @@ void CMainDlg::ElementRemoved(InstanceHandle handle) {
                        children.end());
     }
 
+    m_ancestorIndex.Remove(handle);
+    m_treeHistory.RecordRemove(GetTickCount64(), handle);
+    m_propertyChainCache.Invalidate(handle);
+    m_handleCache.Invalidate(handle);
+    m_propertyWatch.UnpinElement(handle);
+    // Edits of a removed element can't be undone, and would make the steps
+    // they're in fail.
+    m_editJournal.RemoveElement(handle);
+    m_propertyCrawler.Remove(handle);
+    m_propertyStore.Erase(handle);
+    m_elementFilterVisibleHandles.erase(handle);
     m_elementItems.erase(it);
+
+    if (handle == m_scopeHandle) {
+        SetScope(0);
+    }
+}
+
+void CMainDlg::ElementStateChanged(InstanceHandle handle) {
+    InvalidatePropertyChains(handle);
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (selectedItem &&
+        m_ancestorIndex.IsAncestor(
+            handle, static_cast<InstanceHandle>(selectedItem.GetData()))) {
+        RefreshSelectedElementInformation();
+    }
 }
 
 BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
@@ -533,9 +919,7 @@ BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
     DlgResize_Init();
 
     // Init UI elements.
-    SetWindowText(std::format(L"UWPSpy - PID: {} TID: {}",
-                              GetCurrentProcessId(), GetCurrentThreadId())
-                      .c_str());
+    UpdateTitle();
 
     auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
     m_elementTree.SubclassWindow(treeView);
@@ -551,6 +935,20 @@ BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
                       reinterpret_cast<POINT*>(&detailsTabsRect),
                       sizeof(RECT) / sizeof(POINT));
 
+    auto elementFilterEdit = CEdit(GetDlgItem(IDC_ELEMENT_FILTER));
+    elementFilterEdit.SetCueBannerText(L"Filter elements (^ for prefix)");
+
+    auto attributeFilterEdit = CEdit(GetDlgItem(IDC_ATTRIBUTE_FILTER));
+    attributeFilterEdit.SetCueBannerText(L"Filter attributes (^ for prefix)");
+    CRect attributeFilterRect;
+    attributeFilterEdit.GetWindowRect(&attributeFilterRect);
+    ::MapWindowPoints(nullptr, m_hWnd,
+                      reinterpret_cast<POINT*>(&attributeFilterRect),
+                      sizeof(RECT) / sizeof(POINT));
+    attributeFilterRect.MoveToY(detailsTabsRect.bottom);
+    attributeFilterEdit.SetWindowPos(nullptr, &attributeFilterRect,
+                                     SWP_NOZORDER | SWP_NOACTIVATE);
+
     auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
     attributesList.SetExtendedListViewStyle(
         LVS_EX_FULLROWSELECT | LVS_EX_LABELTIP | LVS_EX_DOUBLEBUFFER);
@@ -561,7 +959,8 @@ BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
     ::MapWindowPoints(nullptr, m_hWnd,
                       reinterpret_cast<POINT*>(&attributesListRect),
                       sizeof(RECT) / sizeof(POINT));
-    attributesListRect.top = detailsTabsRect.bottom;
+    RECT visualStatesTreeRect = attributesListRect;
+    attributesListRect.top = attributeFilterRect.bottom;
     // Height will be adjusted automatically.
     attributesListRect.bottom = attributesListRect.top;
     attributesList.SetWindowPos(nullptr, &attributesListRect,
@@ -570,7 +969,10 @@ BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
     auto visualStatesTree = CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
     visualStatesTree.SetExtendedStyle(TVS_EX_DOUBLEBUFFER, TVS_EX_DOUBLEBUFFER);
     ::SetWindowTheme(visualStatesTree, L"Explorer", nullptr);
-    visualStatesTree.SetWindowPos(nullptr, &attributesListRect,
+    visualStatesTreeRect.top = detailsTabsRect.bottom;
+    // Height will be adjusted automatically.
+    visualStatesTreeRect.bottom = visualStatesTreeRect.top;
+    visualStatesTree.SetWindowPos(nullptr, &visualStatesTreeRect,
                                   SWP_NOZORDER | SWP_NOACTIVATE);
 
     CButton(GetDlgItem(IDC_HIGHLIGHT_SELECTION))
@@ -582,7 +984,64 @@ BOOL CMainDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
     return TRUE;
 }
 
-void CMainDlg::OnDestroy() {}
+void CMainDlg::OnDestroy() {
+#if EXTRA_DEBUG
+    auto stats = std::format(
+        L"Handle cache: {} hits, {} misses\n"
+        L"Object kind cache: {} hits, {} misses\n"
+        L"Property chain cache: {} hits, {} misses, {} bytes\n"
+        L"Property schema cache: {} hits, {} misses\n"
+        L"Text width cache: {} hits, {} misses\n"
+        L"Value instance cache: {} hits, {} misses, {} entries, {} bytes\n"
+        L"XAML value cache: {} hits, {} parses in {:.1f} ms, {} entries, "
+        L"{} bytes\n",
+        m_handleCache.Hits(), m_handleCache.Misses(),
+        m_objectKindCache.Hits(), m_objectKindCache.Misses(),
+        m_propertyChainCache.Hits(), m_propertyChainCache.Misses(),
+        m_propertyChainCache.MemoryUsage(),
+        m_propertySchemaCache.Hits(), m_propertySchemaCache.Misses(),
+        m_textWidthCache.Hits(), m_textWidthCache.Misses(),
+        m_valueInstanceCache.Hits(), m_valueInstanceCache.Misses(),
+        m_valueInstanceCache.Size(), m_valueInstanceCache.MemoryUsage(),
+        m_xamlValueCache.Hits(), m_xamlValueCache.Parses(),
+        std::chrono::duration<double, std::milli>(
+            m_xamlValueCache.ParseTime())
+            .count(),
+        m_xamlValueCache.Size(), m_xamlValueCache.MemoryUsage());
+    OutputDebugString(stats.c_str());
+
+    auto metadataStats = std::format(
+        L"Metadata cache: {} object kinds loaded in {:.2f} ms, {} hits, "
+        L"{} misses, {} stale, {:.2f} ms probing object kinds, {} probes "
+        L"saved\n",
+        m_metadataCache.LoadedObjectKinds(),
+        std::chrono::duration<double, std::milli>(m_metadataCacheLoadTime)
+            .count(),
+        m_metadataCache.Hits(), m_metadataCache.Misses(),
+        m_metadataCache.StaleEntries(),
+        std::chrono::duration<double, std::milli>(m_objectKindProbeTime)
+            .count(),
+        m_objectKindProbesSaved);
+    OutputDebugString(metadataStats.c_str());
+
+    // The memory per minute of recorded tree changes, which determines how
+    // far back the history reaches within its limit.
+    if (auto oldestTime = m_treeHistory.OldestTime()) {
+        double minutes = (GetTickCount64() - *oldestTime) / 60000.0;
+        auto treeHistoryStats = std::format(
+            L"Tree history: {} bytes covering {:.1f} minutes, {:.0f} bytes "
+            L"per minute\n",
+            m_treeHistory.MemoryUsage(), minutes,
+            minutes > 0 ? m_treeHistory.MemoryUsage() / minutes : 0.0);
+        OutputDebugString(treeHistoryStats.c_str());
+    }
+#endif  // EXTRA_DEBUG
+
+    SaveMetadataCache();
+
+    // An unfinished export would be missing elements, so it's discarded.
+    FinishPropertyExport(/*cancel=*/true);
+}
 
 void CMainDlg::OnFinalMessage(HWND hWnd) {
     if (m_eventCallback) {
@@ -620,10 +1079,45 @@ void CMainDlg::OnTimer(UINT_PTR nIDEvent) {
             KillTimer(nIDEvent);
             RefreshSelectedElementInformation(0);
             break;
+
+        case TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS:
+            RunDetailLoadTask();
+            break;
+
+        case TIMER_ID_SAMPLE_WATCHES:
+            SampleWatches();
+            break;
+
+        case TIMER_ID_CRAWL_PROPERTIES:
+            CrawlProperties();
+            break;
+
+        case TIMER_ID_EXPORT_PROPERTIES:
+            ExportPropertiesSlice();
+            break;
+
+        case TIMER_ID_UPDATE_TITLE:
+            UpdateTitle();
+            break;
+
+        case TIMER_ID_APPLY_ELEMENT_FILTER:
+            KillTimer(nIDEvent);
+            ApplyElementFilter();
+            break;
+
+        case TIMER_ID_APPLY_ATTRIBUTE_FILTER:
+            KillTimer(nIDEvent);
+            ApplyAttributeFilter();
+            break;
     }
 }
 
 void CMainDlg::OnContextMenu(CWindow wnd, CPoint point) {
+    if (wnd == GetDlgItem(IDC_ATTRIBUTE_LIST)) {
+        OnAttributeListContextMenu(point);
+        return;
+    }
+
     auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
     if (wnd != treeView) {
         return;
@@ -662,31 +1156,99 @@ void CMainDlg::OnContextMenu(CWindow wnd, CPoint point) {
 
     enum {
         MENU_ID_VISIBLE = 1,
+        MENU_ID_REPEATED_SUBTREES,
+        MENU_ID_TREE_HISTORY,
+        MENU_ID_SCOPE_TO_SUBTREE,
+        MENU_ID_CLEAR_SCOPE,
+        MENU_ID_CRAWL_PROPERTIES,
+        MENU_ID_QUERY_PROPERTIES,
+        MENU_ID_COMPARE_PROPERTIES,
+        MENU_ID_EXPORT_PROPERTIES,
+        MENU_ID_SET_PROPERTY_IN_SUBTREE,
+        MENU_ID_UNDO_EDIT,
+        MENU_ID_REDO_EDIT,
+        MENU_ID_REVERT_EDITS,
     };
 
     auto handle = static_cast<InstanceHandle>(targetItem.GetData());
 
+    CTreeItem selectedItem = treeView.GetSelectedItem();
+    auto selectedHandle =
+        selectedItem ? static_cast<InstanceHandle>(selectedItem.GetData()) : 0;
+    bool canCompareProperties = selectedHandle && selectedHandle != handle;
+
+    // The property set with the value editor, see SetPropertyInSubtree.
+    bool canSetPropertyInSubtree =
+        treeView.GetSelectedItem() &&
+        CComboBox(GetDlgItem(IDC_PROPERTY_NAME)).GetCurSel() != CB_ERR &&
+        CButton(GetDlgItem(IDC_PROPERTY_IS_XAML)).GetCheck() == BST_UNCHECKED;
+
     try {
         wf::IInspectable element;
-        winrt::check_hresult(m_xamlDiagnostics->GetIInspectableFromHandle(
-            handle,
-            reinterpret_cast<::IInspectable**>(winrt::put_abi(element))));
+        ObjectKind kind;
+        winrt::check_hresult(
+            InspectableFromHandle(handle, &element, nullptr, &kind));
 
-        auto wuiElement = element.try_as<wux::UIElement>();
-        auto muiElement = wuiElement ? mux::UIElement{nullptr}
-                                     : element.try_as<mux::UIElement>();
+        auto wuiElement = IsWuxUIElement(kind) ? element.as<wux::UIElement>()
+                                               : wux::UIElement{nullptr};
+        auto muiElement = IsMuxUIElement(kind) ? element.as<mux::UIElement>()
+                                               : mux::UIElement{nullptr};
 
-        bool visible;
+        bool visible = false;
         if (wuiElement) {
             visible = wuiElement.Visibility() == wux::Visibility::Visible;
         } else if (muiElement) {
             visible = muiElement.Visibility() == mux::Visibility::Visible;
-        } else {
-            return;
         }
 
-        menu.AppendMenu(MF_STRING | (visible ? MF_CHECKED : 0), MENU_ID_VISIBLE,
-                        L"Visible");
+        if (wuiElement || muiElement) {
+            menu.AppendMenu(MF_STRING | (visible ? MF_CHECKED : 0),
+                            MENU_ID_VISIBLE, L"Visible");
+            menu.AppendMenu(MF_SEPARATOR);
+        }
+
+        menu.AppendMenu(MF_STRING, MENU_ID_REPEATED_SUBTREES,
+                        L"Repeated subtrees...");
+        menu.AppendMenu(MF_STRING, MENU_ID_TREE_HISTORY, L"Tree history...");
+        menu.AppendMenu(MF_SEPARATOR);
+        menu.AppendMenu(MF_STRING | (handle == m_scopeHandle ? MF_CHECKED : 0),
+                        MENU_ID_SCOPE_TO_SUBTREE, L"Scope to subtree");
+        menu.AppendMenu(MF_STRING | (m_scopeHandle ? 0 : MF_GRAYED),
+                        MENU_ID_CLEAR_SCOPE, L"Clear scope");
+        menu.AppendMenu(MF_SEPARATOR);
+        menu.AppendMenu(MF_STRING | (m_crawlProperties ? MF_CHECKED : 0),
+                        MENU_ID_CRAWL_PROPERTIES,
+                        L"Collect properties of all elements");
+        menu.AppendMenu(MF_STRING | (m_crawlProperties ? 0 : MF_GRAYED),
+                        MENU_ID_QUERY_PROPERTIES,
+                        L"Query collected properties...");
+        menu.AppendMenu(MF_STRING | (canCompareProperties ? 0 : MF_GRAYED),
+                        MENU_ID_COMPARE_PROPERTIES,
+                        L"Compare properties with the selected element...");
+        menu.AppendMenu(MF_STRING, MENU_ID_EXPORT_PROPERTIES,
+                        m_propertyExport ? L"Cancel property export"
+                                         : L"Export subtree properties...");
+        menu.AppendMenu(MF_SEPARATOR);
+        menu.AppendMenu(MF_STRING | (canSetPropertyInSubtree ? 0 : MF_GRAYED),
+                        MENU_ID_SET_PROPERTY_IN_SUBTREE,
+                        L"Set property on elements of the selected type");
+        menu.AppendMenu(MF_SEPARATOR);
+        auto undoText =
+            m_editJournal.CanUndo()
+                ? std::format(L"Undo {}\tCtrl+Z",
+                              m_editJournal.NextUndo().description)
+                : std::wstring(L"Undo\tCtrl+Z");
+        menu.AppendMenu(MF_STRING | (m_editJournal.CanUndo() ? 0 : MF_GRAYED),
+                        MENU_ID_UNDO_EDIT, undoText.c_str());
+        auto redoText =
+            m_editJournal.CanRedo()
+                ? std::format(L"Redo {}\tCtrl+Y",
+                              m_editJournal.NextRedo().description)
+                : std::wstring(L"Redo\tCtrl+Y");
+        menu.AppendMenu(MF_STRING | (m_editJournal.CanRedo() ? 0 : MF_GRAYED),
+                        MENU_ID_REDO_EDIT, redoText.c_str());
+        menu.AppendMenu(MF_STRING | (m_editJournal.CanUndo() ? 0 : MF_GRAYED),
+                        MENU_ID_REVERT_EDITS, L"Revert edits in subtree");
 
         int nCmd = menu.TrackPopupMenu(TPM_RIGHTBUTTON | TPM_RETURNCMD,
                                        menuPoint.x, menuPoint.y, m_hWnd);
@@ -700,8 +1262,64 @@ void CMainDlg::OnContextMenu(CWindow wnd, CPoint point) {
                                                   : mux::Visibility::Visible);
                 }
 
+                // As with other edits, the layout of other elements changes
+                // too.
+                InvalidatePropertyChains(handle);
+                m_propertyChainCache.Clear();
                 RefreshSelectedElementInformation();
                 break;
+
+            case MENU_ID_REPEATED_SUBTREES:
+                ShowRepeatedSubtrees(handle);
+                break;
+
+            case MENU_ID_TREE_HISTORY:
+                ShowTreeHistory(handle);
+                break;
+
+            case MENU_ID_SCOPE_TO_SUBTREE:
+                SetScope(handle);
+                break;
+
+            case MENU_ID_CLEAR_SCOPE:
+                SetScope(0);
+                break;
+
+            case MENU_ID_CRAWL_PROPERTIES:
+                SetCrawlProperties(!m_crawlProperties);
+                break;
+
+            case MENU_ID_QUERY_PROPERTIES:
+                ShowPropertyQuery();
+                break;
+
+            case MENU_ID_COMPARE_PROPERTIES:
+                ShowPropertyCompare(selectedHandle, handle);
+                break;
+
+            case MENU_ID_EXPORT_PROPERTIES:
+                if (m_propertyExport) {
+                    FinishPropertyExport(/*cancel=*/true);
+                } else {
+                    ExportProperties(handle);
+                }
+                break;
+
+            case MENU_ID_SET_PROPERTY_IN_SUBTREE:
+                SetPropertyInSubtree(handle);
+                break;
+
+            case MENU_ID_UNDO_EDIT:
+                UndoEdit();
+                break;
+
+            case MENU_ID_REDO_EDIT:
+                RedoEdit();
+                break;
+
+            case MENU_ID_REVERT_EDITS:
+                RevertEdits(handle);
+                break;
         }
     } catch (...) {
         HRESULT hr = winrt::to_hresult();
@@ -711,58 +1329,74 @@ void CMainDlg::OnContextMenu(CWindow wnd, CPoint point) {
 }
 
 InstanceHandle CMainDlg::ElementFromPoint(CPoint pt) {
-    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto itRoots = m_parentToChildren.find(0);
+    if (itRoots == m_parentToChildren.end()) {
+        return 0;
+    }
 
-    for (auto item = treeView.GetRootItem(); item;
-         item = item.GetNextSibling()) {
-        auto handle = static_cast<InstanceHandle>(item.GetData());
+    // Copy, since the app might add or remove roots while we're querying it.
+    const auto rootHandles = itRoots->second;
 
+    for (auto handle : rootHandles) {
         wf::IInspectable rootElement;
-        HRESULT hr = m_xamlDiagnostics->GetIInspectableFromHandle(
-            handle,
-            reinterpret_cast<::IInspectable**>(winrt::put_abi(rootElement)));
+        ObjectKind rootKind;
+        HRESULT hr =
+            InspectableFromHandle(handle, &rootElement, nullptr, &rootKind);
         if (FAILED(hr) || !rootElement) {
             continue;
         }
 
         CWindow rootWnd;
         CRect rootElementRect;
-        if (auto rect = GetRootElementRect(rootElement, &rootWnd.m_hWnd)) {
+        if (auto rect =
+                GetRootElementRect(rootElement, rootKind, &rootWnd.m_hWnd)) {
             rootElementRect = *rect;
         }
 
         wux::UIElement wsubtree = nullptr;
         mux::UIElement msubtree = nullptr;
 
-        if (auto window = rootElement.try_as<wux::Window>()) {
-            wsubtree = window.Content();
-        } else if (auto desktopWindowXamlSource =
-                       rootElement
-                           .try_as<wux::Hosting::DesktopWindowXamlSource>()) {
-            wsubtree = desktopWindowXamlSource.Content();
-        } else if (auto window = rootElement.try_as<mux::Window>()) {
-            msubtree = window.Content();
-        } else if (auto desktopWindowXamlSource =
-                       rootElement
-                           .try_as<mux::Hosting::DesktopWindowXamlSource>()) {
-            msubtree = desktopWindowXamlSource.Content();
-        } else if (auto desktopWindowXamlSource = try_as_with_guid_unsafe<
-                       mux::Hosting::DesktopWindowXamlSource>(
-                       reinterpret_cast<::IInspectable*>(
-                           winrt::get_abi(rootElement)),
-                       IID_IDesktopWindowXamlSource_WinUI_2)) {
-            msubtree = desktopWindowXamlSource.Content();
-        } else if (auto desktopWindowXamlSource = try_as_with_guid_unsafe<
-                       mux::Hosting::DesktopWindowXamlSource>(
-                       reinterpret_cast<::IInspectable*>(
-                           winrt::get_abi(rootElement)),
-                       IID_IDesktopWindowXamlSource_WinUI_1)) {
-            msubtree = desktopWindowXamlSource.Content();
-        }
+        switch (rootKind) {
+            case ObjectKind::WuxWindow:
+                wsubtree = rootElement.as<wux::Window>().Content();
+                break;
 
-        if (!wsubtree && !msubtree) {
-            continue;
-        }
+            case ObjectKind::WuxDesktopWindowXamlSource:
+                wsubtree =
+                    rootElement.as<wux::Hosting::DesktopWindowXamlSource>()
+                        .Content();
+                break;
+
+            case ObjectKind::MuxWindow:
+                msubtree = rootElement.as<mux::Window>().Content();
+                break;
+
+            case ObjectKind::MuxDesktopWindowXamlSource:
+                msubtree =
+                    rootElement.as<mux::Hosting::DesktopWindowXamlSource>()
+                        .Content();
+                break;
+
+            case ObjectKind::MuxDesktopWindowXamlSourceWinUI2:
+            case ObjectKind::MuxDesktopWindowXamlSourceWinUI1:
+                if (auto desktopWindowXamlSource = try_as_with_guid_unsafe<
+                        mux::Hosting::DesktopWindowXamlSource>(
+                        reinterpret_cast<::IInspectable*>(
+                            winrt::get_abi(rootElement)),
+                        rootKind == ObjectKind::MuxDesktopWindowXamlSourceWinUI2
+                            ? IID_IDesktopWindowXamlSource_WinUI_2
+                            : IID_IDesktopWindowXamlSource_WinUI_1)) {
+                    msubtree = desktopWindowXamlSource.Content();
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (!wsubtree && !msubtree) {
+            continue;
+        }
 
         CPoint ptWithoutDpi;
 
@@ -844,290 +1478,1016 @@ InstanceHandle CMainDlg::ElementFromPointInSubtree(mux::UIElement subtree,
     return 0;
 }
 
-bool CMainDlg::CreateFlashArea(InstanceHandle handle) {
-    wf::IInspectable element;
-    wf::IInspectable rootElement;
-
-    InstanceHandle iterHandle = handle;
-    while (true) {
-        auto it = m_elementItems.find(iterHandle);
-        if (it == m_elementItems.end()) {
-            ATLASSERT(FALSE);
-            return false;
+void CMainDlg::InvalidateSubtreeShape(InstanceHandle handle) {
+    // Stop at the first element which is already invalidated, its ancestors
+    // are invalidated as well.
+    while (handle) {
+        auto it = m_elementItems.find(handle);
+        if (it == m_elementItems.end() || !it->second.shapeHash) {
+            break;
         }
 
-        if (!it->second.parentHandle) {
-            HRESULT hr = m_xamlDiagnostics->GetIInspectableFromHandle(
-                it->first, reinterpret_cast<::IInspectable**>(
-                               winrt::put_abi(rootElement)));
-            if (FAILED(hr) || !rootElement) {
-                return false;
-            }
+        it->second.shapeHash = 0;
+        handle = it->second.parentHandle;
+    }
+}
 
-            break;
-        }
+void CMainDlg::UpdateSubtreeShape(InstanceHandle handle,
+                                  ElementItem* elementItem) {
+    if (elementItem->shapeHash) {
+        return;
+    }
 
-        if (!element) {
-            HRESULT hr = m_xamlDiagnostics->GetIInspectableFromHandle(
-                it->first,
-                reinterpret_cast<::IInspectable**>(winrt::put_abi(element)));
-            if (FAILED(hr) || !element) {
-                return false;
+    SubtreeShape::Hasher hasher(elementItem->typeHash);
+    UINT64 subtreeSize = 1;
+
+    if (auto it = m_parentToChildren.find(handle);
+        it != m_parentToChildren.end()) {
+        for (const auto& childHandle : it->second) {
+            auto childElementItem = m_elementItems.find(childHandle);
+            if (childElementItem == m_elementItems.end()) {
+                ATLASSERT(FALSE);
+                continue;
             }
-        }
 
-        iterHandle = it->second.parentHandle;
+            UpdateSubtreeShape(childHandle, &childElementItem->second);
+            hasher.AddChild(childElementItem->second.shapeHash);
+            subtreeSize += childElementItem->second.subtreeSize;
+        }
     }
 
-    CWindow rootWnd;
-    CRect rootElementRect;
-    if (auto rect = GetRootElementRect(rootElement, &rootWnd.m_hWnd)) {
-        rootElementRect = *rect;
+    elementItem->shapeHash = hasher.Finish();
+    elementItem->subtreeSize = subtreeSize;
+}
+
+void CMainDlg::ShowRepeatedSubtrees(InstanceHandle handle) {
+    auto it = m_elementItems.find(handle);
+    if (it == m_elementItems.end()) {
+        return;
     }
 
-    CRect rect;
-    if (element) {
-        auto elementRect = GetRelativeElementRect(element);
-        if (!elementRect) {
-            return false;
-        }
+    UpdateSubtreeShape(handle, &it->second);
+
+    std::vector<SubtreeShape::Entry> entries;
+    entries.reserve(it->second.subtreeSize);
+
+    std::function<void(InstanceHandle, const ElementItem&, UINT64)>
+        collectEntries;
+    collectEntries = [this, &entries, &collectEntries](
+                         InstanceHandle handle, const ElementItem& elementItem,
+                         UINT64 parentShapeHash) {
+        entries.push_back({
+            .handle = handle,
+            .shapeHash = elementItem.shapeHash,
+            .parentShapeHash = parentShapeHash,
+            .subtreeSize = elementItem.subtreeSize,
+        });
+
+        if (auto it = m_parentToChildren.find(handle);
+            it != m_parentToChildren.end()) {
+            for (const auto& childHandle : it->second) {
+                auto childElementItem = m_elementItems.find(childHandle);
+                if (childElementItem == m_elementItems.end()) {
+                    continue;
+                }
 
-        rect = *elementRect;
-        rect.OffsetRect(rootElementRect.TopLeft());
-    } else {
-        rect = *rootElementRect;
-    }
+                collectEntries(childHandle, childElementItem->second,
+                               elementItem.shapeHash);
+            }
+        }
+    };
 
-    if (rootWnd) {
-        UINT dpi = ::GetDpiForWindow(rootWnd);
-        CRect rectWithDpi;
-        rectWithDpi.left = MulDiv(rect.left, dpi, 96);
-        rectWithDpi.top = MulDiv(rect.top, dpi, 96);
-        // Round width and height, not right and bottom, for consistent results.
-        rectWithDpi.right =
-            rectWithDpi.left + MulDiv(rect.right - rect.left, dpi, 96);
-        rectWithDpi.bottom =
-            rectWithDpi.top + MulDiv(rect.bottom - rect.top, dpi, 96);
+    collectEntries(handle, it->second, 0);
 
-        rect = rectWithDpi;
-    }
+    auto repeatedShapes = SubtreeShape::FindRepeatedShapes(
+        entries, kRepeatedSubtreesMaxResults);
 
-    DestroyFlashArea();
+    std::vector<CRepeatedSubtreesDlg::Row> rows;
+    rows.reserve(repeatedShapes.size());
+    for (const auto& shape : repeatedShapes) {
+        auto representative = m_elementItems.find(shape.representative);
+        if (representative == m_elementItems.end()) {
+            continue;
+        }
 
-    if (rect.IsRectEmpty()) {
-        return true;
+        rows.push_back({
+            .title = representative->second.itemTitle,
+            .representative = shape.representative,
+            .count = shape.count,
+            .subtreeSize = shape.subtreeSize,
+        });
     }
 
-    m_flashAreaWindow =
-        FlashArea(m_hWnd, _Module.GetModuleInstance(), rect, IsWindowVisible());
-    if (!m_flashAreaWindow) {
-        return false;
+    CRepeatedSubtreesDlg dlg(std::move(rows));
+    if (dlg.DoModal(m_hWnd) == IDOK) {
+        SelectElement(dlg.GetSelectedHandle());
     }
+}
 
-    return true;
+void CMainDlg::ShowTreeHistory(InstanceHandle handle) {
+    CTreeHistoryDlg dlg(m_treeHistory, GetTickCount64(), handle);
+    dlg.DoModal(m_hWnd);
 }
 
-void CMainDlg::DestroyFlashArea() {
-    if (m_flashAreaWindow) {
-        m_flashAreaWindow.DestroyWindow();
+void CMainDlg::ShowPropertyQuery() {
+    CPropertyQueryDlg dlg(m_propertyStore, [](std::int32_t source) {
+        return BaseValueSourceToString(static_cast<BaseValueSource>(source));
+    });
+    if (dlg.DoModal(m_hWnd) == IDOK) {
+        SelectElement(dlg.GetSelectedHandle());
     }
 }
 
-LRESULT CMainDlg::OnElementTreeSelChanged(LPNMHDR pnmh) {
-    NMTREEVIEW* pnmtv = (NMTREEVIEW*)pnmh;
-
-    switch (pnmtv->action) {
-        case TVC_BYKEYBOARD:
-        case TVC_BYMOUSE:
-            SetSelectedElementInformation();
-            break;
+void CMainDlg::ShowPropertyCompare(InstanceHandle first,
+                                   InstanceHandle second) {
+    auto elementTitle = [this](InstanceHandle handle) {
+        auto it = m_elementItems.find(handle);
+        return it != m_elementItems.end() ? it->second.itemTitle
+                                          : std::wstring();
+    };
 
-        default:
-            // Action is TVC_UNKNOWN when the selection is changed after the
-            // previous selection was deleted. Use a delay since the app might
-            // be busy deleting many items at once.
-            SetTimer(TIMER_ID_SET_SELECTED_ELEMENT_INFORMATION,
-                     kRedrawTreeDelay);
-            break;
-    }
+    // The chains are always fetched, so that Refresh shows the current
+    // values, and the cache is updated with them. The dialog keeps them until
+    // it's closed.
+    auto chainLoader = [this](InstanceHandle handle, HRESULT* hr) {
+        auto chain = LoadPropertyChain(m_visualTreeService.get(), handle, hr);
+        if (chain) {
+            m_propertyChainCache.Put(handle, chain, GetTickCount64());
+        }
 
-    return 0;
-}
+        return chain;
+    };
 
-void CMainDlg::OnSplitToggle(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    m_splitModeAttributesExpanded = !m_splitModeAttributesExpanded;
-    wndCtl.SetWindowText(m_splitModeAttributesExpanded ? L">" : L"<");
+    auto valueToString = [this](const PropertyChain& chain,
+                                const PropertyChain::Value& v) {
+        if (v.metadataBits & IsValueNull) {
+            return std::wstring(L"(null)");
+        }
 
-    // Below is a very ugly hack to switch to another DlgResize layout.
+        if (!(v.metadataBits & IsValueHandle)) {
+            return std::wstring(chain.View(v.value));
+        }
 
-    CRect rectDlg;
-    GetClientRect(&rectDlg);
+        // Values which are objects are compared by handle, so it's shown.
+        InstanceHandle valueHandle = static_cast<InstanceHandle>(
+            std::wcstoll(chain.CStr(v.value), nullptr, 10));
 
-    SetWindowPos(nullptr, 0, 0, m_sizeDialog.cx, m_sizeDialog.cy,
-                 SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+        std::wstring className;
+        wf::IInspectable valueObj;
+        HRESULT hr = InspectableFromHandle(valueHandle, &valueObj, &className);
+        if (FAILED(hr)) {
+            className = std::format(L"Error {:08X}", static_cast<DWORD>(hr));
+        }
 
-    DlgResize_Init();
+        return std::format(
+            L"({}; {}; {})",
+            (v.metadataBits & IsValueCollection) ? L"collection" : L"data",
+            className, valueHandle);
+    };
 
-    ResizeClient(rectDlg.right, rectDlg.bottom);
+    CPropertyCompareDlg dlg(
+        {.handle = first, .title = elementTitle(first)},
+        {.handle = second, .title = elementTitle(second)},
+        m_detailedProperties, std::move(chainLoader),
+        [](std::int32_t source) {
+            return BaseValueSourceToString(
+                static_cast<BaseValueSource>(source));
+        },
+        std::move(valueToString));
+    dlg.DoModal(m_hWnd);
 }
 
-LRESULT CMainDlg::OnDetailsTabsSelChange(LPNMHDR pnmh) {
-    auto detailsTabs = CTabCtrl(GetDlgItem(IDC_DETAILS_TABS));
-    int index = detailsTabs.GetCurSel();
+void CMainDlg::ExportProperties(InstanceHandle rootHandle) {
+    CFileDialog fileDialog(FALSE, L"csv", L"properties",
+                           OFN_OVERWRITEPROMPT | OFN_HIDEREADONLY,
+                           L"CSV files (*.csv)\0*.csv\0"
+                           L"Columnar files (*.uwpcol)\0*.uwpcol\0",
+                           m_hWnd);
+    if (fileDialog.DoModal(m_hWnd) != IDOK) {
+        return;
+    }
 
-    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
-    attributesList.ShowWindow(index == 0 ? SW_SHOW : SW_HIDE);
+    // In the order of the filters above.
+    auto format = fileDialog.m_ofn.nFilterIndex == 2
+                      ? PropertyExporter::Format::Columnar
+                      : PropertyExporter::Format::Csv;
 
-    auto visualStatesList = CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
-    visualStatesList.ShowWindow(index == 1 ? SW_SHOW : SW_HIDE);
+    auto propertyExport = std::make_unique<PropertyExport>();
+    propertyExport->path = fileDialog.m_szFileName;
 
-    return 0;
+    HRESULT hr = propertyExport->file.Create(propertyExport->path.c_str(),
+                                             GENERIC_WRITE, 0, CREATE_ALWAYS);
+    if (FAILED(hr)) {
+        auto errorMsg = std::format(L"Error {:08X}", static_cast<DWORD>(hr));
+        MessageBox(errorMsg.c_str(), L"Error");
+        return;
+    }
+
+    // The handles are collected up front, in tree order. Elements which are
+    // removed before their turn are skipped.
+    std::vector<InstanceHandle> pending{rootHandle};
+    while (!pending.empty()) {
+        InstanceHandle handle = pending.back();
+        pending.pop_back();
+
+        propertyExport->handles.push_back(handle);
+
+        if (auto it = m_parentToChildren.find(handle);
+            it != m_parentToChildren.end()) {
+            pending.insert(pending.end(), it->second.rbegin(),
+                           it->second.rend());
+        }
+    }
+
+    propertyExport->start = std::chrono::steady_clock::now();
+    try {
+        propertyExport->exporter = std::make_unique<PropertyExporter>(
+            format,
+            [file = &propertyExport->file](const char* data, size_t size) {
+                return SUCCEEDED(file->Write(data, static_cast<DWORD>(size)));
+            },
+            [](std::int32_t source) {
+                return BaseValueSourceToString(
+                    static_cast<BaseValueSource>(source));
+            });
+    } catch (...) {
+        // E.g. if a worker thread couldn't be started.
+        propertyExport->file.Close();
+        ::DeleteFile(propertyExport->path.c_str());
+        throw;
+    }
+
+    m_propertyExport = std::move(propertyExport);
+    SetTimer(TIMER_ID_EXPORT_PROPERTIES, kExportSliceDelay);
 }
 
-LRESULT CMainDlg::OnAttributeListDblClk(LPNMHDR pnmh) {
-    auto itemActivate = reinterpret_cast<LPNMITEMACTIVATE>(pnmh);
-    if (itemActivate->iItem == -1 ||
-        (itemActivate->iSubItem != 0 && itemActivate->iSubItem != 1)) {
-        return 0;
+void CMainDlg::ExportPropertiesSlice() {
+    if (!m_propertyExport) {
+        KillTimer(TIMER_ID_EXPORT_PROPERTIES);
+        return;
     }
 
-    auto attributesList = CListViewCtrl(pnmh->hwndFrom);
+    auto& propertyExport = *m_propertyExport;
+    auto& exporter = *propertyExport.exporter;
 
-    if (itemActivate->iSubItem == 0) {
-        unsigned int clickedPropertyIndex = static_cast<unsigned int>(
-            attributesList.GetItemData(itemActivate->iItem));
+    auto start = std::chrono::steady_clock::now();
 
-        auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
-        int index = CB_ERR;
+    // No chains are fetched while the workers are behind, which bounds the
+    // memory used by chains waiting to be written.
+    while (propertyExport.nextHandle < propertyExport.handles.size() &&
+           !exporter.Busy() && !exporter.Failed() &&
+           std::chrono::steady_clock::now() - start < kExportSliceBudget) {
+        InstanceHandle handle =
+            propertyExport.handles[propertyExport.nextHandle++];
 
-        int propertiesCount = propertiesComboBox.GetCount();
-        for (int i = 0; i < propertiesCount; i++) {
-            unsigned int propertyIndex =
-                static_cast<unsigned int>(propertiesComboBox.GetItemData(i));
-            if (propertyIndex == clickedPropertyIndex) {
-                index = i;
-                break;
-            }
+        auto itemIt = m_elementItems.find(handle);
+        if (itemIt == m_elementItems.end()) {
+            propertyExport.failedElements++;
+            continue;
         }
 
-        if (index != CB_ERR) {
-            propertiesComboBox.SetCurSel(index);
-            propertiesComboBox.GetLBText(index, m_lastPropertySelection);
+        // Always fetched, so that the export has the current values. As with
+        // the crawler, the chain isn't added to the cache.
+        HRESULT hr = S_OK;
+        auto chain = LoadPropertyChain(m_visualTreeService.get(), handle, &hr);
+
+        if (!chain) {
+            propertyExport.failedElements++;
+            continue;
         }
-    } else if (itemActivate->iSubItem == 1) {
-        bool valueShownAsIs =
-            (attributesList.GetItemData(itemActivate->iItem) >> 32) & 1;
-        if (valueShownAsIs) {
-            CString itemValue;
-            attributesList.GetItemText(itemActivate->iItem,
-                                       itemActivate->iSubItem, itemValue);
 
-            auto propertyValueEdit = CEdit(GetDlgItem(IDC_PROPERTY_VALUE));
-            propertyValueEdit.SetWindowText(itemValue);
+        std::wstring className;
+        wf::IInspectable obj;
+        InspectableFromHandle(handle, &obj, &className);
 
-            auto propertyValueXamlCheckbox =
-                CButton(GetDlgItem(IDC_PROPERTY_IS_XAML));
-            if (propertyValueXamlCheckbox.GetCheck() != BST_UNCHECKED) {
-                propertyValueXamlCheckbox.SetCheck(BST_UNCHECKED);
-                propertyValueEdit.ShowWindow(SW_SHOW);
-                auto propertyValueEditXaml =
-                    CEdit(GetDlgItem(IDC_PROPERTY_VALUE_XAML));
-                propertyValueEditXaml.ShowWindow(SW_HIDE);
-            }
-        }
+        exporter.Add({
+            .handle = handle,
+            .parentHandle = itemIt->second.parentHandle,
+            .typeName = std::move(className),
+            .chain = std::move(chain),
+        });
     }
 
-    return 0;
-}
-
-void CMainDlg::OnPropertyNameSelChange(UINT uNotifyCode,
-                                       int nID,
-                                       CWindow wndCtl) {
-    auto propertiesComboBox = CComboBox(wndCtl);
-    int index = propertiesComboBox.GetCurSel();
-    if (index != CB_ERR) {
-        propertiesComboBox.GetLBText(index, m_lastPropertySelection);
+    if (propertyExport.nextHandle == propertyExport.handles.size() ||
+        exporter.Failed()) {
+        FinishPropertyExport(/*cancel=*/false);
     }
 }
 
-void CMainDlg::OnPropertyIsXaml(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    bool checked = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+void CMainDlg::FinishPropertyExport(bool cancel) {
+    KillTimer(TIMER_ID_EXPORT_PROPERTIES);
 
-    auto propertyValueEdit = CEdit(GetDlgItem(IDC_PROPERTY_VALUE));
-    auto propertyValueEditXaml = CEdit(GetDlgItem(IDC_PROPERTY_VALUE_XAML));
+    auto propertyExport = std::move(m_propertyExport);
+    if (!propertyExport) {
+        return;
+    }
 
-    propertyValueEdit.ShowWindow(checked ? SW_HIDE : SW_SHOW);
-    propertyValueEditXaml.ShowWindow(checked ? SW_SHOW : SW_HIDE);
-}
+    bool succeeded = false;
+    if (cancel) {
+        propertyExport->exporter->Cancel();
+    } else {
+        succeeded = propertyExport->exporter->Finish();
+    }
+
+    auto stats = propertyExport->exporter->GetStats();
+    propertyExport->exporter.reset();
+    propertyExport->file.Close();
+
+#if EXTRA_DEBUG
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - propertyExport->start);
+
+    auto statsStr = std::format(
+        L"Property export: {} elements ({} failed), {} rows, {} batches, "
+        L"{} bytes in {:.2f} s\n",
+        stats.elements, propertyExport->failedElements, stats.rows,
+        stats.batches, stats.bytes, elapsed.count());
+    OutputDebugString(statsStr.c_str());
+#endif  // EXTRA_DEBUG
+
+    if (cancel || !succeeded) {
+        ::DeleteFile(propertyExport->path.c_str());
+        if (!cancel) {
+            MessageBox(L"Writing the file failed", L"Error");
+        }
 
-void CMainDlg::OnPropertyRemove(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
-    auto selectedItem = treeView.GetSelectedItem();
-    if (!selectedItem) {
         return;
     }
 
-    auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+    auto msg = std::format(L"Exported {} values of {} elements to {}",
+                           stats.rows, stats.elements, propertyExport->path);
+    if (propertyExport->failedElements > 0) {
+        msg += std::format(L"\n\n{} elements couldn't be exported",
+                           propertyExport->failedElements);
+    }
 
-    auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
+    MessageBox(msg.c_str(), L"Export properties");
+}
 
-    int propertiesComboBoxIndex = propertiesComboBox.GetCurSel();
-    if (propertiesComboBoxIndex == CB_ERR) {
-        return;
+// Inherited properties, such as FontSize, might also change the values of the
+// descendants.
+void CMainDlg::InvalidatePropertyChains(InstanceHandle handle) {
+    m_propertyChainCache.InvalidateIf([this, handle](InstanceHandle cached) {
+        return m_ancestorIndex.IsAncestor(handle, cached);
+    });
+    m_propertyChainCache.Invalidate(handle);
+
+    if (m_crawlProperties) {
+        m_propertyCrawler.MarkDirty(handle);
+        m_propertyCrawler.MarkDirtyIf([this, handle](InstanceHandle element) {
+            return m_ancestorIndex.IsAncestor(handle, element);
+        });
+        ScheduleCrawl();
     }
+}
 
-    unsigned int propertyIndex = static_cast<unsigned int>(
-        propertiesComboBox.GetItemData(propertiesComboBoxIndex));
+void CMainDlg::SetCrawlProperties(bool crawl) {
+    m_crawlProperties = crawl;
 
-    HRESULT hr = m_visualTreeService->ClearProperty(handle, propertyIndex);
-    if (FAILED(hr)) {
-        auto errorMsg = std::format(L"Error {:08X}", static_cast<DWORD>(hr));
-        MessageBox(errorMsg.c_str(), L"Error");
+    if (!crawl) {
+        KillTimer(TIMER_ID_CRAWL_PROPERTIES);
+        m_crawlScheduled = false;
+        m_propertyCrawler.Clear();
+        m_propertyStore.Clear();
         return;
     }
 
-    RefreshSelectedElementInformation();
+    m_propertyCrawler.ResetStats();
+    for (const auto& [handle, elementItem] : m_elementItems) {
+        m_propertyCrawler.Add(handle);
+    }
+
+    ScheduleCrawl();
 }
 
-void CMainDlg::OnPropertySet(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
-    auto selectedItem = treeView.GetSelectedItem();
-    if (!selectedItem) {
-        return;
+void CMainDlg::ScheduleCrawl() {
+    // Don't reset the timer if already scheduled, frequent mutations would
+    // keep postponing it.
+    if (m_crawlProperties && !m_crawlScheduled &&
+        m_propertyCrawler.HasPendingWork()) {
+        SetTimer(TIMER_ID_CRAWL_PROPERTIES, kCrawlSliceDelay);
+        m_crawlScheduled = true;
     }
+}
 
-    auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+void CMainDlg::CrawlProperties() {
+    auto start = std::chrono::steady_clock::now();
 
-    auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
+    auto fetch = [this](InstanceHandle handle) {
+        // A chain which was cached a moment ago is used, but new chains aren't
+        // added to the cache, which is meant for the recently viewed elements.
+        auto chain = m_propertyChainCache.Peek(handle, GetTickCount64());
+        if (!chain) {
+            HRESULT hr = S_OK;
+            chain = LoadPropertyChain(m_visualTreeService.get(), handle, &hr);
+        }
 
-    int propertiesComboBoxIndex = propertiesComboBox.GetCurSel();
-    if (propertiesComboBoxIndex == CB_ERR) {
+        if (!chain) {
+            m_propertyStore.Erase(handle);
+            return false;
+        }
+
+        std::wstring className;
+        wf::IInspectable obj;
+        InspectableFromHandle(handle, &obj, &className);
+
+        m_propertyStore.Put(handle, className, *chain);
+        return true;
+    };
+
+    m_propertyCrawler.Step(fetch, [start] {
+        return std::chrono::steady_clock::now() - start >= kCrawlSliceBudget;
+    });
+
+    m_propertyCrawler.RecordSlice(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+
+    if (m_propertyCrawler.HasPendingWork()) {
         return;
     }
 
-    CString propertyNameAndType;
-    propertiesComboBox.GetLBText(propertiesComboBoxIndex, propertyNameAndType);
-    unsigned int propertyIndex = static_cast<unsigned int>(
-        propertiesComboBox.GetItemData(propertiesComboBoxIndex));
+    KillTimer(TIMER_ID_CRAWL_PROPERTIES);
+    m_crawlScheduled = false;
+
+#if EXTRA_DEBUG
+    const auto& stats = m_propertyCrawler.GetStats();
+    auto busyMs = stats.busyTime.count() / 1000.0;
+    auto statsStr = std::format(
+        L"Property crawl: {} elements ({} failed) in {} slices, {:.1f} ms "
+        L"busy, {:.0f} elements/s, max slice {:.1f} ms\n",
+        stats.fetched, stats.failed, stats.slices, busyMs,
+        busyMs > 0 ? stats.fetched * 1000 / busyMs : 0.0,
+        stats.maxSliceTime.count() / 1000.0);
+    OutputDebugString(statsStr.c_str());
+#endif  // EXTRA_DEBUG
+    m_propertyCrawler.ResetStats();
+}
 
+HRESULT CMainDlg::InspectableFromHandle(InstanceHandle handle,
+                                        wf::IInspectable* object,
+                                        std::wstring* className,
+                                        ObjectKind* kind) {
+    if (const auto* entry = m_handleCache.Find(handle)) {
+        if (auto cachedObject = entry->object.get()) {
+            m_handleCache.CountHit();
+            *object = std::move(cachedObject);
+            if (kind) {
+                *kind = ObjectKindOf(*object, entry->className);
+            }
+
+            if (className) {
+                *className = entry->className;
+            }
+
+            return S_OK;
+        }
+    }
+
+    m_handleCache.CountMiss();
+
+    wf::IInspectable resolvedObject;
+    HRESULT hr = m_xamlDiagnostics->GetIInspectableFromHandle(
+        handle,
+        reinterpret_cast<::IInspectable**>(winrt::put_abi(resolvedObject)));
+    if (FAILED(hr) || !resolvedObject) {
+        *object = nullptr;
+        if (kind) {
+            *kind = ObjectKind::Other;
+        }
+
+        return hr;
+    }
+
+    std::wstring resolvedClassName(winrt::get_class_name(resolvedObject));
+
+    if (kind) {
+        *kind = ObjectKindOf(resolvedObject, resolvedClassName);
+    }
+
+    // Objects which don't support weak references aren't cached.
+    try {
+        m_handleCache.Put(handle, {.object = winrt::make_weak(resolvedObject),
+                                   .className = resolvedClassName});
+    } catch (...) {
+    }
+
+    *object = std::move(resolvedObject);
+    if (className) {
+        *className = std::move(resolvedClassName);
+    }
+
+    return S_OK;
+}
+
+HRESULT CMainDlg::CreateValueInstance(const CString& type,
+                                      const CString& value,
+                                      InstanceHandle* instanceHandle,
+                                      bool* cached) {
+    std::wstring_view typeView{type.GetString(), (size_t)type.GetLength()};
+    std::wstring_view valueView{value.GetString(), (size_t)value.GetLength()};
+
+    if (const auto* entry = m_valueInstanceCache.Find(typeView, valueView)) {
+        *instanceHandle = entry->handle;
+        *cached = true;
+        return S_OK;
+    }
+
+    *cached = false;
+
+    HRESULT hr = m_visualTreeService->CreateInstance(
+        _bstr_t(type), _bstr_t(value), instanceHandle);
+    if (FAILED(hr) || m_valueInstanceCache.IsExcluded(typeView)) {
+        return hr;
+    }
+
+    // The cache keeps the object alive, so that the handle stays valid. If
+    // the object can't be resolved, the handle is used once and not cached.
+    wf::IInspectable object;
+    if (SUCCEEDED(InspectableFromHandle(*instanceHandle, &object)) && object) {
+        m_valueInstanceCache.Put(typeView, valueView,
+                                 {.handle = *instanceHandle,
+                                  .object = std::move(object)});
+    }
+
+    return hr;
+}
+
+wf::IInspectable CMainDlg::StyleValueFromXamlCached(
+    ObjectKind kind,
+    std::wstring_view className,
+    std::wstring_view propertyName,
+    std::wstring_view propertyType,
+    std::wstring_view xaml) {
+    // Types excluded from value reuse are parsed each time as well.
+    bool reuse = !m_valueInstanceCache.IsExcluded(propertyType);
+
+    if (reuse) {
+        if (const auto* value = m_xamlValueCache.Find(
+                static_cast<int>(kind), className, propertyName, xaml)) {
+            return *value;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto value = StyleValueFromXaml(kind, className, propertyName, xaml);
+    m_xamlValueCache.RecordParse(std::chrono::steady_clock::now() - start);
+
+    if (reuse && value && IsShareableXamlValue(value)) {
+        m_xamlValueCache.Put(static_cast<int>(kind), className, propertyName,
+                             xaml, value);
+    }
+
+    return value;
+}
+
+void CMainDlg::LoadMetadataCache() {
+    auto start = std::chrono::steady_clock::now();
+
+    m_metadataCacheKey = GetMetadataCacheKey();
+
+    // The file is used as is, a file of a different key or version is
+    // ignored and replaced on save.
+    CAtlFile file;
+    if (SUCCEEDED(file.Create(GetMetadataCachePath(m_metadataCacheKey).c_str(),
+                              GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              OPEN_EXISTING)) &&
+        SUCCEEDED(m_metadataCacheMapping.MapFile(file)) &&
+        !m_metadataCache.Load(m_metadataCacheMapping.GetData(),
+                              m_metadataCacheMapping.GetMappingSize(),
+                              m_metadataCacheKey)) {
+        m_metadataCacheMapping.Unmap();
+    }
+
+    m_metadataCacheLoadTime = std::chrono::steady_clock::now() - start;
+}
+
+void CMainDlg::SaveMetadataCache() {
+    if (!m_metadataCache.Modified()) {
+        return;
+    }
+
+    auto path = GetMetadataCachePath(m_metadataCacheKey);
+    if (path.empty()) {
+        return;
+    }
+
+    auto data = m_metadataCache.Serialize(m_metadataCacheKey);
+
+    // The file can't be replaced while it's mapped.
+    m_metadataCache.Unload();
+    m_metadataCacheMapping.Unmap();
+
+    // Written to a temporary file first, so that another session never maps
+    // a partially written file. Failures are ignored, e.g. if the folder
+    // isn't writable for the app.
+    auto tempPath = std::format(L"{}.{}.tmp", path, GetCurrentProcessId());
+
+    CAtlFile file;
+    if (FAILED(
+            file.Create(tempPath.c_str(), GENERIC_WRITE, 0, CREATE_ALWAYS))) {
+        return;
+    }
+
+    HRESULT hr = file.Write(data.data(), static_cast<DWORD>(data.size()));
+    file.Close();
+
+    if (FAILED(hr) || !MoveFileEx(tempPath.c_str(), path.c_str(),
+                                  MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFile(tempPath.c_str());
+    }
+}
+
+ObjectKind CMainDlg::ObjectKindOf(const wf::IInspectable& object,
+                                  std::wstring_view className) {
+    return m_objectKindCache.Get(className, [this, &object, className] {
+        auto start = std::chrono::steady_clock::now();
+
+        // A kind of a previous session is confirmed with a single probe
+        // instead of probing all known interfaces.
+        ObjectKind kind = ObjectKind::Other;
+        auto cachedKind = className.empty()
+                              ? std::nullopt
+                              : m_metadataCache.FindObjectKind(className);
+        if (cachedKind &&
+            ObjectHasKind(object, static_cast<ObjectKind>(*cachedKind))) {
+            kind = static_cast<ObjectKind>(*cachedKind);
+            if (kind != ObjectKind::Other) {
+                m_objectKindProbesSaved += ClassifyObjectProbeCount(kind) - 1;
+            }
+        } else {
+            if (cachedKind) {
+                m_metadataCache.EraseObjectKind(className);
+            }
+
+            kind = ClassifyObject(object);
+            m_metadataCache.PutObjectKind(className,
+                                          static_cast<std::int32_t>(kind));
+        }
+
+        m_objectKindProbeTime += std::chrono::steady_clock::now() - start;
+        return kind;
+    });
+}
+
+bool CMainDlg::IsRootElement(InstanceHandle handle) {
+    auto it = m_elementItems.find(handle);
+    return it != m_elementItems.end() && !it->second.parentHandle;
+}
+
+bool CMainDlg::SelectElement(InstanceHandle handle) {
+    auto it = m_elementItems.find(handle);
+    if (it == m_elementItems.end()) {
+        return false;
+    }
+
+    auto treeItem = it->second.treeItem;
+    if (!treeItem) {
+        return false;
+    }
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    treeView.SelectItem(treeItem);
+    treeView.EnsureVisible(treeItem);
+    return true;
+}
+
+bool CMainDlg::CreateFlashArea(InstanceHandle handle) {
+    InstanceHandle rootHandle = m_ancestorIndex.Root(handle);
+    if (!rootHandle || !m_ancestorIndex.IsAttached(handle)) {
+        ATLASSERT(FALSE);
+        return false;
+    }
+
+    wf::IInspectable element;
+    ObjectKind kind = ObjectKind::Other;
+    wf::IInspectable rootElement;
+    ObjectKind rootKind;
+
+    HRESULT hr =
+        InspectableFromHandle(rootHandle, &rootElement, nullptr, &rootKind);
+    if (FAILED(hr) || !rootElement) {
+        return false;
+    }
+
+    if (handle != rootHandle) {
+        hr = InspectableFromHandle(handle, &element, nullptr, &kind);
+        if (FAILED(hr) || !element) {
+            return false;
+        }
+    }
+
+    CWindow rootWnd;
+    CRect rootElementRect;
+    if (auto rect =
+            GetRootElementRect(rootElement, rootKind, &rootWnd.m_hWnd)) {
+        rootElementRect = *rect;
+    }
+
+    CRect rect;
+    if (element) {
+        auto elementRect = GetRelativeElementRect(element, kind);
+        if (!elementRect) {
+            return false;
+        }
+
+        rect = *elementRect;
+        rect.OffsetRect(rootElementRect.TopLeft());
+    } else {
+        rect = *rootElementRect;
+    }
+
+    if (rootWnd) {
+        UINT dpi = ::GetDpiForWindow(rootWnd);
+        CRect rectWithDpi;
+        rectWithDpi.left = MulDiv(rect.left, dpi, 96);
+        rectWithDpi.top = MulDiv(rect.top, dpi, 96);
+        // Round width and height, not right and bottom, for consistent results.
+        rectWithDpi.right =
+            rectWithDpi.left + MulDiv(rect.right - rect.left, dpi, 96);
+        rectWithDpi.bottom =
+            rectWithDpi.top + MulDiv(rect.bottom - rect.top, dpi, 96);
+
+        rect = rectWithDpi;
+    }
+
+    DestroyFlashArea();
+
+    if (rect.IsRectEmpty()) {
+        return true;
+    }
+
+    m_flashAreaWindow =
+        FlashArea(m_hWnd, _Module.GetModuleInstance(), rect, IsWindowVisible());
+    if (!m_flashAreaWindow) {
+        return false;
+    }
+
+    return true;
+}
+
+void CMainDlg::DestroyFlashArea() {
+    if (m_flashAreaWindow) {
+        m_flashAreaWindow.DestroyWindow();
+    }
+}
+
+LRESULT CMainDlg::OnElementTreeSelChanged(LPNMHDR pnmh) {
+    NMTREEVIEW* pnmtv = (NMTREEVIEW*)pnmh;
+
+    switch (pnmtv->action) {
+        case TVC_BYKEYBOARD:
+            LoadSelectedElementDetails();
+            break;
+
+        case TVC_BYMOUSE:
+            SetSelectedElementInformation();
+            break;
+
+        default:
+            // Action is TVC_UNKNOWN when the selection is changed after the
+            // previous selection was deleted. Use a delay since the app might
+            // be busy deleting many items at once.
+            SetTimer(TIMER_ID_SET_SELECTED_ELEMENT_INFORMATION,
+                     kRedrawTreeDelay);
+            break;
+    }
+
+    return 0;
+}
+
+void CMainDlg::OnElementFilterChange(UINT uNotifyCode,
+                                     int nID,
+                                     CWindow wndCtl) {
+    SetTimer(TIMER_ID_APPLY_ELEMENT_FILTER, kElementFilterDelay);
+}
+
+void CMainDlg::OnSplitToggle(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    m_splitModeAttributesExpanded = !m_splitModeAttributesExpanded;
+    wndCtl.SetWindowText(m_splitModeAttributesExpanded ? L">" : L"<");
+
+    // Below is a very ugly hack to switch to another DlgResize layout.
+
+    CRect rectDlg;
+    GetClientRect(&rectDlg);
+
+    SetWindowPos(nullptr, 0, 0, m_sizeDialog.cx, m_sizeDialog.cy,
+                 SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+
+    DlgResize_Init();
+
+    ResizeClient(rectDlg.right, rectDlg.bottom);
+}
+
+LRESULT CMainDlg::OnDetailsTabsSelChange(LPNMHDR pnmh) {
+    auto detailsTabs = CTabCtrl(GetDlgItem(IDC_DETAILS_TABS));
+    int index = detailsTabs.GetCurSel();
+
+    auto attributeFilterEdit = CEdit(GetDlgItem(IDC_ATTRIBUTE_FILTER));
+    attributeFilterEdit.ShowWindow(index == 0 ? SW_SHOW : SW_HIDE);
+
+    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+    attributesList.ShowWindow(index == 0 ? SW_SHOW : SW_HIDE);
+
+    auto visualStatesList = CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
+    visualStatesList.ShowWindow(index == 1 ? SW_SHOW : SW_HIDE);
+
+    return 0;
+}
+
+void CMainDlg::OnAttributeFilterChange(UINT uNotifyCode,
+                                       int nID,
+                                       CWindow wndCtl) {
+    SetTimer(TIMER_ID_APPLY_ATTRIBUTE_FILTER, kAttributeFilterDelay);
+}
+
+LRESULT CMainDlg::OnAttributeListDblClk(LPNMHDR pnmh) {
+    auto itemActivate = reinterpret_cast<LPNMITEMACTIVATE>(pnmh);
+    if (itemActivate->iItem < 0 ||
+        itemActivate->iItem >= static_cast<int>(m_attributeRows.size()) ||
+        (itemActivate->iSubItem != 0 && itemActivate->iSubItem != 1)) {
+        return 0;
+    }
+
+    const auto& row = m_attributeRows[itemActivate->iItem];
+
+    if (itemActivate->iSubItem == 0) {
+        unsigned int clickedPropertyIndex =
+            m_attributesChain->Values()[row.valueIndex].index;
+
+        auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
+        int index = CB_ERR;
+
+        int propertiesCount = propertiesComboBox.GetCount();
+        for (int i = 0; i < propertiesCount; i++) {
+            unsigned int propertyIndex =
+                static_cast<unsigned int>(propertiesComboBox.GetItemData(i));
+            if (propertyIndex == clickedPropertyIndex) {
+                index = i;
+                break;
+            }
+        }
+
+        if (index != CB_ERR) {
+            propertiesComboBox.SetCurSel(index);
+            propertiesComboBox.GetLBText(index, m_lastPropertySelection);
+        }
+    } else if (itemActivate->iSubItem == 1) {
+        if (row.valueShownAsIs) {
+            std::wstring buffer;
+            auto itemValue =
+                AttributeRowValue(*m_attributesChain, row, &buffer);
+
+            auto propertyValueEdit = CEdit(GetDlgItem(IDC_PROPERTY_VALUE));
+            propertyValueEdit.SetWindowText(
+                CString(itemValue.data(), static_cast<int>(itemValue.size())));
+
+            auto propertyValueXamlCheckbox =
+                CButton(GetDlgItem(IDC_PROPERTY_IS_XAML));
+            if (propertyValueXamlCheckbox.GetCheck() != BST_UNCHECKED) {
+                propertyValueXamlCheckbox.SetCheck(BST_UNCHECKED);
+                propertyValueEdit.ShowWindow(SW_SHOW);
+                auto propertyValueEditXaml =
+                    CEdit(GetDlgItem(IDC_PROPERTY_VALUE_XAML));
+                propertyValueEditXaml.ShowWindow(SW_HIDE);
+            }
+        }
+    }
+
+    return 0;
+}
+
+LRESULT CMainDlg::OnAttributeListGetDispInfo(LPNMHDR pnmh) {
+    auto& item = reinterpret_cast<NMLVDISPINFO*>(pnmh)->item;
+    if (!(item.mask & LVIF_TEXT) || item.cchTextMax <= 0) {
+        return 0;
+    }
+
+    std::wstring_view text;
+    std::wstring formatted;
+
+    if (!m_attributesListMessage.empty()) {
+        if (item.iItem == 0 && item.iSubItem == 0) {
+            text = m_attributesListMessage;
+        }
+    } else if (item.iItem >= 0 &&
+               item.iItem < static_cast<int>(m_attributeRows.size())) {
+        text = AttributeCellText(*m_attributesChain,
+                                 m_attributeRows[item.iItem],
+                                 AttributeColumn(item.iSubItem), &formatted);
+    }
+
+    size_t length =
+        std::min(text.size(), static_cast<size_t>(item.cchTextMax - 1));
+    std::copy_n(text.data(), length, item.pszText);
+    item.pszText[length] = L'\0';
+
+    return 0;
+}
+
+void CMainDlg::OnPropertyNameSelChange(UINT uNotifyCode,
+                                       int nID,
+                                       CWindow wndCtl) {
+    auto propertiesComboBox = CComboBox(wndCtl);
+    int index = propertiesComboBox.GetCurSel();
+    if (index != CB_ERR) {
+        propertiesComboBox.GetLBText(index, m_lastPropertySelection);
+    }
+}
+
+void CMainDlg::OnPropertyIsXaml(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    bool checked = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+
+    auto propertyValueEdit = CEdit(GetDlgItem(IDC_PROPERTY_VALUE));
+    auto propertyValueEditXaml = CEdit(GetDlgItem(IDC_PROPERTY_VALUE_XAML));
+
+    propertyValueEdit.ShowWindow(checked ? SW_HIDE : SW_SHOW);
+    propertyValueEditXaml.ShowWindow(checked ? SW_SHOW : SW_HIDE);
+}
+
+void CMainDlg::OnPropertyRemove(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    // The property names must be of the selected element.
+    CompleteSelectedElementDetails();
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (!selectedItem) {
+        return;
+    }
+
+    auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+
+    unsigned int propertyIndex;
     CString propertyName;
     CString propertyType;
+    if (!GetSelectedProperty(&propertyIndex, &propertyName, &propertyType)) {
+        return;
+    }
+
+    EditBatch batch;
+    batch.Add({
+        .elements = {handle},
+        .propertyIndex = propertyIndex,
+        .value = {.local = false},
+    });
+    ApplyEditBatch(batch, std::format(L"Clear {}", propertyName.GetString()));
+}
+
+bool CMainDlg::GetSelectedProperty(unsigned int* propertyIndex,
+                                   CString* propertyName,
+                                   CString* propertyType) {
+    auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
+
+    int propertiesComboBoxIndex = propertiesComboBox.GetCurSel();
+    if (propertiesComboBoxIndex == CB_ERR) {
+        return false;
+    }
+
+    CString propertyNameAndType;
+    propertiesComboBox.GetLBText(propertiesComboBoxIndex, propertyNameAndType);
+    *propertyIndex = static_cast<unsigned int>(
+        propertiesComboBox.GetItemData(propertiesComboBoxIndex));
+
+    propertyName->Empty();
+    propertyType->Empty();
     if (int pos = propertyNameAndType.ReverseFind(L'('); pos != -1) {
         if (pos >= 2 && propertyNameAndType.GetLength() - pos >= 3 &&
             propertyNameAndType[pos - 1] == L' ' &&
             propertyNameAndType[propertyNameAndType.GetLength() - 1] == L')') {
-            propertyName = propertyNameAndType.Left(pos - 1);
-            propertyType = propertyNameAndType.Mid(
+            *propertyName = propertyNameAndType.Left(pos - 1);
+            *propertyType = propertyNameAndType.Mid(
                 pos + 1, propertyNameAndType.GetLength() - pos - 2);
         }
     }
 
-    if (propertyName.IsEmpty() || propertyType.IsEmpty()) {
+    if (propertyName->IsEmpty() || propertyType->IsEmpty()) {
         MessageBox(L"Something went wrong", L"Error");
+        return false;
+    }
+
+    return true;
+}
+
+void CMainDlg::OnPropertySet(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    // The property names must be of the selected element.
+    CompleteSelectedElementDetails();
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (!selectedItem) {
+        return;
+    }
+
+    auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+
+    unsigned int propertyIndex;
+    CString propertyName;
+    CString propertyType;
+    if (!GetSelectedProperty(&propertyIndex, &propertyName, &propertyType)) {
         return;
     }
 
-    InstanceHandle newValueHandle;
+    EditBatch::PropertyValue newValue{.local = true};
     HRESULT hr = S_OK;
     std::wstring errorExtraMsg;
 
@@ -1139,18 +2499,20 @@ void CMainDlg::OnPropertySet(UINT uNotifyCode, int nID, CWindow wndCtl) {
 
         try {
             wf::IInspectable obj;
-            winrt::check_hresult(m_xamlDiagnostics->GetIInspectableFromHandle(
-                handle,
-                reinterpret_cast<::IInspectable**>(winrt::put_abi(obj))));
+            std::wstring className;
+            ObjectKind kind;
+            winrt::check_hresult(
+                InspectableFromHandle(handle, &obj, &className, &kind));
 
-            auto value = StyleValueFromXaml(
-                obj,
+            auto value = StyleValueFromXamlCached(
+                kind, className,
                 {propertyName.GetString(), (size_t)propertyName.GetLength()},
+                {propertyType.GetString(), (size_t)propertyType.GetLength()},
                 {propertyXaml.GetString(), (size_t)propertyXaml.GetLength()});
 
             winrt::check_hresult(m_xamlDiagnostics->RegisterInstance(
                 static_cast<IInspectable*>(winrt::get_abi(value)),
-                &newValueHandle));
+                &newValue.valueHandle));
         } catch (winrt::hresult_error const& ex) {
             hr = winrt::to_hresult();
             errorExtraMsg = ex.message();
@@ -1162,13 +2524,8 @@ void CMainDlg::OnPropertySet(UINT uNotifyCode, int nID, CWindow wndCtl) {
         auto propertyValueEdit = CEdit(GetDlgItem(IDC_PROPERTY_VALUE));
         propertyValueEdit.GetWindowText(propertyValue);
 
-        hr = m_visualTreeService->CreateInstance(
-            _bstr_t(propertyType), _bstr_t(propertyValue), &newValueHandle);
-    }
-
-    if (SUCCEEDED(hr)) {
-        hr = m_visualTreeService->SetProperty(handle, newValueHandle,
-                                              propertyIndex);
+        newValue.type = propertyType.GetString();
+        newValue.value = propertyValue.GetString();
     }
 
     if (FAILED(hr)) {
@@ -1181,7 +2538,300 @@ void CMainDlg::OnPropertySet(UINT uNotifyCode, int nID, CWindow wndCtl) {
         return;
     }
 
+    EditBatch batch;
+    batch.Add({
+        .elements = {handle},
+        .propertyIndex = propertyIndex,
+        .value = std::move(newValue),
+    });
+    ApplyEditBatch(batch, std::format(L"Set {}", propertyName.GetString()));
+}
+
+void CMainDlg::SetPropertyInSubtree(InstanceHandle rootHandle) {
+    // The property names must be of the selected element.
+    CompleteSelectedElementDetails();
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (!selectedItem) {
+        return;
+    }
+
+    auto selectedHandle = static_cast<InstanceHandle>(selectedItem.GetData());
+    auto itSelected = m_elementItems.find(selectedHandle);
+    if (itSelected == m_elementItems.end()) {
+        return;
+    }
+
+    // The property index is only valid for elements of the same type.
+    auto typeOfTitle = [](std::wstring_view itemTitle) {
+        return itemTitle.substr(0, itemTitle.find(L" - "));
+    };
+
+    UINT64 typeHash = itSelected->second.typeHash;
+    std::wstring selectedType(typeOfTitle(itSelected->second.itemTitle));
+
+    unsigned int propertyIndex;
+    CString propertyName;
+    CString propertyType;
+    if (!GetSelectedProperty(&propertyIndex, &propertyName, &propertyType)) {
+        return;
+    }
+
+    CString propertyValue;
+    GetDlgItem(IDC_PROPERTY_VALUE).GetWindowText(propertyValue);
+
+    EditBatch::Operation operation{
+        .propertyIndex = propertyIndex,
+        .value =
+            {
+                .local = true,
+                .type = propertyType.GetString(),
+                .value = propertyValue.GetString(),
+            },
+    };
+
+    std::vector<InstanceHandle> pending{rootHandle};
+    while (!pending.empty()) {
+        InstanceHandle handle = pending.back();
+        pending.pop_back();
+
+        if (auto it = m_elementItems.find(handle);
+            it != m_elementItems.end() && it->second.typeHash == typeHash &&
+            typeOfTitle(it->second.itemTitle) == selectedType) {
+            operation.elements.push_back(handle);
+        }
+
+        if (auto it = m_parentToChildren.find(handle);
+            it != m_parentToChildren.end()) {
+            pending.insert(pending.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    if (operation.elements.empty()) {
+        auto msg =
+            std::format(L"There are no {} elements in the subtree", selectedType);
+        MessageBox(msg.c_str(), L"Error");
+        return;
+    }
+
+    auto description =
+        std::format(L"Set {} on {} elements", propertyName.GetString(),
+                    operation.elements.size());
+
+    EditBatch batch;
+    batch.Add(std::move(operation));
+    ApplyEditBatch(batch, std::move(description));
+}
+
+bool CMainDlg::ApplyEditBatch(const EditBatch& batch,
+                              std::wstring journalDescription) {
+    struct Service {
+        CMainDlg* dlg;
+        // Value objects are kept alive until the batch is done, so that their
+        // handles stay valid for a rollback, and then by the edit journal.
+        std::unordered_map<InstanceHandle, wf::IInspectable> valueObjects;
+        // Values which were taken from the value instance cache.
+        std::unordered_map<InstanceHandle, std::pair<CString, CString>>
+            cachedValues;
+
+        EditBatch::Status CreateValue(const std::wstring& type,
+                                      const std::wstring& value,
+                                      EditBatch::Handle* valueHandle) {
+            CString typeStr(type.c_str());
+            CString valueStr(value.c_str());
+            bool cached;
+            HRESULT hr = dlg->CreateValueInstance(typeStr, valueStr,
+                                                  valueHandle, &cached);
+            if (SUCCEEDED(hr) && cached) {
+                cachedValues.try_emplace(*valueHandle, std::move(typeStr),
+                                         std::move(valueStr));
+            }
+
+            return hr;
+        }
+
+        EditBatch::Status GetPreviousValue(
+            EditBatch::Handle element,
+            std::uint32_t propertyIndex,
+            EditBatch::PropertyValue* previous) {
+            // Always fetched, since the value is restored on undo and a cached
+            // chain might be outdated.
+            HRESULT hr;
+            auto chain = LoadPropertyChain(dlg->m_visualTreeService.get(),
+                                           element, &hr);
+            if (!chain) {
+                return hr;
+            }
+
+            for (const auto& v : chain->Values()) {
+                const auto* source = chain->SourceOf(v);
+                if (v.index != propertyIndex || !source ||
+                    source->source != BaseValueSourceLocal) {
+                    continue;
+                }
+
+                // A local null value can't be created, it's restored by
+                // clearing the property.
+                if (v.metadataBits & IsValueNull) {
+                    break;
+                }
+
+                previous->local = true;
+                if (v.metadataBits & IsValueHandle) {
+                    previous->valueHandle = static_cast<InstanceHandle>(
+                        std::wcstoll(chain->CStr(v.value), nullptr, 10));
+                    HRESULT hr = KeepAlive(previous->valueHandle);
+                    if (FAILED(hr)) {
+                        return hr;
+                    }
+                } else {
+                    previous->type = chain->View(v.valueType);
+                    previous->value = chain->View(v.value);
+                }
+
+                break;
+            }
+
+            return S_OK;
+        }
+
+        EditBatch::Status SetValue(EditBatch::Handle element,
+                                   std::uint32_t propertyIndex,
+                                   EditBatch::Handle valueHandle) {
+
+            HRESULT hr = dlg->m_visualTreeService->SetProperty(
+                element, valueHandle, propertyIndex);
+            if (FAILED(hr)) {
+                // The cached instance might not be usable anymore, retry once
+                // with a new one.
+                auto it = cachedValues.find(valueHandle);
+                if (it != cachedValues.end()) {
+                    const auto& [type, value] = it->second;
+                    dlg->m_valueInstanceCache.Invalidate(
+                        {type.GetString(), (size_t)type.GetLength()},
+                        {value.GetString(), (size_t)value.GetLength()});
+
+                    bool cached;
+                    hr = dlg->CreateValueInstance(type, value, &valueHandle,
+                                                  &cached);
+                    if (SUCCEEDED(hr)) {
+                        hr = dlg->m_visualTreeService->SetProperty(
+                            element, valueHandle, propertyIndex);
+                    }
+                }
+            }
+
+            return hr;
+        }
+
+        EditBatch::Status ClearValue(EditBatch::Handle element,
+                                     std::uint32_t propertyIndex) {
+            return dlg->m_visualTreeService->ClearProperty(element,
+                                                           propertyIndex);
+        }
+
+        HRESULT KeepAlive(InstanceHandle valueHandle) {
+            if (valueObjects.contains(valueHandle)) {
+                return S_OK;
+            }
+
+            wf::IInspectable valueObject;
+            HRESULT hr = dlg->InspectableFromHandle(valueHandle, &valueObject);
+            if (SUCCEEDED(hr)) {
+                valueObjects.emplace(valueHandle, std::move(valueObject));
+            }
+
+            return hr;
+        }
+    };
+
+    Service service{.dlg = this};
+
+    // E.g. values parsed from XAML, which are needed for a redo.
+    for (const auto& operation : batch.Operations()) {
+        if (operation.value.valueHandle) {
+            service.KeepAlive(operation.value.valueHandle);
+        }
+    }
+
+    // All edits are made in this call, without processing messages in
+    // between, so that the app handles the changes, e.g. with a layout pass,
+    // once.
+    auto result = batch.Apply(service);
+
+    for (const auto& operation : batch.Operations()) {
+        for (InstanceHandle element : operation.elements) {
+            InvalidatePropertyChains(element);
+        }
+    }
+
+    // An edit can also change the values of other elements, such as the layout
+    // of the ancestors and siblings, so none of the cached chains are kept.
+    m_propertyChainCache.Clear();
+
+    if (result.status < 0) {
+        auto errorMsg =
+            std::format(L"Error {:08X}", static_cast<DWORD>(result.status));
+        if (result.rolledBack) {
+            errorMsg += L"\nThe changes were rolled back";
+            if (result.rollbackFailures) {
+                errorMsg += std::format(L", {} of them couldn't be restored",
+                                        result.rollbackFailures);
+            }
+        }
+
+        MessageBox(errorMsg.c_str(), L"Error");
+    } else if (!journalDescription.empty()) {
+        m_editJournal.Record({
+            .description = std::move(journalDescription),
+            .edits = std::move(result.edits),
+        });
+
+        m_editJournalObjects.merge(service.valueObjects);
+        PruneEditJournalObjects();
+    }
+
     RefreshSelectedElementInformation();
+    return result.status >= 0;
+}
+
+void CMainDlg::PruneEditJournalObjects() {
+    std::unordered_set<InstanceHandle> referenced;
+    m_editJournal.ForEachValueHandle(
+        [&referenced](InstanceHandle handle) { referenced.insert(handle); });
+
+    std::erase_if(m_editJournalObjects, [&referenced](const auto& item) {
+        return !referenced.contains(item.first);
+    });
+}
+
+void CMainDlg::UndoEdit() {
+    if (m_editJournal.CanUndo() &&
+        ApplyEditBatch(m_editJournal.UndoBatch(), {})) {
+        m_editJournal.Undone();
+    }
+}
+
+void CMainDlg::RedoEdit() {
+    if (m_editJournal.CanRedo() &&
+        ApplyEditBatch(m_editJournal.RedoBatch(), {})) {
+        m_editJournal.Redone();
+    }
+}
+
+void CMainDlg::RevertEdits(InstanceHandle rootHandle) {
+    auto batch = m_editJournal.RevertBatch(
+        [this, rootHandle](InstanceHandle element) {
+            return element == rootHandle ||
+                   m_ancestorIndex.IsAncestor(rootHandle, element);
+        });
+    if (batch.Empty()) {
+        return;
+    }
+
+    ApplyEditBatch(batch,
+                   std::format(L"Revert {} edits", batch.EditCount()));
 }
 
 void CMainDlg::OnCollapseAll(UINT uNotifyCode, int nID, CWindow wndCtl) {
@@ -1208,67 +2858,241 @@ void CMainDlg::OnCollapseAll(UINT uNotifyCode, int nID, CWindow wndCtl) {
 
         m_listCollapsed = !m_listCollapsed;
 
-        if (!m_redrawTreeQueued) {
-            treeView.SetRedraw(TRUE);
+        if (!m_redrawTreeQueued) {
+            treeView.SetRedraw(TRUE);
+        }
+    }
+}
+
+void CMainDlg::OnHighlightSelection(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    m_highlightSelection = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+
+    DestroyFlashArea();
+
+    if (m_highlightSelection) {
+        auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+        auto selectedItem = treeView.GetSelectedItem();
+        if (selectedItem) {
+            auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+            CreateFlashArea(handle);
+        }
+    }
+}
+
+void CMainDlg::OnDetailedProperties(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    m_detailedProperties = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+
+    ResetAttributesListColumns();
+    RepopulateAttributesList();
+}
+
+void CMainDlg::OnAppAbout(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    CAboutDlg dlgAbout;
+    dlgAbout.DoModal(m_hWnd);
+}
+
+void CMainDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    Hide();
+}
+
+LRESULT CMainDlg::OnActivateWindow(UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    Show();
+    ::SetForegroundWindow(m_hWnd);
+    return 0;
+}
+
+LRESULT CMainDlg::OnDestroyWindow(UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    DestroyWindow();
+    return 0;
+}
+
+void CMainDlg::ElementTreeOnChar(TCHAR chChar, UINT nRepCnt, UINT nFlags) {
+    if (chChar == 4) {
+        // Ctrl+D.
+        SelectElementFromCursor();
+    } else if (chChar == 26) {
+        // Ctrl+Z.
+        UndoEdit();
+    } else if (chChar == 25) {
+        // Ctrl+Y.
+        RedoEdit();
+    } else {
+        SetMsgHandled(FALSE);
+    }
+}
+
+void CMainDlg::UpdateTitle() {
+    auto title = std::format(L"UWPSpy - PID: {} TID: {}",
+                             GetCurrentProcessId(), GetCurrentThreadId());
+
+    if (m_scopeHandle) {
+        title += std::format(L" - Scoped ({} mutations outside of scope)",
+                             m_outOfScopeMutationCount);
+    }
+
+    SetWindowText(title.c_str());
+}
+
+void CMainDlg::SetScope(InstanceHandle handle) {
+    if (handle == m_scopeHandle) {
+        return;
+    }
+
+    m_scopeHandle = handle;
+    m_outOfScopeMutationCount = 0;
+
+    if (m_scopeHandle) {
+        SetTimer(TIMER_ID_UPDATE_TITLE, kUpdateTitleDelay);
+    } else {
+        KillTimer(TIMER_ID_UPDATE_TITLE);
+    }
+
+    UpdateTitle();
+    RebuildTree();
+}
+
+void CMainDlg::RebuildTree() {
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+
+    InstanceHandle selectedHandle = 0;
+    if (auto selectedItem = treeView.GetSelectedItem()) {
+        selectedHandle = static_cast<InstanceHandle>(selectedItem.GetData());
+    }
+
+    RedrawTreeQueue();
+
+    treeView.DeleteAllItems();
+
+    for (auto& [handle, elementItem] : m_elementItems) {
+        elementItem.treeItem = nullptr;
+    }
+
+    bool filtered = !m_elementFilter.IsEmpty();
+
+    if (m_scopeHandle) {
+        auto it = m_elementItems.find(m_scopeHandle);
+        if (it != m_elementItems.end() &&
+            (!filtered || m_elementFilterVisibleHandles.contains(it->first))) {
+            AddItemToTree(nullptr, TVI_LAST, m_scopeHandle, &it->second);
+        }
+    } else if (auto it = m_parentToChildren.find(0);
+               it != m_parentToChildren.end()) {
+        for (const auto& rootHandle : it->second) {
+            if (filtered && !m_elementFilterVisibleHandles.contains(rootHandle)) {
+                continue;
+            }
+
+            auto rootElementItem = m_elementItems.find(rootHandle);
+            if (rootElementItem == m_elementItems.end()) {
+                ATLASSERT(FALSE);
+                continue;
+            }
+
+            AddItemToTree(nullptr, TVI_LAST, rootHandle,
+                          &rootElementItem->second);
         }
     }
+
+    if (!selectedHandle || !SelectElement(selectedHandle)) {
+        treeView.SelectItem(treeView.GetRootItem());
+    }
+
+    m_redrawTreeQueuedEnsureSelectionVisible = true;
 }
 
-void CMainDlg::OnHighlightSelection(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    m_highlightSelection = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+void CMainDlg::ApplyElementFilter() {
+    CString filterText;
+    GetDlgItemText(IDC_ELEMENT_FILTER, filterText);
 
-    DestroyFlashArea();
+    TextSearch::Pattern filter(
+        {filterText.GetString(), static_cast<size_t>(filterText.GetLength())});
+    if (filter == m_elementFilter) {
+        return;
+    }
 
-    if (m_highlightSelection) {
-        auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
-        auto selectedItem = treeView.GetSelectedItem();
-        if (selectedItem) {
-            auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
-            CreateFlashArea(handle);
+    m_elementFilter = std::move(filter);
+    m_elementFilterVisibleHandles.clear();
+
+    if (!m_elementFilter.IsEmpty()) {
+        for (const auto& [handle, elementItem] : m_elementItems) {
+            if (!m_elementFilter.FoundIn(elementItem.itemTitle)) {
+                continue;
+            }
+
+            // Mark the element and its ancestors, stopping at the first
+            // ancestor which was already marked by another match.
+            InstanceHandle iterHandle = handle;
+            while (iterHandle &&
+                   m_elementFilterVisibleHandles.insert(iterHandle).second) {
+                auto it = m_elementItems.find(iterHandle);
+                if (it == m_elementItems.end()) {
+                    break;
+                }
+
+                iterHandle = it->second.parentHandle;
+            }
         }
     }
+
+    RebuildTree();
 }
 
-void CMainDlg::OnDetailedProperties(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    m_detailedProperties = CButton(wndCtl).GetCheck() != BST_UNCHECKED;
+void CMainDlg::ApplyAttributeFilter() {
+    CString filterText;
+    GetDlgItemText(IDC_ATTRIBUTE_FILTER, filterText);
 
-    ResetAttributesListColumns();
+    TextSearch::Pattern filter(
+        {filterText.GetString(), static_cast<size_t>(filterText.GetLength())});
+    if (filter == m_attributeFilter) {
+        return;
+    }
 
+    m_attributeFilter = std::move(filter);
+
+    // The rows of the shown element are filtered with the index. Otherwise,
+    // e.g. if the details of a new selection weren't loaded yet, the list is
+    // populated with the new filter.
     auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
     auto selectedItem = treeView.GetSelectedItem();
-    if (selectedItem && selectedItem.GetParent()) {
-        auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
-        PopulateAttributesList(handle);
+    if (m_attributesChain && selectedItem &&
+        static_cast<InstanceHandle>(selectedItem.GetData()) ==
+            m_attributesHandle) {
+        UpdateAttributesList(m_attributesChain,
+                             FilterAttributeRows(*m_attributesChain));
+        return;
     }
-}
 
-void CMainDlg::OnAppAbout(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    CAboutDlg dlgAbout;
-    dlgAbout.DoModal(m_hWnd);
+    RepopulateAttributesList();
 }
 
-void CMainDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
-    Hide();
-}
+std::vector<CMainDlg::AttributeRow> CMainDlg::FilterAttributeRows(
+    const PropertyChain& chain) {
+    if (m_attributeFilter.IsEmpty()) {
+        return m_attributeAllRows;
+    }
 
-LRESULT CMainDlg::OnActivateWindow(UINT uMsg, WPARAM wParam, LPARAM lParam) {
-    Show();
-    ::SetForegroundWindow(m_hWnd);
-    return 0;
-}
+    // Built on first use, since the class names of object values have to be
+    // resolved for it.
+    if (m_attributeFilterIndex.Size() != m_attributeAllRows.size()) {
+        m_attributeFilterIndex.Clear();
 
-LRESULT CMainDlg::OnDestroyWindow(UINT uMsg, WPARAM wParam, LPARAM lParam) {
-    DestroyWindow();
-    return 0;
-}
+        std::wstring buffer;
+        for (const auto& row : m_attributeAllRows) {
+            const auto& v = chain.Values()[row.valueIndex];
+            m_attributeFilterIndex.Add(chain.View(v.propertyName),
+                                       AttributeRowValue(chain, row, &buffer));
+        }
+    }
 
-void CMainDlg::ElementTreeOnChar(TCHAR chChar, UINT nRepCnt, UINT nFlags) {
-    if (chChar == 4) {
-        // Ctrl+D.
-        SelectElementFromCursor();
-    } else {
-        SetMsgHandled(FALSE);
+    const auto& matches = m_attributeFilterIndex.Filter(m_attributeFilter);
+
+    std::vector<AttributeRow> rows;
+    rows.reserve(matches.size());
+    for (auto i : matches) {
+        rows.push_back(m_attributeAllRows[i]);
     }
+
+    return rows;
 }
 
 void CMainDlg::RedrawTreeQueue() {
@@ -1298,30 +3122,51 @@ bool CMainDlg::SetSelectedElementInformation() {
         SetDlgItemText(IDC_NAME_EDIT, L"");
         SetDlgItemText(IDC_RECT_EDIT, L"");
 
-        auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
-        attributesList.DeleteAllItems();
+        ClearAttributesList();
 
         auto visualStatesTree =
             CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
         visualStatesTree.DeleteAllItems();
 
-        auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
-        propertiesComboBox.ResetContent();
+        SetPropertyNames(nullptr);
 
         DestroyFlashArea();
 
+        m_detailLoadScheduler.Cancel();
+        KillTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS);
+
         return false;
     }
 
     auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
-    bool hasParent = !!selectedItem.GetParent();
+
+    SetSelectedElementSummary(handle);
+    SetSelectedElementAttributes(handle);
+    SetSelectedElementVisualStates(handle);
+
+    // Everything is loaded, only prefetch the neighbors.
+    m_detailLoadScheduler.Request(handle, TreeNeighborHandles(selectedItem),
+                                  /*loadStages=*/false);
+    SetTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS, kPrefetchDelay);
+
+    return true;
+}
+
+void CMainDlg::SetSelectedElementSummary(InstanceHandle handle) {
+    // Not the same as having a parent tree item, the tree might be scoped.
+    bool hasParent = !IsRootElement(handle);
+
+    m_summaryHandle = handle;
+    m_summaryClassName.clear();
 
     wf::IInspectable obj;
+    ObjectKind kind = ObjectKind::Other;
     try {
-        winrt::check_hresult(m_xamlDiagnostics->GetIInspectableFromHandle(
-            handle, reinterpret_cast<::IInspectable**>(winrt::put_abi(obj))));
-        auto className = winrt::get_class_name(obj);
+        std::wstring className;
+        winrt::check_hresult(
+            InspectableFromHandle(handle, &obj, &className, &kind));
         SetDlgItemText(IDC_CLASS_EDIT, className.c_str());
+        m_summaryClassName = std::move(className);
     } catch (...) {
         obj = nullptr;
 
@@ -1332,11 +3177,10 @@ bool CMainDlg::SetSelectedElementInformation() {
 
     std::wstring frameworkElementName;
     try {
-        if (auto frameworkElement = obj.try_as<wux::FrameworkElement>()) {
-            frameworkElementName = frameworkElement.Name();
-        } else if (auto frameworkElement =
-                       obj.try_as<mux::FrameworkElement>()) {
-            frameworkElementName = frameworkElement.Name();
+        if (kind == ObjectKind::WuxFrameworkElement) {
+            frameworkElementName = obj.as<wux::FrameworkElement>().Name();
+        } else if (kind == ObjectKind::MuxFrameworkElement) {
+            frameworkElementName = obj.as<mux::FrameworkElement>().Name();
         }
     } catch (...) {
         HRESULT hr = winrt::to_hresult();
@@ -1348,8 +3192,8 @@ bool CMainDlg::SetSelectedElementInformation() {
 
     if (obj) {
         try {
-            auto rect = hasParent ? GetRelativeElementRect(obj)
-                                  : GetRootElementRect(obj);
+            auto rect = hasParent ? GetRelativeElementRect(obj, kind)
+                                  : GetRootElementRect(obj, kind);
             if (rect) {
                 auto rectStr = std::format(
                     L"({},{}) - ({},{})  -  {}x{}", rect->left, rect->top,
@@ -1365,288 +3209,800 @@ bool CMainDlg::SetSelectedElementInformation() {
             SetDlgItemText(IDC_RECT_EDIT, errorMsg.c_str());
         }
     } else {
-        SetDlgItemText(IDC_RECT_EDIT, L"");
+        SetDlgItemText(IDC_RECT_EDIT, L"");
+    }
+
+    DestroyFlashArea();
+
+    if (m_highlightSelection) {
+        CreateFlashArea(handle);
+    }
+}
+
+void CMainDlg::SetSelectedElementAttributes(InstanceHandle handle) {
+    if (IsRootElement(handle)) {
+        ClearAttributesList();
+        SetPropertyNames(nullptr);
+        return;
+    }
+
+    PopulateAttributesList(handle);
+}
+
+void CMainDlg::SetSelectedElementVisualStates(InstanceHandle handle) {
+    if (IsRootElement(handle)) {
+        auto visualStatesTree =
+            CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
+        visualStatesTree.DeleteAllItems();
+        return;
+    }
+
+    PopulateVisualStatesTree(handle);
+}
+
+void CMainDlg::LoadSelectedElementDetails() {
+    KillTimer(TIMER_ID_SET_SELECTED_ELEMENT_INFORMATION);
+    KillTimer(TIMER_ID_REFRESH_SELECTED_ELEMENT_INFORMATION);
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (!selectedItem) {
+        SetSelectedElementInformation();
+        return;
+    }
+
+    auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+    m_detailLoadScheduler.Request(handle, TreeNeighborHandles(selectedItem));
+    SetTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS, kLoadStageDelay);
+}
+
+void CMainDlg::RunDetailLoadTask() {
+    auto task = m_detailLoadScheduler.Next();
+    if (!task) {
+        KillTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS);
+        return;
+    }
+
+    using TaskKind = DetailLoadScheduler::TaskKind;
+
+    if (task->kind == TaskKind::Prefetch) {
+        InstanceHandle handle = task->handle;
+        std::uint64_t nowMs = GetTickCount64();
+        if (!m_propertyChainCache.Contains(handle, nowMs)) {
+            // Also fills the handle and object kind caches.
+            wf::IInspectable obj;
+            InspectableFromHandle(handle, &obj);
+
+            HRESULT hr = S_OK;
+            m_propertyChainCache.Get(handle, nowMs, [this, handle, &hr] {
+                return LoadPropertyChain(m_visualTreeService.get(), handle,
+                                         &hr);
+            });
+        }
+    } else {
+        // The element might have been removed since the request was made.
+        auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+        auto selectedItem = treeView.GetSelectedItem();
+        if (!selectedItem ||
+            static_cast<InstanceHandle>(selectedItem.GetData()) !=
+                task->handle) {
+            m_detailLoadScheduler.Cancel();
+        } else if (task->kind == TaskKind::Summary) {
+            SetSelectedElementSummary(task->handle);
+        } else if (task->kind == TaskKind::Attributes) {
+            SetSelectedElementAttributes(task->handle);
+        } else if (task->kind == TaskKind::VisualStates) {
+            SetSelectedElementVisualStates(task->handle);
+        }
+    }
+
+    if (m_detailLoadScheduler.HasPendingStages()) {
+        SetTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS, kLoadStageDelay);
+    } else if (m_detailLoadScheduler.HasPendingTasks()) {
+        SetTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS, kPrefetchDelay);
+    } else {
+        KillTimer(TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS);
+    }
+}
+
+void CMainDlg::CompleteSelectedElementDetails() {
+    while (m_detailLoadScheduler.HasPendingStages()) {
+        RunDetailLoadTask();
+    }
+}
+
+std::vector<InstanceHandle> CMainDlg::TreeNeighborHandles(CTreeItem item) {
+    std::vector<InstanceHandle> handles;
+
+    CTreeItem prev = item;
+    CTreeItem next = item;
+    for (size_t i = 0; i < kPrefetchNeighborCount; i++) {
+        // The next item first, since it's the most likely to be selected
+        // when going down the tree with the arrow keys.
+        if (next) {
+            next = next.GetNextVisible();
+        }
+
+        if (next) {
+            handles.push_back(static_cast<InstanceHandle>(next.GetData()));
+        }
+
+        if (prev) {
+            prev = prev.GetPrevVisible();
+        }
+
+        if (prev) {
+            handles.push_back(static_cast<InstanceHandle>(prev.GetData()));
+        }
+    }
+
+    // The attributes of root elements aren't shown.
+    std::erase_if(handles, [this](InstanceHandle handle) {
+        return IsRootElement(handle);
+    });
+
+    return handles;
+}
+
+bool CMainDlg::RefreshSelectedElementInformation(UINT delay) {
+    // Use a delay since some information is not available immediately after
+    // changing properties, such as the new element position and size.
+    if (delay > 0) {
+        SetTimer(TIMER_ID_REFRESH_SELECTED_ELEMENT_INFORMATION, delay);
+        return true;
+    }
+
+    // The attributes list keeps its scroll position, since the same element is
+    // shown.
+    return SetSelectedElementInformation();
+}
+
+void CMainDlg::ResetAttributesListColumns() {
+    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+
+    attributesList.SetRedraw(FALSE);
+
+    ClearAttributesList();
+
+    int firstColumnWidth = attributesList.GetColumnWidth(0);
+
+    if (attributesList.DeleteColumn(0)) {
+        while (attributesList.DeleteColumn(0)) {
+            // Keep deleting...
+        }
+    } else {
+        firstColumnWidth = 0;
+    }
+
+    // If columns existed, try to retain width.
+    int width = firstColumnWidth * 2;
+    if (!width) {
+        CRect rect;
+        attributesList.GetClientRect(rect);
+        width = rect.Width() - ::GetSystemMetrics(SM_CXVSCROLL);
+    }
+
+    int c = 0;
+
+    if (m_detailedProperties) {
+        attributesList.InsertColumn(c++, L"Name", LVCFMT_LEFT, width / 2);
+        attributesList.InsertColumn(c++, L"Value", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"Type", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"DeclaringType", LVCFMT_LEFT,
+                                    width / 3);
+        attributesList.InsertColumn(c++, L"ValueType", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"ItemType", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"Overridden", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"MetadataBits", LVCFMT_LEFT,
+                                    width / 3);
+        attributesList.InsertColumn(c++, L"Style TargetType", LVCFMT_LEFT,
+                                    width / 3);
+        attributesList.InsertColumn(c++, L"Style Name", LVCFMT_LEFT, width / 3);
+        attributesList.InsertColumn(c++, L"Style Source", LVCFMT_LEFT,
+                                    width / 3);
+    } else {
+        attributesList.InsertColumn(c++, L"Name", LVCFMT_LEFT, width / 2);
+        attributesList.InsertColumn(c++, L"Value", LVCFMT_LEFT, width / 2);
+    }
+
+    // Filled for watched properties.
+    attributesList.InsertColumn(c++, L"History", LVCFMT_LEFT, width / 3);
+
+    attributesList.SetRedraw(TRUE);
+}
+
+void CMainDlg::RepopulateAttributesList() {
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (selectedItem) {
+        auto handle = static_cast<InstanceHandle>(selectedItem.GetData());
+        if (!IsRootElement(handle)) {
+            PopulateAttributesList(handle);
+        }
+    }
+}
+
+void CMainDlg::ClearAttributesList() {
+    m_attributesHandle = 0;
+    m_attributesChain = nullptr;
+    m_attributeRows.clear();
+    m_attributeAllRows.clear();
+    m_attributeFilterIndex.Clear();
+    m_attributeValueClassNames.clear();
+    m_attributesListMessage.clear();
+
+    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+    attributesList.SetItemCount(0);
+}
+
+// Formatted text is stored in buffer.
+std::wstring_view CMainDlg::AttributeRowValue(const PropertyChain& chain,
+                                              const AttributeRow& row,
+                                              std::wstring* buffer) {
+    const auto& v = chain.Values()[row.valueIndex];
+
+    if (row.valueHandle) {
+        *buffer = std::format(
+            L"({}; {})",
+            (v.metadataBits & IsValueCollection) ? L"collection" : L"data",
+            AttributeValueClassName(row.valueHandle));
+        return *buffer;
+    }
+
+    if (!row.valueShownAsIs) {
+        return row.value;
+    }
+
+    return chain.View(v.value);
+}
+
+// Resolved on demand, so that populating the list doesn't resolve the objects
+// of all rows, most of which might never be shown.
+const std::wstring& CMainDlg::AttributeValueClassName(
+    InstanceHandle valueHandle) {
+    auto [it, inserted] = m_attributeValueClassNames.try_emplace(valueHandle);
+    if (inserted) {
+        wf::IInspectable valueObj;
+        HRESULT hr = InspectableFromHandle(valueHandle, &valueObj, &it->second);
+        if (FAILED(hr)) {
+            it->second = std::format(L"Error {:08X}", static_cast<DWORD>(hr));
+        }
+    }
+
+    return it->second;
+}
+
+// The columns of ResetAttributesListColumns. Formatted text is stored in
+// buffer.
+std::wstring_view CMainDlg::AttributeCellText(const PropertyChain& chain,
+                                              const AttributeRow& row,
+                                              int column,
+                                              std::wstring* buffer) {
+    const auto& v = chain.Values()[row.valueIndex];
+    const auto* src = chain.SourceOf(v);
+
+    std::wstring_view text;
+    switch (column) {
+        case 0:
+            text = chain.View(v.propertyName);
+            break;
+        case 1:
+            text = AttributeRowValue(chain, row, buffer);
+            break;
+        case 2:
+            text = chain.View(v.type);
+            break;
+        case 3:
+            text = chain.View(v.declaringType);
+            break;
+        case 4:
+            text = chain.View(v.valueType);
+            break;
+        case 5:
+            text = chain.View(v.itemType);
+            break;
+        case 6:
+            text = v.overridden ? L"Yes" : L"No";
+            break;
+        case 7:
+            *buffer = MetadataBitsToString(v.metadataBits);
+            text = *buffer;
+            break;
+        case 8:
+            if (src) {
+                text = chain.View(src->targetType);
+            }
+            break;
+        case 9:
+            if (src) {
+                text = chain.View(src->name);
+            }
+            break;
+        case 10:
+            *buffer = BaseValueSourceToString(
+                src ? static_cast<BaseValueSource>(src->source)
+                    : BaseValueSourceUnknown);
+            text = *buffer;
+            break;
+        case kAttributeHistoryColumn:
+            if (const auto* watch =
+                    m_propertyWatch.Find(m_attributesHandle, v.index)) {
+                *buffer = watch->history.Summary(kWatchSummaryPoints);
+                text = *buffer;
+            }
+            break;
+    }
+
+    return text;
+}
+
+int CMainDlg::AttributeColumn(int subItem) {
+    // The history column comes right after the name and value columns in
+    // the non-detailed view.
+    if (!m_detailedProperties && subItem >= 2) {
+        return kAttributeHistoryColumn;
+    }
+
+    return subItem;
+}
+
+void CMainDlg::OnAttributeListContextMenu(CPoint point) {
+    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+
+    int itemIndex;
+    CPoint menuPoint = point;
+    if (point.x == -1 && point.y == -1) {
+        // Keyboard context menu.
+        itemIndex = attributesList.GetNextItem(-1, LVNI_SELECTED);
+
+        CRect rect;
+        if (itemIndex != -1 &&
+            attributesList.GetItemRect(itemIndex, rect, LVIR_LABEL)) {
+            menuPoint = rect.CenterPoint();
+            attributesList.ClientToScreen(&menuPoint);
+        } else {
+            ::GetCursorPos(&menuPoint);
+        }
+    } else {
+        CPoint mappedPoint = point;
+        attributesList.ScreenToClient(&mappedPoint);
+        itemIndex = attributesList.HitTest(mappedPoint, nullptr);
     }
 
-    if (hasParent) {
-        PopulateAttributesList(handle);
-        PopulateVisualStatesTree(handle);
-    } else {
-        auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
-        attributesList.DeleteAllItems();
+    // Copied, since the list might be updated while the menu is shown.
+    InstanceHandle handle = m_attributesHandle;
+    std::optional<UINT32> propertyIndex;
+    std::wstring propertyName;
+    std::wstring propertyType;
+    if (m_attributesChain && itemIndex >= 0 &&
+        itemIndex < static_cast<int>(m_attributeRows.size())) {
+        const auto& v =
+            m_attributesChain->Values()[m_attributeRows[itemIndex].valueIndex];
+        propertyIndex = v.index;
+        propertyName = m_attributesChain->View(v.propertyName);
+        propertyType = m_attributesChain->View(v.type);
+    }
 
-        auto visualStatesTree =
-            CTreeViewCtrlEx(GetDlgItem(IDC_VISUAL_STATE_TREE));
-        visualStatesTree.DeleteAllItems();
+    bool watched =
+        propertyIndex && m_propertyWatch.Find(handle, *propertyIndex);
 
-        auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
-        propertiesComboBox.ResetContent();
-    }
+    CMenu menu;
+    menu.CreatePopupMenu();
 
-    DestroyFlashArea();
+    enum {
+        MENU_ID_REFRESH_VALUES = 1,
+        MENU_ID_WATCH,
+        MENU_ID_UNWATCH_ALL,
+        MENU_ID_REUSE_VALUES,
+        MENU_ID_WATCH_INTERVAL,
+    };
 
-    if (m_highlightSelection) {
-        CreateFlashArea(handle);
+    menu.AppendMenu(MF_STRING | (handle ? 0 : MF_GRAYED),
+                    MENU_ID_REFRESH_VALUES, L"Refresh values");
+    menu.AppendMenu(MF_SEPARATOR);
+    menu.AppendMenu(MF_STRING | (propertyIndex ? 0 : MF_GRAYED) |
+                        (watched ? MF_CHECKED : 0),
+                    MENU_ID_WATCH, L"Watch value");
+    menu.AppendMenu(MF_STRING | (m_propertyWatch.Count() ? 0 : MF_GRAYED),
+                    MENU_ID_UNWATCH_ALL, L"Stop watching all values");
+    menu.AppendMenu(MF_SEPARATOR);
+    for (size_t i = 0; i < std::size(kWatchIntervals); i++) {
+        bool checked = m_watchInterval == kWatchIntervals[i];
+        auto text = std::format(L"Sample every {} ms", kWatchIntervals[i]);
+        menu.AppendMenu(MF_STRING | (checked ? MF_CHECKED : 0),
+                        MENU_ID_WATCH_INTERVAL + i, text.c_str());
+    }
+    if (!propertyType.empty()) {
+        // Shared instances of mutable types, e.g. brushes which are animated
+        // by the app, can affect all elements they were set on.
+        bool reuse = !m_valueInstanceCache.IsExcluded(propertyType);
+        auto text = std::format(L"Reuse set values of type {}", propertyType);
+        menu.AppendMenu(MF_SEPARATOR);
+        menu.AppendMenu(MF_STRING | (reuse ? MF_CHECKED : 0),
+                        MENU_ID_REUSE_VALUES, text.c_str());
     }
 
-    return true;
-}
+    int nCmd = menu.TrackPopupMenu(TPM_RIGHTBUTTON | TPM_RETURNCMD,
+                                   menuPoint.x, menuPoint.y, m_hWnd);
+    if (nCmd == MENU_ID_REFRESH_VALUES && handle) {
+        // Bypasses the cache, the values might have changed since the chain
+        // was fetched.
+        m_propertyChainCache.Invalidate(handle);
+        RefreshSelectedElementInformation(0);
+    } else if (nCmd == MENU_ID_WATCH && propertyIndex) {
+        if (watched) {
+            m_propertyWatch.Unpin(handle, *propertyIndex);
+        } else {
+            wf::IInspectable obj;
+            ObjectKind kind = ObjectKind::Other;
+            InspectableFromHandle(handle, &obj, nullptr, &kind);
+
+            auto accessor = WatchAccessorForProperty(propertyName, kind);
+            m_propertyWatch.Pin(handle, *propertyIndex,
+                                std::move(propertyName),
+                                static_cast<int>(accessor));
+            SetTimer(TIMER_ID_SAMPLE_WATCHES, kWatchSliceDelay);
+        }
 
-bool CMainDlg::RefreshSelectedElementInformation(UINT delay) {
-    // Use a delay since some information is not available immediately after
-    // changing properties, such as the new element position and size.
-    if (delay > 0) {
-        SetTimer(TIMER_ID_REFRESH_SELECTED_ELEMENT_INFORMATION, delay);
-        return true;
+        attributesList.Invalidate();
+    } else if (nCmd == MENU_ID_UNWATCH_ALL) {
+        m_propertyWatch.Clear();
+        KillTimer(TIMER_ID_SAMPLE_WATCHES);
+        attributesList.Invalidate();
+    } else if (nCmd == MENU_ID_REUSE_VALUES) {
+        m_valueInstanceCache.SetExcluded(
+            propertyType, !m_valueInstanceCache.IsExcluded(propertyType));
+    } else if (nCmd >= MENU_ID_WATCH_INTERVAL &&
+               nCmd < MENU_ID_WATCH_INTERVAL +
+                          static_cast<int>(std::size(kWatchIntervals))) {
+        m_watchInterval = kWatchIntervals[nCmd - MENU_ID_WATCH_INTERVAL];
     }
+}
 
-    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
-    int attributesListTopIndex = attributesList.GetTopIndex();
-
-    if (!SetSelectedElementInformation()) {
-        return false;
+void CMainDlg::SampleWatches() {
+    if (!m_propertyWatch.Count()) {
+        KillTimer(TIMER_ID_SAMPLE_WATCHES);
+        return;
     }
 
-    ListViewSetTopIndex(attributesList, attributesListTopIndex);
-    return true;
-}
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t nowMs = GetTickCount64();
+
+    // Watches are ordered by element, so a chain fetched for one watch can be
+    // used for the next watches of the same element.
+    InstanceHandle chainHandle = 0;
+    std::shared_ptr<const PropertyChain> chain;
+    std::vector<InstanceHandle> fetchedChainHandles;
+
+    auto read = [&](const PropertyWatchEngine::Watch& watch)
+        -> std::optional<std::wstring> {
+        auto accessor = static_cast<WatchAccessor>(watch.accessor);
+        if (accessor != WatchAccessor::Chain) {
+            try {
+                wf::IInspectable obj;
+                ObjectKind kind;
+                winrt::check_hresult(
+                    InspectableFromHandle(watch.handle, &obj, nullptr, &kind));
+                if (IsWuxUIElement(kind)) {
+                    return ReadTypedProperty<wux::UIElement,
+                                             wux::FrameworkElement>(obj,
+                                                                    accessor);
+                } else if (IsMuxUIElement(kind)) {
+                    return ReadTypedProperty<mux::UIElement,
+                                             mux::FrameworkElement>(obj,
+                                                                    accessor);
+                }
+            } catch (...) {
+                // The element might have been removed.
+            }
 
-void CMainDlg::ResetAttributesListColumns() {
-    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+            return std::nullopt;
+        }
 
-    attributesList.SetRedraw(FALSE);
+        if (watch.handle != chainHandle) {
+            HRESULT hr = S_OK;
+            chainHandle = watch.handle;
+            chain = LoadPropertyChain(m_visualTreeService.get(), watch.handle,
+                                      &hr);
+
+            // A cached chain is outdated now, and the chain of the shown
+            // element is used right away. Other elements aren't added, as with
+            // the crawler.
+            if (chain) {
+                fetchedChainHandles.push_back(watch.handle);
+                if (watch.handle == m_attributesHandle ||
+                    m_propertyChainCache.Contains(watch.handle, nowMs)) {
+                    m_propertyChainCache.Put(watch.handle, chain, nowMs);
+                }
+            }
+        }
 
-    attributesList.DeleteAllItems();
+        if (!chain) {
+            return std::nullopt;
+        }
 
-    int firstColumnWidth = attributesList.GetColumnWidth(0);
+        for (const auto& v : chain->Values()) {
+            if (v.index == watch.propertyIndex && !v.overridden) {
+                return std::wstring(chain->View(v.value));
+            }
+        }
 
-    if (attributesList.DeleteColumn(0)) {
-        while (attributesList.DeleteColumn(0)) {
-            // Keep deleting...
+        return std::nullopt;
+    };
+
+    auto result = m_propertyWatch.Step(nowMs, read, [start] {
+        return std::chrono::steady_clock::now() - start >= kWatchSampleBudget;
+    });
+
+    for (auto handle : result.changedHandles) {
+        bool chainFetched =
+            std::find(fetchedChainHandles.begin(), fetchedChainHandles.end(),
+                      handle) != fetchedChainHandles.end();
+        if (!chainFetched) {
+            // Values read with typed accessors outdate the cached chain. The
+            // value column of the shown element is updated on its next
+            // refresh, the history column shows the new values meanwhile.
+            m_propertyChainCache.Invalidate(handle);
         }
-    } else {
-        firstColumnWidth = 0;
-    }
 
-    // If columns existed, try to retain width.
-    int width = firstColumnWidth * 2;
-    if (!width) {
-        CRect rect;
-        attributesList.GetClientRect(rect);
-        width = rect.Width() - ::GetSystemMetrics(SM_CXVSCROLL);
-    }
+        if (handle != m_attributesHandle || !m_attributesChain) {
+            continue;
+        }
 
-    int c = 0;
+        if (chainFetched) {
+            // The chain is taken from the cache, only the changed rows are
+            // updated.
+            PopulateAttributesList(handle);
+            if (!m_attributesChain) {
+                continue;
+            }
+        }
 
-    if (m_detailedProperties) {
-        attributesList.InsertColumn(c++, L"Name", LVCFMT_LEFT, width / 2);
-        attributesList.InsertColumn(c++, L"Value", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"Type", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"DeclaringType", LVCFMT_LEFT,
-                                    width / 3);
-        attributesList.InsertColumn(c++, L"ValueType", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"ItemType", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"Overridden", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"MetadataBits", LVCFMT_LEFT,
-                                    width / 3);
-        attributesList.InsertColumn(c++, L"Style TargetType", LVCFMT_LEFT,
-                                    width / 3);
-        attributesList.InsertColumn(c++, L"Style Name", LVCFMT_LEFT, width / 3);
-        attributesList.InsertColumn(c++, L"Style Source", LVCFMT_LEFT,
-                                    width / 3);
-    } else {
-        attributesList.InsertColumn(c++, L"Name", LVCFMT_LEFT, width / 2);
-        attributesList.InsertColumn(c++, L"Value", LVCFMT_LEFT, width / 2);
+        // The history column isn't part of the row diff.
+        auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+        const auto& values = m_attributesChain->Values();
+        for (size_t i = 0; i < m_attributeRows.size(); i++) {
+            const auto& v = values[m_attributeRows[i].valueIndex];
+            if (m_propertyWatch.Find(handle, v.index)) {
+                attributesList.RedrawItems(static_cast<int>(i),
+                                           static_cast<int>(i));
+            }
+        }
     }
 
-    attributesList.SetRedraw(TRUE);
+    SetTimer(TIMER_ID_SAMPLE_WATCHES,
+             result.roundComplete ? m_watchInterval : kWatchSliceDelay);
 }
 
 void CMainDlg::PopulateAttributesList(InstanceHandle handle) {
     auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
-    attributesList.SetRedraw(FALSE);
 
-    attributesList.DeleteAllItems();
+    HRESULT hr = S_OK;
+    auto chain =
+        m_propertyChainCache.Get(handle, GetTickCount64(), [this, handle, &hr] {
+            return LoadPropertyChain(m_visualTreeService.get(), handle, &hr);
+        });
+    if (!chain) {
+        attributesList.SetRedraw(FALSE);
 
-    auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
-    propertiesComboBox.ResetContent();
+        ClearAttributesList();
+        SetPropertyNames(nullptr);
 
-    unsigned int sourceCount = 0;
-    PropertyChainSource* pPropertySources = nullptr;
-    unsigned int propertyCount = 0;
-    PropertyChainValue* pPropertyValues = nullptr;
-    HRESULT hr = m_visualTreeService->GetPropertyValuesChain(
-        handle, &sourceCount, &pPropertySources, &propertyCount,
-        &pPropertyValues);
-    if (FAILED(hr)) {
-        auto errorMsg = std::format(L"Error {:08X}", static_cast<DWORD>(hr));
-        attributesList.AddItem(0, 0, errorMsg.c_str());
+        m_attributesListMessage =
+            std::format(L"Error {:08X}", static_cast<DWORD>(hr));
+        attributesList.SetItemCount(1);
 
         attributesList.SetRedraw(TRUE);
         return;
     }
 
-    const auto metadataBitsToString = [](hyper metadataBits) {
-        std::wstring str;
+    // All rows are kept, so that the filter can be changed without building
+    // the rows again.
+    std::vector<AttributeRow> allRows;
 
-#define APPEND_BIT_TO_STR(x)   \
-    if (metadataBits & x) {    \
-        str += TEXT(#x) L", "; \
-        metadataBits &= ~x;    \
+    const auto& values = chain->Values();
+    for (UINT32 i = 0; i < values.size(); i++) {
+        const auto& v = values[i];
+        const auto* src = chain->SourceOf(v);
+
+        if (!m_detailedProperties &&
+            (!src || src->source != BaseValueSourceLocal)) {
+            continue;
+        }
+
+        AttributeRow row{
+            .valueIndex = i,
+            .valueShownAsIs = false,
+            .value = {},
+            .valueHandle = 0,
+        };
+
+        if (m_detailedProperties) {
+            row.valueShownAsIs = true;
+        } else if (v.metadataBits & IsValueNull) {
+            row.value = L"(null)";
+        } else if (v.metadataBits & IsValueHandle) {
+            row.valueHandle = static_cast<InstanceHandle>(
+                std::wcstoll(chain->CStr(v.value), nullptr, 10));
+        } else {
+            row.valueShownAsIs = true;
+        }
+
+        allRows.push_back(std::move(row));
     }
 
-        APPEND_BIT_TO_STR(IsValueHandle);
-        APPEND_BIT_TO_STR(IsPropertyReadOnly);
-        APPEND_BIT_TO_STR(IsValueCollection);
-        APPEND_BIT_TO_STR(IsValueCollectionReadOnly);
-        APPEND_BIT_TO_STR(IsValueBindingExpression);
-        APPEND_BIT_TO_STR(IsValueNull);
-        APPEND_BIT_TO_STR(IsValueHandleAndEvaluatedValue);
+    // Elements of the same type usually have the same properties, in which
+    // case the combo box is kept as is. The summary, which is loaded first,
+    // already resolved the class name. Without it, the schema isn't cached.
+    std::wstring_view className;
+    if (handle == m_summaryHandle) {
+        className = m_summaryClassName;
+    }
 
-#undef APPEND_BIT_TO_STR
+    SetPropertyNames(m_propertySchemaCache.Get(className, *chain));
+
+    // When the same element is shown again, e.g. after setting a property,
+    // only the changed rows are updated, which keeps the scroll position and
+    // the selection.
+    if (handle == m_attributesHandle && m_attributesChain) {
+        m_attributeAllRows = std::move(allRows);
+        m_attributeFilterIndex.Clear();
+        auto rows = FilterAttributeRows(*chain);
+        UpdateAttributesList(std::move(chain), std::move(rows));
+        return;
+    }
+
+    attributesList.SetRedraw(FALSE);
+
+    ClearAttributesList();
+
+    m_attributesHandle = handle;
+    m_attributesChain = std::move(chain);
+    m_attributeAllRows = std::move(allRows);
+    m_attributeRows = FilterAttributeRows(*m_attributesChain);
+    attributesList.SetItemCount(static_cast<int>(m_attributeRows.size()));
+
+    attributesList.SetRedraw(TRUE);
+}
 
-        if (metadataBits) {
-            str += std::to_wstring(metadataBits) + L", ";
+void CMainDlg::UpdateAttributesList(PropertyChainCache::ChainPtr chain,
+                                    std::vector<AttributeRow> rows) {
+    auto attributesList = CListViewCtrl(GetDlgItem(IDC_ATTRIBUTE_LIST));
+    int columnCount = attributesList.GetHeader().GetItemCount();
+
+    const auto& oldChain = *m_attributesChain;
+    const auto& oldRows = m_attributeRows;
+
+    // Rows are identified by the property and the source of the value, the
+    // same property can have several values in the detailed view.
+    auto sameKey = [&](size_t oldIndex, size_t newIndex) {
+        const auto& a = oldChain.Values()[oldRows[oldIndex].valueIndex];
+        const auto& b = chain->Values()[rows[newIndex].valueIndex];
+        if (a.index != b.index) {
+            return false;
         }
 
-        if (!str.empty()) {
-            str.resize(str.length() - 2);
+        const auto* aSrc = oldChain.SourceOf(a);
+        const auto* bSrc = chain->SourceOf(b);
+        if (!aSrc || !bSrc) {
+            return aSrc == bSrc;
         }
 
-        return str;
+        return aSrc->source == bSrc->source && aSrc->handle == bSrc->handle;
     };
 
-    const auto sourceToString = [](BaseValueSource source) {
-        std::wstring str;
+    auto sameContent = [&](size_t oldIndex, size_t newIndex) {
+        std::wstring aBuffer;
+        std::wstring bBuffer;
+        for (int subItem = 0; subItem < columnCount; subItem++) {
+            int column = AttributeColumn(subItem);
+            if (AttributeCellText(oldChain, oldRows[oldIndex], column,
+                                  &aBuffer) !=
+                AttributeCellText(*chain, rows[newIndex], column, &bBuffer)) {
+                return false;
+            }
+        }
 
-#define CASE_TO_STR(x)  \
-    case x:             \
-        str = TEXT(#x); \
-        break;
+        return true;
+    };
 
-        switch (source) {
-            CASE_TO_STR(BaseValueSourceUnknown);
-            CASE_TO_STR(BaseValueSourceDefault);
-            CASE_TO_STR(BaseValueSourceBuiltInStyle);
-            CASE_TO_STR(BaseValueSourceStyle);
-            CASE_TO_STR(BaseValueSourceLocal);
-            CASE_TO_STR(Inherited);
-            CASE_TO_STR(DefaultStyleTrigger);
-            CASE_TO_STR(TemplateTrigger);
-            CASE_TO_STR(StyleTrigger);
-            CASE_TO_STR(ImplicitStyleReference);
-            CASE_TO_STR(ParentTemplate);
-            CASE_TO_STR(ParentTemplateTrigger);
-            CASE_TO_STR(Animation);
-            CASE_TO_STR(Coercion);
-            CASE_TO_STR(BaseValueSourceVisualState);
-            default:
-                str = std::to_wstring(source);
+    int selectedIndex = attributesList.GetNextItem(-1, LVNI_SELECTED);
+    int newSelectedIndex = -1;
+    if (selectedIndex >= 0 &&
+        selectedIndex < static_cast<int>(oldRows.size())) {
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (sameKey(selectedIndex, i)) {
+                newSelectedIndex = static_cast<int>(i);
                 break;
+            }
         }
+    }
 
-#undef CASE_TO_STR
+    RowDiff diff =
+        DiffRows(oldRows.size(), rows.size(), sameKey, sameContent);
 
-        return str;
-    };
+    m_attributesChain = std::move(chain);
+    m_attributeRows = std::move(rows);
 
-    int row = 0;
-    for (unsigned int i = 0; i < propertyCount; i++) {
-        const auto& v = pPropertyValues[i];
+    if (diff.newCount != diff.oldCount) {
+        attributesList.SetItemCountEx(
+            static_cast<int>(diff.newCount),
+            LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+    }
 
-        const auto& src = pPropertySources[v.PropertyChainIndex];
+    if (diff.LayoutChanged()) {
+        // Rows after the change are shifted, only the visible ones are
+        // repainted.
+        attributesList.Invalidate();
+    } else {
+        for (size_t i : diff.changedRows) {
+            attributesList.RedrawItems(static_cast<int>(i),
+                                       static_cast<int>(i));
+        }
+    }
 
-        if (!v.Overridden) {
-            auto comboBoxItemText =
-                std::format(L"{} ({})", v.PropertyName, v.Type);
-            int index = propertiesComboBox.AddString(comboBoxItemText.data());
-            if (index != CB_ERR && index != CB_ERRSPACE) {
-                propertiesComboBox.SetItemData(index, v.Index);
-            }
+    if (newSelectedIndex != selectedIndex) {
+        constexpr UINT kSelectionState = LVIS_SELECTED | LVIS_FOCUSED;
+        if (selectedIndex >= 0) {
+            attributesList.SetItemState(selectedIndex, 0, kSelectionState);
         }
 
-        if (!m_detailedProperties && src.Source != BaseValueSourceLocal) {
-            continue;
+        if (newSelectedIndex >= 0) {
+            attributesList.SetItemState(newSelectedIndex, kSelectionState,
+                                        kSelectionState);
         }
+    }
+}
 
-        std::wstring value;
-        bool valueShownAsIs = false;
+void CMainDlg::SetPropertyNames(PropertySchemaCache::SchemaPtr schema) {
+    auto propertiesComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_NAME));
 
-        if (m_detailedProperties) {
-            value = v.Value;
-            valueShownAsIs = true;
-        } else if (v.MetadataBits & IsValueNull) {
-            value = L"(null)";
-        } else if (v.MetadataBits & IsValueHandle) {
-            InstanceHandle valueHandle =
-                static_cast<InstanceHandle>(std::wcstoll(v.Value, nullptr, 10));
+    if (schema != m_propertyNamesSchema) {
+        propertiesComboBox.SetRedraw(FALSE);
+        propertiesComboBox.ResetContent();
 
-            std::wstring className;
+        if (schema) {
+            // The width is kept with the schema, and labels which were
+            // measured for other schemas are taken from the cache.
+            bool measure = !schema->DroppedWidth();
+            ComboTextMeasurer measurer(propertiesComboBox);
+            int maxWidth = 0;
+
+            for (const auto& property : schema->Properties()) {
+                int index =
+                    propertiesComboBox.AddString(property.label.c_str());
+                if (index != CB_ERR && index != CB_ERRSPACE) {
+                    propertiesComboBox.SetItemData(index, property.index);
+                }
 
-            wf::IInspectable valueObj;
-            HRESULT hr = m_xamlDiagnostics->GetIInspectableFromHandle(
-                valueHandle,
-                reinterpret_cast<::IInspectable**>(winrt::put_abi(valueObj)));
-            if (SUCCEEDED(hr)) {
-                className = winrt::get_class_name(valueObj);
-            } else {
-                className =
-                    std::format(L"Error {:08X}", static_cast<DWORD>(hr));
+                if (measure) {
+                    maxWidth = std::max(
+                        maxWidth, m_textWidthCache.Width(measurer.FontKey(),
+                                                         property.label,
+                                                         measurer));
+                }
             }
 
-            value = std::format(
-                L"({}; {})",
-                (v.MetadataBits & IsValueCollection) ? L"collection" : L"data",
-                className);
-        } else {
-            value = v.Value;
-            valueShownAsIs = true;
-        }
+            if (measure) {
+                schema->SetDroppedWidth(
+                    ComboDroppedWidthForText(maxWidth));
+            }
 
-        int c = 0;
+            propertiesComboBox.SetDroppedWidth(schema->DroppedWidth());
+        }
 
-        attributesList.AddItem(row, c++, v.PropertyName);
-        attributesList.AddItem(row, c++, value.c_str());
+        propertiesComboBox.SetRedraw(TRUE);
+        m_propertyNamesSchema = std::move(schema);
+    }
 
-        if (m_detailedProperties) {
-            attributesList.AddItem(row, c++, v.Type);
-            attributesList.AddItem(row, c++, v.DeclaringType);
-            attributesList.AddItem(row, c++, v.ValueType);
-            attributesList.AddItem(row, c++, v.ItemType);
-            attributesList.AddItem(row, c++, v.Overridden ? L"Yes" : L"No");
-            attributesList.AddItem(
-                row, c++, metadataBitsToString(v.MetadataBits).c_str());
-            attributesList.AddItem(row, c++, src.TargetType);
-            attributesList.AddItem(row, c++, src.Name);
-            attributesList.AddItem(row, c++,
-                                   sourceToString(src.Source).c_str());
-        }
-
-        // Passes on 64-bit, not on 32-bit. Can be fixed later if a 32-bit build
-        // is needed.
-        static_assert(sizeof(DWORD_PTR) >= sizeof(v.Index) + 1);
-        static_assert(sizeof(v.Index) == 4);
-        attributesList.SetItemData(
-            row,
-            (static_cast<DWORD_PTR>(valueShownAsIs ? 1 : 0) << 32) | v.Index);
-
-        row++;
+    if (!m_propertyNamesSchema) {
+        return;
     }
 
     if (m_lastPropertySelection.IsEmpty() ||
         propertiesComboBox.SelectString(0, m_lastPropertySelection) == CB_ERR) {
         propertiesComboBox.SetCurSel(0);
     }
-
-    propertiesComboBox.SetDroppedWidth(
-        GetRequiredComboDroppedWidth(propertiesComboBox));
-
-    // Not documented, but it makes sense that the arrays have to be
-    // freed and this seems to be working.
-    CoTaskMemFree(pPropertySources);
-    CoTaskMemFree(pPropertyValues);
-
-    attributesList.SetRedraw(TRUE);
 }
 
 void CMainDlg::PopulateVisualStatesTree(InstanceHandle handle) {
@@ -1657,17 +4013,19 @@ void CMainDlg::PopulateVisualStatesTree(InstanceHandle handle) {
 
     try {
         wf::IInspectable element;
-        winrt::check_hresult(m_xamlDiagnostics->GetIInspectableFromHandle(
-            handle,
-            reinterpret_cast<::IInspectable**>(winrt::put_abi(element))));
+        ObjectKind kind;
+        winrt::check_hresult(
+            InspectableFromHandle(handle, &element, nullptr, &kind));
         if (!element) {
             throw std::runtime_error("Element can't be retrieved");
         }
 
-        auto wuiFrameworkElement = element.try_as<wux::FrameworkElement>();
-        auto muiFrameworkElement =
-            wuiFrameworkElement ? mux::FrameworkElement{nullptr}
-                                : element.try_as<mux::FrameworkElement>();
+        auto wuiFrameworkElement = kind == ObjectKind::WuxFrameworkElement
+                                       ? element.as<wux::FrameworkElement>()
+                                       : wux::FrameworkElement{nullptr};
+        auto muiFrameworkElement = kind == ObjectKind::MuxFrameworkElement
+                                       ? element.as<mux::FrameworkElement>()
+                                       : mux::FrameworkElement{nullptr};
 
         auto populateList = [&visualStatesTree](auto visualStateGroups) {
             for (const auto& group : visualStateGroups) {
@@ -1754,9 +4112,16 @@ void CMainDlg::AddItemToTree(HTREEITEM parentTreeItem,
 
     elementItem->treeItem = insertedItem;
 
+    bool filtered = !m_elementFilter.IsEmpty();
+
     if (auto it = m_parentToChildren.find(handle);
         it != m_parentToChildren.end()) {
         for (const auto& childHandle : it->second) {
+            if (filtered &&
+                !m_elementFilterVisibleHandles.contains(childHandle)) {
+                continue;
+            }
+
             auto childElementItem = m_elementItems.find(childHandle);
             if (childElementItem == m_elementItems.end()) {
                 ATLASSERT(FALSE);
@@ -1769,6 +4134,100 @@ void CMainDlg::AddItemToTree(HTREEITEM parentTreeItem,
     }
 }
 
+// With a filter, the items of in-scope ancestors might be missing because they
+// don't match, so the scope is checked with the ancestor index, and the missing
+// ancestor items are inserted along with the element.
+void CMainDlg::AddFilteredElementToTree(InstanceHandle handle,
+                                        const ElementItem& elementItem) {
+    bool inScope = m_scopeHandle
+                       ? m_ancestorIndex.IsAncestor(m_scopeHandle, handle)
+                       : m_ancestorIndex.IsAttached(handle);
+    if (!inScope) {
+        if (m_scopeHandle) {
+            m_outOfScopeMutationCount++;
+        }
+
+        return;
+    }
+
+    if (!m_elementFilter.FoundIn(elementItem.itemTitle)) {
+        return;
+    }
+
+    // Mark the element and its ancestors, as in ApplyElementFilter.
+    InstanceHandle iterHandle = handle;
+    while (iterHandle &&
+           m_elementFilterVisibleHandles.insert(iterHandle).second) {
+        auto it = m_elementItems.find(iterHandle);
+        if (it == m_elementItems.end()) {
+            break;
+        }
+
+        iterHandle = it->second.parentHandle;
+    }
+
+    // Find the topmost element without an item. Its children are added
+    // recursively, down to the element.
+    InstanceHandle topHandle = handle;
+    HTREEITEM parentItem = nullptr;
+    while (topHandle != m_scopeHandle) {
+        auto it = m_elementItems.find(topHandle);
+        if (it == m_elementItems.end()) {
+            ATLASSERT(FALSE);
+            return;
+        }
+
+        InstanceHandle parentHandle = it->second.parentHandle;
+        if (!parentHandle) {
+            break;
+        }
+
+        auto parentIt = m_elementItems.find(parentHandle);
+        if (parentIt == m_elementItems.end()) {
+            ATLASSERT(FALSE);
+            return;
+        }
+
+        if (parentIt->second.treeItem) {
+            parentItem = parentIt->second.treeItem;
+            break;
+        }
+
+        topHandle = parentHandle;
+    }
+
+    auto topIt = m_elementItems.find(topHandle);
+    if (topIt == m_elementItems.end()) {
+        ATLASSERT(FALSE);
+        return;
+    }
+
+    // Insert after the closest previous sibling which has an item.
+    HTREEITEM insertAfter = TVI_LAST;
+    if (topHandle != m_scopeHandle) {
+        insertAfter = TVI_FIRST;
+
+        if (auto it = m_parentToChildren.find(topIt->second.parentHandle);
+            it != m_parentToChildren.end()) {
+            for (const auto& siblingHandle : it->second) {
+                if (siblingHandle == topHandle) {
+                    break;
+                }
+
+                auto siblingIt = m_elementItems.find(siblingHandle);
+                if (siblingIt != m_elementItems.end() &&
+                    siblingIt->second.treeItem) {
+                    insertAfter = siblingIt->second.treeItem;
+                }
+            }
+        }
+    }
+
+    RedrawTreeQueue();
+
+    AddItemToTree(parentItem, insertAfter, topHandle, &topIt->second);
+}
+
 bool CMainDlg::SelectElementFromCursor() {
     CPoint pt;
     ::GetCursorPos(&pt);
@@ -1778,18 +4237,5 @@ bool CMainDlg::SelectElementFromCursor() {
         return false;
     }
 
-    auto it = m_elementItems.find(handle);
-    if (it == m_elementItems.end()) {
-        return false;
-    }
-
-    auto treeItem = it->second.treeItem;
-    if (!treeItem) {
-        return false;
-    }
-
-    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_ELEMENT_TREE));
-    treeView.SelectItem(treeItem);
-    treeView.EnsureVisible(treeItem);
-    return true;
+    return SelectElement(handle);
 }
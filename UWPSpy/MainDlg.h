@@ -1,6 +1,26 @@
 #pragma once
 
+#include "ancestor_index.h"
+#include "attribute_filter_index.h"
+#include "detail_load_scheduler.h"
+#include "edit_batch.h"
+#include "edit_journal.h"
+#include "handle_cache.h"
+#include "metadata_cache.h"
+#include "object_kind.h"
+#include "property_chain.h"
+#include "property_crawler.h"
+#include "property_export.h"
+#include "property_schema.h"
+#include "property_store.h"
+#include "property_watch.h"
 #include "resource.h"
+#include "runtime_class_cache.h"
+#include "text_search.h"
+#include "text_width_cache.h"
+#include "tree_history.h"
+#include "value_instance_cache.h"
+#include "xaml_value_cache.h"
 #include "winrt.hpp"
 
 class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
@@ -11,6 +31,13 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
         TIMER_ID_REDRAW_TREE = 1,
         TIMER_ID_SET_SELECTED_ELEMENT_INFORMATION,
         TIMER_ID_REFRESH_SELECTED_ELEMENT_INFORMATION,
+        TIMER_ID_UPDATE_TITLE,
+        TIMER_ID_APPLY_ELEMENT_FILTER,
+        TIMER_ID_APPLY_ATTRIBUTE_FILTER,
+        TIMER_ID_LOAD_SELECTED_ELEMENT_DETAILS,
+        TIMER_ID_SAMPLE_WATCHES,
+        TIMER_ID_CRAWL_PROPERTIES,
+        TIMER_ID_EXPORT_PROPERTIES,
     };
 
     enum {
@@ -33,6 +60,7 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
     void ElementAdded(const ParentChildRelation& parentChildRelation,
                       const VisualElement& element);
     void ElementRemoved(InstanceHandle handle);
+    void ElementStateChanged(InstanceHandle handle);
 
    private:
     BEGIN_MSG_MAP_EX(CMainDlg)
@@ -43,10 +71,15 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
         MSG_WM_CONTEXTMENU(OnContextMenu)
         NOTIFY_HANDLER_EX(IDC_ELEMENT_TREE, TVN_SELCHANGED,
                           OnElementTreeSelChanged)
+        COMMAND_HANDLER_EX(IDC_ELEMENT_FILTER, EN_CHANGE, OnElementFilterChange)
         COMMAND_ID_HANDLER_EX(IDC_SPLIT_TOGGLE, OnSplitToggle)
         NOTIFY_HANDLER_EX(IDC_DETAILS_TABS, TCN_SELCHANGE,
                           OnDetailsTabsSelChange)
+        COMMAND_HANDLER_EX(IDC_ATTRIBUTE_FILTER, EN_CHANGE,
+                           OnAttributeFilterChange)
         NOTIFY_HANDLER_EX(IDC_ATTRIBUTE_LIST, NM_DBLCLK, OnAttributeListDblClk)
+        NOTIFY_HANDLER_EX(IDC_ATTRIBUTE_LIST, LVN_GETDISPINFO,
+                          OnAttributeListGetDispInfo)
         COMMAND_HANDLER_EX(IDC_PROPERTY_NAME, CBN_SELCHANGE,
                            OnPropertyNameSelChange)
         COMMAND_ID_HANDLER_EX(IDC_PROPERTY_IS_XAML, OnPropertyIsXaml)
@@ -69,6 +102,7 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
     struct ResizeData : public CDialogResize<ResizeData> {
         BEGIN_DLGRESIZE_MAP(ResizeData)
             DLGRESIZE_CONTROL(IDC_ELEMENT_TREE, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+            DLGRESIZE_CONTROL(IDC_ELEMENT_FILTER, DLSZ_SIZE_X | DLSZ_MOVE_Y)
             DLGRESIZE_CONTROL(IDC_SPLIT_TOGGLE, DLSZ_MOVE_X | DLSZ_CENTER_Y)
             DLGRESIZE_CONTROL(IDC_CLASS_STATIC, DLSZ_MOVE_X)
             DLGRESIZE_CONTROL(IDC_CLASS_EDIT, DLSZ_MOVE_X | DLSZ_SIZE_X)
@@ -77,6 +111,7 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
             DLGRESIZE_CONTROL(IDC_RECT_STATIC, DLSZ_MOVE_X)
             DLGRESIZE_CONTROL(IDC_RECT_EDIT, DLSZ_MOVE_X)
             DLGRESIZE_CONTROL(IDC_DETAILS_TABS, DLSZ_MOVE_X)
+            DLGRESIZE_CONTROL(IDC_ATTRIBUTE_FILTER, DLSZ_MOVE_X)
             DLGRESIZE_CONTROL(IDC_ATTRIBUTE_LIST, DLSZ_MOVE_X | DLSZ_SIZE_Y)
             DLGRESIZE_CONTROL(IDC_VISUAL_STATE_TREE, DLSZ_MOVE_X | DLSZ_SIZE_Y)
             DLGRESIZE_CONTROL(IDC_PROPERTY_NAME, DLSZ_MOVE_X | DLSZ_MOVE_Y)
@@ -97,6 +132,7 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
         : public CDialogResize<ResizeDataAttributesExpanded> {
         BEGIN_DLGRESIZE_MAP(ResizeDataAttributesExpanded)
             DLGRESIZE_CONTROL(IDC_ELEMENT_TREE, DLSZ_SIZE_Y)
+            DLGRESIZE_CONTROL(IDC_ELEMENT_FILTER, DLSZ_MOVE_Y)
             DLGRESIZE_CONTROL(IDC_SPLIT_TOGGLE, DLSZ_CENTER_Y)
             DLGRESIZE_CONTROL(IDC_CLASS_STATIC, 0)
             DLGRESIZE_CONTROL(IDC_CLASS_EDIT, DLSZ_SIZE_X)
@@ -105,6 +141,7 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
             DLGRESIZE_CONTROL(IDC_RECT_STATIC, 0)
             DLGRESIZE_CONTROL(IDC_RECT_EDIT, DLSZ_SIZE_X)
             DLGRESIZE_CONTROL(IDC_DETAILS_TABS, DLSZ_SIZE_X)
+            DLGRESIZE_CONTROL(IDC_ATTRIBUTE_FILTER, DLSZ_SIZE_X)
             DLGRESIZE_CONTROL(IDC_ATTRIBUTE_LIST, DLSZ_SIZE_X | DLSZ_SIZE_Y)
             DLGRESIZE_CONTROL(IDC_VISUAL_STATE_TREE, DLSZ_SIZE_X | DLSZ_SIZE_Y)
             DLGRESIZE_CONTROL(IDC_PROPERTY_NAME, DLSZ_SIZE_X | DLSZ_MOVE_Y)
@@ -131,6 +168,35 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
         InstanceHandle parentHandle;
         std::wstring itemTitle;
         HTREEITEM treeItem;
+        // Structural hash of the subtree, see subtree_shape.h. Zero if it needs
+        // to be recalculated, in which case it's also zero for all ancestors.
+        UINT64 typeHash;
+        UINT64 shapeHash;
+        UINT64 subtreeSize;
+    };
+
+    // An export of the properties of a subtree, see ExportProperties.
+    struct PropertyExport {
+        std::vector<InstanceHandle> handles;
+        size_t nextHandle = 0;
+        size_t failedElements = 0;
+        std::wstring path;
+        CAtlFile file;
+        std::chrono::steady_clock::time_point start;
+        // Declared after the file, which it writes to.
+        std::unique_ptr<PropertyExporter> exporter;
+    };
+
+    struct AttributeRow {
+        // Index in the values of m_attributesChain.
+        UINT32 valueIndex;
+        // If false, the value column shows value instead of the chain value,
+        // e.g. "(null)".
+        bool valueShownAsIs;
+        std::wstring value;
+        // Set for values which are objects, shown with their class name. The
+        // class name is resolved once the row is shown or filtered.
+        InstanceHandle valueHandle;
     };
 
     BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
@@ -138,9 +204,12 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
     void OnTimer(UINT_PTR nIDEvent);
     void OnContextMenu(CWindow wnd, CPoint point);
     LRESULT OnElementTreeSelChanged(LPNMHDR pnmh);
+    void OnElementFilterChange(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnSplitToggle(UINT uNotifyCode, int nID, CWindow wndCtl);
     LRESULT OnDetailsTabsSelChange(LPNMHDR pnmh);
+    void OnAttributeFilterChange(UINT uNotifyCode, int nID, CWindow wndCtl);
     LRESULT OnAttributeListDblClk(LPNMHDR pnmh);
+    LRESULT OnAttributeListGetDispInfo(LPNMHDR pnmh);
     void OnPropertyNameSelChange(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnPropertyIsXaml(UINT uNotifyCode, int nID, CWindow wndCtl);
     void OnPropertyRemove(UINT uNotifyCode, int nID, CWindow wndCtl);
@@ -157,19 +226,92 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
 
     void ElementTreeOnChar(TCHAR chChar, UINT nRepCnt, UINT nFlags);
 
+    void UpdateTitle();
+    void SetScope(InstanceHandle handle);
+    void RebuildTree();
+    void ApplyElementFilter();
+    void ApplyAttributeFilter();
+    std::vector<AttributeRow> FilterAttributeRows(const PropertyChain& chain);
     void RedrawTreeQueue();
     bool SetSelectedElementInformation();
+    void SetSelectedElementSummary(InstanceHandle handle);
+    void SetSelectedElementAttributes(InstanceHandle handle);
+    void SetSelectedElementVisualStates(InstanceHandle handle);
+    void LoadSelectedElementDetails();
+    void RunDetailLoadTask();
+    void CompleteSelectedElementDetails();
+    std::vector<InstanceHandle> TreeNeighborHandles(CTreeItem item);
     bool RefreshSelectedElementInformation(UINT delay = 20);
     void ResetAttributesListColumns();
+    void ClearAttributesList();
+    std::wstring_view AttributeRowValue(const PropertyChain& chain,
+                                        const AttributeRow& row,
+                                        std::wstring* buffer);
+    const std::wstring& AttributeValueClassName(InstanceHandle valueHandle);
+    std::wstring_view AttributeCellText(const PropertyChain& chain,
+                                        const AttributeRow& row,
+                                        int column,
+                                        std::wstring* buffer);
+    int AttributeColumn(int subItem);
+    void OnAttributeListContextMenu(CPoint point);
+    void SampleWatches();
+    void RepopulateAttributesList();
     void PopulateAttributesList(InstanceHandle handle);
+    void UpdateAttributesList(PropertyChainCache::ChainPtr chain,
+                              std::vector<AttributeRow> rows);
+    void SetPropertyNames(PropertySchemaCache::SchemaPtr schema);
     void PopulateVisualStatesTree(InstanceHandle handle);
     void AddItemToTree(HTREEITEM parentTreeItem,
                        HTREEITEM insertAfter,
                        InstanceHandle handle,
                        ElementItem* elementItem);
+    void AddFilteredElementToTree(InstanceHandle handle,
+                                  const ElementItem& elementItem);
     InstanceHandle ElementFromPoint(CPoint pt);
     InstanceHandle ElementFromPointInSubtree(wux::UIElement subtree, CPoint pt);
     InstanceHandle ElementFromPointInSubtree(mux::UIElement subtree, CPoint pt);
+    void InvalidateSubtreeShape(InstanceHandle handle);
+    void UpdateSubtreeShape(InstanceHandle handle, ElementItem* elementItem);
+    void ShowRepeatedSubtrees(InstanceHandle handle);
+    void ShowTreeHistory(InstanceHandle handle);
+    void ShowPropertyQuery();
+    void ShowPropertyCompare(InstanceHandle first, InstanceHandle second);
+    void ExportProperties(InstanceHandle rootHandle);
+    void ExportPropertiesSlice();
+    void FinishPropertyExport(bool cancel);
+    bool GetSelectedProperty(unsigned int* propertyIndex,
+                             CString* propertyName,
+                             CString* propertyType);
+    void SetPropertyInSubtree(InstanceHandle rootHandle);
+    bool ApplyEditBatch(const EditBatch& batch,
+                        std::wstring journalDescription);
+    void PruneEditJournalObjects();
+    void UndoEdit();
+    void RedoEdit();
+    void RevertEdits(InstanceHandle rootHandle);
+    void InvalidatePropertyChains(InstanceHandle handle);
+    void SetCrawlProperties(bool crawl);
+    void ScheduleCrawl();
+    void CrawlProperties();
+    HRESULT InspectableFromHandle(InstanceHandle handle,
+                                  wf::IInspectable* object,
+                                  std::wstring* className = nullptr,
+                                  ObjectKind* kind = nullptr);
+    void LoadMetadataCache();
+    void SaveMetadataCache();
+    ObjectKind ObjectKindOf(const wf::IInspectable& object,
+                            std::wstring_view className);
+    HRESULT CreateValueInstance(const CString& type,
+                                const CString& value,
+                                InstanceHandle* instanceHandle,
+                                bool* cached);
+    wf::IInspectable StyleValueFromXamlCached(ObjectKind kind,
+                                              std::wstring_view className,
+                                              std::wstring_view propertyName,
+                                              std::wstring_view propertyType,
+                                              std::wstring_view xaml);
+    bool IsRootElement(InstanceHandle handle);
+    bool SelectElement(InstanceHandle handle);
     bool CreateFlashArea(InstanceHandle handle);
     void DestroyFlashArea();
     bool SelectElementFromCursor();
@@ -190,10 +332,103 @@ class CMainDlg : public CDialogImpl<CMainDlg>, public CDialogResize<CMainDlg> {
     std::unordered_map<InstanceHandle, ElementItem> m_elementItems;
 
     // Note: A parent might be in m_parentToChildren but not in m_elementItems
-    // at some point if the child is added before its parent.
+    // at some point if the child is added before its parent. Root elements are
+    // kept under the 0 parent handle.
     std::unordered_map<InstanceHandle, std::vector<InstanceHandle>>
         m_parentToChildren;
 
+    AncestorIndex m_ancestorIndex;
+
+    // All element additions and removals, to allow viewing the tree as it was
+    // at an earlier time.
+    TreeHistory m_treeHistory;
+
+    PropertyChainCache m_propertyChainCache;
+
+    // Loads the details of elements selected with the keyboard in stages, and
+    // prefetches the property chains of the neighbors of the selection.
+    DetailLoadScheduler m_detailLoadScheduler;
+
+    HandleCache<winrt::weak_ref<wf::IInspectable>> m_handleCache;
+    RuntimeClassCache<ObjectKind> m_objectKindCache;
+    // Time spent probing the interfaces of runtime classes, and the probes
+    // which the metadata cache saved, compared to classifying each class.
+    std::chrono::steady_clock::duration m_objectKindProbeTime{};
+    size_t m_objectKindProbesSaved = 0;
+
+    // Type metadata of previous sessions of the same app and framework
+    // versions, see metadata_cache.h. The file stays mapped until the dialog
+    // is destroyed.
+    MetadataCache m_metadataCache;
+    CAtlFileMapping<char> m_metadataCacheMapping;
+    std::wstring m_metadataCacheKey;
+    std::chrono::steady_clock::duration m_metadataCacheLoadTime{};
+
+    // If set, only the subtree of this element is shown in the tree. Elements
+    // outside of it are kept in the maps above so that the scope can be
+    // changed without re-querying the app, but are otherwise only counted.
+    InstanceHandle m_scopeHandle = 0;
+    UINT64 m_outOfScopeMutationCount = 0;
+
+    // If set, only matching elements and their ancestors are shown in the
+    // tree.
+    TextSearch::Pattern m_elementFilter;
+    std::unordered_set<InstanceHandle> m_elementFilterVisibleHandles;
+
+    TextSearch::Pattern m_attributeFilter;
+
+    // The attributes list is an owner-data list view, cells are formatted
+    // on demand from these rows.
+    InstanceHandle m_attributesHandle = 0;
+    PropertyChainCache::ChainPtr m_attributesChain;
+    std::vector<AttributeRow> m_attributeRows;
+    // The rows before filtering, and an index for filtering them, built when
+    // a filter is first applied.
+    std::vector<AttributeRow> m_attributeAllRows;
+    AttributeFilterIndex m_attributeFilterIndex;
+    // The class names of the object values in the list, see
+    // AttributeValueClassName.
+    std::unordered_map<InstanceHandle, std::wstring> m_attributeValueClassNames;
+    // If set, shown as a single row instead of the rows, e.g. for errors.
+    std::wstring m_attributesListMessage;
+
+    // If enabled, the property values of all elements are collected in the
+    // background into m_propertyStore.
+    bool m_crawlProperties = false;
+    bool m_crawlScheduled = false;
+    PropertyCrawler m_propertyCrawler;
+    PropertyStore m_propertyStore;
+
+    // Set while the properties of a subtree are being exported.
+    std::unique_ptr<PropertyExport> m_propertyExport;
+
+    // Pinned properties of any element, sampled periodically.
+    PropertyWatchEngine m_propertyWatch;
+    UINT m_watchInterval = 500;
+
+    // The class name resolved by SetSelectedElementSummary, empty if that
+    // failed. Used for the schema of the same element.
+    InstanceHandle m_summaryHandle = 0;
+    std::wstring m_summaryClassName;
+
+    // The schema the property name combo box is currently filled with.
+    PropertySchemaCache::SchemaPtr m_propertyNamesSchema;
+    PropertySchemaCache m_propertySchemaCache;
+    // Widths of the property name combo box labels.
+    TextWidthCache m_textWidthCache;
+
+    // Values created from the property value text, reused when the same value
+    // is set again.
+    ValueInstanceCache<wf::IInspectable> m_valueInstanceCache;
+    // Values parsed from the property value XAML.
+    XamlValueCache<wf::IInspectable> m_xamlValueCache;
+
+    // Property edits made with the dialog, for undo and redo. The value
+    // objects the journal refers to are kept alive, so that their handles
+    // stay valid.
+    EditJournal m_editJournal;
+    std::unordered_map<InstanceHandle, wf::IInspectable> m_editJournalObjects;
+
     CString m_lastPropertySelection;
 
     CWindow m_flashAreaWindow;
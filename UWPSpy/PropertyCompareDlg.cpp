@@ -0,0 +1,240 @@
+#include "stdafx.h"
+
+#include "PropertyCompareDlg.h"
+
+namespace {
+
+enum Column {
+    kColumnProperty,
+    kColumnFirstValue,
+    kColumnFirstSource,
+    kColumnSecondValue,
+    kColumnSecondSource,
+};
+
+// The background of the cells which differ.
+constexpr COLORREF kDifferenceColor = RGB(255, 236, 179);
+
+}  // namespace
+
+CPropertyCompareDlg::CPropertyCompareDlg(Element first,
+                                         Element second,
+                                         bool detailed,
+                                         ChainLoader chainLoader,
+                                         SourceToString sourceToString,
+                                         ValueToString valueToString)
+    : m_first(std::move(first)),
+      m_second(std::move(second)),
+      m_detailed(detailed),
+      m_chainLoader(std::move(chainLoader)),
+      m_sourceToString(std::move(sourceToString)),
+      m_valueToString(std::move(valueToString)) {}
+
+BOOL CPropertyCompareDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
+    DlgResize_Init();
+
+    CButton(GetDlgItem(IDC_PROPERTY_COMPARE_DIFF_ONLY)).SetCheck(BST_CHECKED);
+    CButton(GetDlgItem(IDC_PROPERTY_COMPARE_DETAILED))
+        .SetCheck(m_detailed ? BST_CHECKED : BST_UNCHECKED);
+
+    auto list = CListViewCtrl(GetDlgItem(IDC_PROPERTY_COMPARE_LIST));
+    list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_LABELTIP |
+                                  LVS_EX_DOUBLEBUFFER);
+    ::SetWindowTheme(list, L"Explorer", nullptr);
+
+    CRect rect;
+    list.GetClientRect(rect);
+    int width = rect.Width() - ::GetSystemMetrics(SM_CXVSCROLL);
+
+    auto firstValue = std::format(L"Value ({})", m_first.title);
+    auto secondValue = std::format(L"Value ({})", m_second.title);
+
+    list.InsertColumn(kColumnProperty, L"Property", LVCFMT_LEFT,
+                      width * 2 / 10);
+    list.InsertColumn(kColumnFirstValue, firstValue.c_str(), LVCFMT_LEFT,
+                      width * 25 / 100);
+    list.InsertColumn(kColumnFirstSource, L"Source", LVCFMT_LEFT,
+                      width * 15 / 100);
+    list.InsertColumn(kColumnSecondValue, secondValue.c_str(), LVCFMT_LEFT,
+                      width * 25 / 100);
+    list.InsertColumn(kColumnSecondSource, L"Source", LVCFMT_LEFT,
+                      width * 15 / 100);
+
+    LoadChains();
+    Compare();
+
+    return TRUE;
+}
+
+LRESULT CPropertyCompareDlg::OnListCustomDraw(LPNMHDR pnmh) {
+    auto customDraw = reinterpret_cast<LPNMLVCUSTOMDRAW>(pnmh);
+
+    switch (customDraw->nmcd.dwDrawStage) {
+        case CDDS_PREPAINT:
+            return CDRF_NOTIFYITEMDRAW;
+
+        case CDDS_ITEMPREPAINT:
+            return CDRF_NOTIFYSUBITEMDRAW;
+
+        case CDDS_ITEMPREPAINT | CDDS_SUBITEM: {
+            size_t item = customDraw->nmcd.dwItemSpec;
+            bool highlight = false;
+            if (item < m_listedRows.size()) {
+                const auto& row = m_comparison.rows[m_listedRows[item]];
+                switch (customDraw->iSubItem) {
+                    case kColumnProperty:
+                        highlight = row.Differs();
+                        break;
+
+                    case kColumnFirstValue:
+                    case kColumnSecondValue:
+                        highlight = row.valueDiffers;
+                        break;
+
+                    case kColumnFirstSource:
+                    case kColumnSecondSource:
+                        highlight = row.sourceDiffers || row.styleDiffers;
+                        break;
+                }
+            }
+
+            customDraw->clrTextBk = highlight ? kDifferenceColor : CLR_DEFAULT;
+            return CDRF_DODEFAULT;
+        }
+    }
+
+    return CDRF_DODEFAULT;
+}
+
+void CPropertyCompareDlg::OnOptionChanged(UINT uNotifyCode,
+                                          int nID,
+                                          CWindow wndCtl) {
+    m_detailed = CButton(GetDlgItem(IDC_PROPERTY_COMPARE_DETAILED))
+                     .GetCheck() != BST_UNCHECKED;
+    Compare();
+}
+
+void CPropertyCompareDlg::OnRefresh(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    LoadChains();
+    Compare();
+}
+
+void CPropertyCompareDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    EndDialog(nID);
+}
+
+void CPropertyCompareDlg::LoadChains() {
+    m_loadError.clear();
+
+    HRESULT hr = S_OK;
+    m_firstChain = m_chainLoader(m_first.handle, &hr);
+    if (!m_firstChain) {
+        m_loadError = std::format(L"{}: Error {:08X}", m_first.title,
+                                  static_cast<DWORD>(hr));
+        return;
+    }
+
+    m_secondChain = m_chainLoader(m_second.handle, &hr);
+    if (!m_secondChain) {
+        m_loadError = std::format(L"{}: Error {:08X}", m_second.title,
+                                  static_cast<DWORD>(hr));
+    }
+}
+
+void CPropertyCompareDlg::Compare() {
+    auto list = CListViewCtrl(GetDlgItem(IDC_PROPERTY_COMPARE_LIST));
+    list.SetRedraw(FALSE);
+    list.DeleteAllItems();
+
+    m_comparison = {};
+    m_listedRows.clear();
+
+    if (!m_loadError.empty()) {
+        list.SetRedraw(TRUE);
+        SetDlgItemText(IDC_PROPERTY_COMPARE_STATUS, m_loadError.c_str());
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    m_comparison = CompareProperties(*m_firstChain, *m_secondChain,
+                                     m_detailed, BaseValueSourceLocal);
+    auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+
+    bool diffOnly = CButton(GetDlgItem(IDC_PROPERTY_COMPARE_DIFF_ONLY))
+                        .GetCheck() != BST_UNCHECKED;
+
+    const auto& firstValues = m_firstChain->Values();
+    const auto& secondValues = m_secondChain->Values();
+
+    for (size_t i = 0; i < m_comparison.rows.size(); i++) {
+        const auto& row = m_comparison.rows[i];
+        if (diffOnly && !row.Differs()) {
+            continue;
+        }
+
+        int item = static_cast<int>(m_listedRows.size());
+        m_listedRows.push_back(i);
+
+        const PropertyChain::Value* first =
+            row.first != PropertyComparison::kNone ? &firstValues[row.first]
+                                                   : nullptr;
+        const PropertyChain::Value* second =
+            row.second != PropertyComparison::kNone ? &secondValues[row.second]
+                                                    : nullptr;
+
+        list.AddItem(item, kColumnProperty,
+                     first ? m_firstChain->CStr(first->propertyName)
+                           : m_secondChain->CStr(second->propertyName));
+
+        if (first) {
+            list.AddItem(item, kColumnFirstValue,
+                         m_valueToString(*m_firstChain, *first).c_str());
+            list.AddItem(item, kColumnFirstSource,
+                         SourceText(*m_firstChain, *first).c_str());
+        } else {
+            list.AddItem(item, kColumnFirstValue, L"(not set)");
+        }
+
+        if (second) {
+            list.AddItem(item, kColumnSecondValue,
+                         m_valueToString(*m_secondChain, *second).c_str());
+            list.AddItem(item, kColumnSecondSource,
+                         SourceText(*m_secondChain, *second).c_str());
+        } else {
+            list.AddItem(item, kColumnSecondValue, L"(not set)");
+        }
+    }
+
+    list.SetRedraw(TRUE);
+
+    auto status = std::format(L"{} properties, {} differ, {:.2f} ms",
+                              m_comparison.rows.size(),
+                              m_comparison.differingRows, elapsed.count());
+    SetDlgItemText(IDC_PROPERTY_COMPARE_STATUS, status.c_str());
+}
+
+std::wstring CPropertyCompareDlg::SourceText(
+    const PropertyChain& chain,
+    const PropertyChain::Value& value) {
+    const auto* src = chain.SourceOf(value);
+    if (!src) {
+        return std::wstring();
+    }
+
+    std::wstring text = m_sourceToString(src->source);
+
+    // Name the style, so that values of different styles can be told apart.
+    if (src->source != BaseValueSourceLocal) {
+        auto name = chain.View(src->name);
+        if (name.empty()) {
+            name = chain.View(src->targetType);
+        }
+
+        if (!name.empty()) {
+            text += std::format(L" ({})", name);
+        }
+    }
+
+    return text;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "property_chain.h"
+#include "property_compare.h"
+#include "resource.h"
+
+class CPropertyCompareDlg : public CDialogImpl<CPropertyCompareDlg>,
+                            public CDialogResize<CPropertyCompareDlg> {
+   public:
+    enum { IDD = IDD_PROPERTY_COMPARE };
+
+    using ChainPtr = PropertyChainCache::ChainPtr;
+    // Returns nullptr and sets hr on failure.
+    using ChainLoader =
+        std::function<ChainPtr(InstanceHandle handle, HRESULT* hr)>;
+    using SourceToString = std::function<std::wstring(std::int32_t source)>;
+    using ValueToString =
+        std::function<std::wstring(const PropertyChain& chain,
+                                   const PropertyChain::Value& value)>;
+
+    struct Element {
+        InstanceHandle handle;
+        std::wstring title;
+    };
+
+    CPropertyCompareDlg(Element first,
+                        Element second,
+                        bool detailed,
+                        ChainLoader chainLoader,
+                        SourceToString sourceToString,
+                        ValueToString valueToString);
+
+   private:
+    BEGIN_MSG_MAP_EX(CPropertyCompareDlg)
+        CHAIN_MSG_MAP(CDialogResize<CPropertyCompareDlg>)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        NOTIFY_HANDLER_EX(IDC_PROPERTY_COMPARE_LIST, NM_CUSTOMDRAW,
+                          OnListCustomDraw)
+        COMMAND_HANDLER_EX(IDC_PROPERTY_COMPARE_DIFF_ONLY, BN_CLICKED,
+                           OnOptionChanged)
+        COMMAND_HANDLER_EX(IDC_PROPERTY_COMPARE_DETAILED, BN_CLICKED,
+                           OnOptionChanged)
+        COMMAND_ID_HANDLER_EX(IDC_PROPERTY_COMPARE_REFRESH, OnRefresh)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    END_MSG_MAP()
+
+    BEGIN_DLGRESIZE_MAP(CPropertyCompareDlg)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_COMPARE_REFRESH, DLSZ_MOVE_X)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_COMPARE_STATUS, DLSZ_SIZE_X)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_COMPARE_LIST, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+        DLGRESIZE_CONTROL(IDCANCEL, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+    END_DLGRESIZE_MAP()
+
+    BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
+    LRESULT OnListCustomDraw(LPNMHDR pnmh);
+    void OnOptionChanged(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnRefresh(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl);
+
+    void LoadChains();
+    void Compare();
+    std::wstring SourceText(const PropertyChain& chain,
+                            const PropertyChain::Value& value);
+
+    Element m_first;
+    Element m_second;
+    bool m_detailed;
+    ChainLoader m_chainLoader;
+    SourceToString m_sourceToString;
+    ValueToString m_valueToString;
+
+    // Both chains are kept while the dialog is open, so that changing the
+    // options doesn't fetch them again.
+    ChainPtr m_firstChain;
+    ChainPtr m_secondChain;
+    std::wstring m_loadError;
+
+    PropertyComparison m_comparison;
+    // Indices into m_comparison.rows of the listed rows.
+    std::vector<size_t> m_listedRows;
+};
@@ -0,0 +1,163 @@
+#include "stdafx.h"
+
+#include "PropertyQueryDlg.h"
+
+namespace {
+
+// Only the largest groups are listed.
+constexpr size_t kMaxListedGroups = 1000;
+
+// In the order of PropertyStore::ValueOp.
+constexpr PCWSTR kValueOps[] = {
+    L"Any value",
+    L"Equals",
+    L"Not equals",
+    L"Contains",
+};
+
+// In the order of PropertyStore::GroupBy.
+constexpr PCWSTR kGroupBys[] = {
+    L"Value",
+    L"Value source",
+    L"Style name",
+    L"Type",
+};
+
+std::wstring GetDlgItemString(CWindow wnd) {
+    CString text;
+    wnd.GetWindowText(text);
+    return std::wstring(text.GetString(), text.GetLength());
+}
+
+}  // namespace
+
+CPropertyQueryDlg::CPropertyQueryDlg(const PropertyStore& store,
+                                     SourceToString sourceToString)
+    : m_store(store), m_sourceToString(std::move(sourceToString)) {}
+
+BOOL CPropertyQueryDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
+    DlgResize_Init();
+
+    auto typeComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_TYPE));
+    for (const auto& typeName : m_store.TypeNames()) {
+        typeComboBox.AddString(typeName.c_str());
+    }
+
+    auto propertyComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_PROPERTY));
+    for (const auto& propertyName : m_store.PropertyNames()) {
+        propertyComboBox.AddString(propertyName.c_str());
+    }
+
+    auto opComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_OP));
+    for (auto op : kValueOps) {
+        opComboBox.AddString(op);
+    }
+    opComboBox.SetCurSel(0);
+
+    auto groupByComboBox = CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_GROUP_BY));
+    for (auto groupBy : kGroupBys) {
+        groupByComboBox.AddString(groupBy);
+    }
+    groupByComboBox.SetCurSel(0);
+
+    auto list = CListViewCtrl(GetDlgItem(IDC_PROPERTY_QUERY_RESULTS));
+    list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_LABELTIP |
+                                  LVS_EX_DOUBLEBUFFER);
+    ::SetWindowTheme(list, L"Explorer", nullptr);
+
+    CRect rect;
+    list.GetClientRect(rect);
+    int width = rect.Width() - ::GetSystemMetrics(SM_CXVSCROLL);
+
+    list.InsertColumn(0, L"Group", LVCFMT_LEFT, width * 8 / 10);
+    list.InsertColumn(1, L"Count", LVCFMT_RIGHT, width * 2 / 10);
+
+    auto status = std::format(L"{} elements, {} values collected",
+                              m_store.ElementCount(), m_store.RowCount());
+    SetDlgItemText(IDC_PROPERTY_QUERY_STATUS, status.c_str());
+
+    GetDlgItem(IDOK).EnableWindow(FALSE);
+
+    return TRUE;
+}
+
+LRESULT CPropertyQueryDlg::OnResultsDblClk(LPNMHDR pnmh) {
+    auto itemActivate = reinterpret_cast<LPNMITEMACTIVATE>(pnmh);
+    if (itemActivate->iItem == -1) {
+        return 0;
+    }
+
+    OnOK(0, IDOK, nullptr);
+    return 0;
+}
+
+void CPropertyQueryDlg::OnRun(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    PropertyStore::Query query{
+        .typeName = GetDlgItemString(GetDlgItem(IDC_PROPERTY_QUERY_TYPE)),
+        .propertyName =
+            GetDlgItemString(GetDlgItem(IDC_PROPERTY_QUERY_PROPERTY)),
+        .valueOp = static_cast<PropertyStore::ValueOp>(
+            CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_OP)).GetCurSel()),
+        .value = GetDlgItemString(GetDlgItem(IDC_PROPERTY_QUERY_VALUE)),
+        .groupBy = static_cast<PropertyStore::GroupBy>(
+            CComboBox(GetDlgItem(IDC_PROPERTY_QUERY_GROUP_BY)).GetCurSel()),
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = m_store.Run(query);
+    auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+
+    m_groups = std::move(result.groups);
+
+    auto list = CListViewCtrl(GetDlgItem(IDC_PROPERTY_QUERY_RESULTS));
+    list.SetRedraw(FALSE);
+    list.DeleteAllItems();
+
+    size_t listedCount = std::min(m_groups.size(), kMaxListedGroups);
+    for (int row = 0; row < static_cast<int>(listedCount); row++) {
+        const auto& group = m_groups[row];
+
+        std::wstring key = group.key;
+        if (query.groupBy == PropertyStore::GroupBy::Source) {
+            key = m_sourceToString(group.source);
+        } else if (key.empty()) {
+            key = L"(empty)";
+        }
+
+        list.AddItem(row, 0, key.c_str());
+        list.AddItem(row, 1, std::to_wstring(group.count).c_str());
+    }
+
+    if (listedCount > 0) {
+        list.SelectItem(0);
+    }
+
+    list.SetRedraw(TRUE);
+
+    GetDlgItem(IDOK).EnableWindow(listedCount > 0);
+
+    auto status = std::format(
+        L"{} of {} values matched, {} groups{}, {:.2f} ms", result.matchedRows,
+        result.scannedRows, m_groups.size(),
+        listedCount < m_groups.size()
+            ? std::format(L" ({} listed)", listedCount)
+            : L"",
+        elapsed.count());
+    SetDlgItemText(IDC_PROPERTY_QUERY_STATUS, status.c_str());
+}
+
+void CPropertyQueryDlg::OnOK(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    auto list = CListViewCtrl(GetDlgItem(IDC_PROPERTY_QUERY_RESULTS));
+    int index = list.GetSelectedIndex();
+    if (index < 0 || index >= static_cast<int>(m_groups.size())) {
+        return;
+    }
+
+    m_selectedHandle = m_groups[index].firstHandle;
+    EndDialog(nID);
+}
+
+void CPropertyQueryDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    EndDialog(nID);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "property_store.h"
+#include "resource.h"
+
+class CPropertyQueryDlg : public CDialogImpl<CPropertyQueryDlg>,
+                          public CDialogResize<CPropertyQueryDlg> {
+   public:
+    enum { IDD = IDD_PROPERTY_QUERY };
+
+    using SourceToString = std::function<std::wstring(std::int32_t source)>;
+
+    CPropertyQueryDlg(const PropertyStore& store, SourceToString sourceToString);
+
+    // Valid if the dialog was closed with IDOK.
+    InstanceHandle GetSelectedHandle() const { return m_selectedHandle; }
+
+   private:
+    BEGIN_MSG_MAP_EX(CPropertyQueryDlg)
+        CHAIN_MSG_MAP(CDialogResize<CPropertyQueryDlg>)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        NOTIFY_HANDLER_EX(IDC_PROPERTY_QUERY_RESULTS, NM_DBLCLK,
+                          OnResultsDblClk)
+        COMMAND_ID_HANDLER_EX(IDC_PROPERTY_QUERY_RUN, OnRun)
+        COMMAND_ID_HANDLER_EX(IDOK, OnOK)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    END_MSG_MAP()
+
+    BEGIN_DLGRESIZE_MAP(CPropertyQueryDlg)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_QUERY_VALUE, DLSZ_SIZE_X)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_QUERY_RUN, DLSZ_MOVE_X)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_QUERY_STATUS, DLSZ_SIZE_X)
+        DLGRESIZE_CONTROL(IDC_PROPERTY_QUERY_RESULTS, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+        DLGRESIZE_CONTROL(IDOK, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDCANCEL, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+    END_DLGRESIZE_MAP()
+
+    BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
+    LRESULT OnResultsDblClk(LPNMHDR pnmh);
+    void OnRun(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnOK(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl);
+
+    const PropertyStore& m_store;
+    SourceToString m_sourceToString;
+    std::vector<PropertyStore::Group> m_groups;
+    InstanceHandle m_selectedHandle = 0;
+};
@@ -0,0 +1,69 @@
+#include "stdafx.h"
+
+#include "RepeatedSubtreesDlg.h"
+
+CRepeatedSubtreesDlg::CRepeatedSubtreesDlg(std::vector<Row> rows)
+    : m_rows(std::move(rows)) {}
+
+BOOL CRepeatedSubtreesDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
+    DlgResize_Init();
+
+    auto list = CListViewCtrl(GetDlgItem(IDC_REPEATED_SUBTREES_LIST));
+    list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_LABELTIP |
+                                  LVS_EX_DOUBLEBUFFER);
+    ::SetWindowTheme(list, L"Explorer", nullptr);
+
+    CRect rect;
+    list.GetClientRect(rect);
+    int width = rect.Width() - ::GetSystemMetrics(SM_CXVSCROLL);
+
+    int c = 0;
+    list.InsertColumn(c++, L"Subtree", LVCFMT_LEFT, width * 4 / 10);
+    list.InsertColumn(c++, L"Count", LVCFMT_RIGHT, width * 2 / 10);
+    list.InsertColumn(c++, L"Elements", LVCFMT_RIGHT, width * 2 / 10);
+    list.InsertColumn(c++, L"Total", LVCFMT_RIGHT, width * 2 / 10);
+
+    for (int row = 0; row < static_cast<int>(m_rows.size()); row++) {
+        const auto& r = m_rows[row];
+
+        c = 0;
+        list.AddItem(row, c++, r.title.c_str());
+        list.AddItem(row, c++, std::to_wstring(r.count).c_str());
+        list.AddItem(row, c++, std::to_wstring(r.subtreeSize).c_str());
+        list.AddItem(row, c++, std::to_wstring(r.count * r.subtreeSize).c_str());
+    }
+
+    if (!m_rows.empty()) {
+        list.SelectItem(0);
+    } else {
+        list.AddItem(0, 0, L"No repeated subtrees found");
+        GetDlgItem(IDOK).EnableWindow(FALSE);
+    }
+
+    return TRUE;
+}
+
+LRESULT CRepeatedSubtreesDlg::OnListDblClk(LPNMHDR pnmh) {
+    auto itemActivate = reinterpret_cast<LPNMITEMACTIVATE>(pnmh);
+    if (itemActivate->iItem == -1) {
+        return 0;
+    }
+
+    OnOK(0, IDOK, nullptr);
+    return 0;
+}
+
+void CRepeatedSubtreesDlg::OnOK(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    auto list = CListViewCtrl(GetDlgItem(IDC_REPEATED_SUBTREES_LIST));
+    int index = list.GetSelectedIndex();
+    if (index < 0 || index >= static_cast<int>(m_rows.size())) {
+        return;
+    }
+
+    m_selectedHandle = m_rows[index].representative;
+    EndDialog(nID);
+}
+
+void CRepeatedSubtreesDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    EndDialog(nID);
+}
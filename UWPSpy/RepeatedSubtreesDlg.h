@@ -0,0 +1,44 @@
+#pragma once
+
+#include "resource.h"
+
+class CRepeatedSubtreesDlg : public CDialogImpl<CRepeatedSubtreesDlg>,
+                             public CDialogResize<CRepeatedSubtreesDlg> {
+   public:
+    enum { IDD = IDD_REPEATED_SUBTREES };
+
+    struct Row {
+        std::wstring title;
+        InstanceHandle representative;
+        UINT64 count;
+        UINT64 subtreeSize;
+    };
+
+    CRepeatedSubtreesDlg(std::vector<Row> rows);
+
+    // Valid if the dialog was closed with IDOK.
+    InstanceHandle GetSelectedHandle() const { return m_selectedHandle; }
+
+   private:
+    BEGIN_MSG_MAP_EX(CRepeatedSubtreesDlg)
+        CHAIN_MSG_MAP(CDialogResize<CRepeatedSubtreesDlg>)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        NOTIFY_HANDLER_EX(IDC_REPEATED_SUBTREES_LIST, NM_DBLCLK, OnListDblClk)
+        COMMAND_ID_HANDLER_EX(IDOK, OnOK)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    END_MSG_MAP()
+
+    BEGIN_DLGRESIZE_MAP(CRepeatedSubtreesDlg)
+        DLGRESIZE_CONTROL(IDC_REPEATED_SUBTREES_LIST, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+        DLGRESIZE_CONTROL(IDOK, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDCANCEL, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+    END_DLGRESIZE_MAP()
+
+    BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
+    LRESULT OnListDblClk(LPNMHDR pnmh);
+    void OnOK(UINT uNotifyCode, int nID, CWindow wndCtl);
+    void OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl);
+
+    std::vector<Row> m_rows;
+    InstanceHandle m_selectedHandle = 0;
+};
@@ -0,0 +1,166 @@
+#include "stdafx.h"
+
+#include "TreeHistoryDlg.h"
+
+namespace {
+
+// The slider position unit.
+constexpr UINT64 kSliderStepMs = 100;
+
+}  // namespace
+
+CTreeHistoryDlg::CTreeHistoryDlg(const TreeHistory& history,
+                                 UINT64 nowMs,
+                                 InstanceHandle selectedHandle)
+    : m_history(history),
+      m_nowMs(nowMs),
+      m_oldestMs(history.OldestTime().value_or(nowMs)),
+      m_selectedHandle(selectedHandle) {}
+
+BOOL CTreeHistoryDlg::OnInitDialog(CWindow wndFocus, LPARAM lInitParam) {
+    DlgResize_Init();
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_TREE_HISTORY_TREE));
+    ::SetWindowTheme(treeView, L"Explorer", nullptr);
+
+    int steps = static_cast<int>((m_nowMs - m_oldestMs) / kSliderStepMs);
+
+    auto slider = CTrackBarCtrl(GetDlgItem(IDC_TREE_HISTORY_SLIDER));
+    slider.SetRange(0, steps);
+    slider.SetPageSize(10);  // 1 second
+    slider.SetPos(steps);
+
+    ShowTree();
+
+    return TRUE;
+}
+
+void CTreeHistoryDlg::OnHScroll(UINT nSBCode, UINT nPos, CScrollBar pScrollBar) {
+    if (pScrollBar.GetDlgCtrlID() != IDC_TREE_HISTORY_SLIDER) {
+        return;
+    }
+
+    // Rebuilding a large tree on every thumb move is too slow, only update the
+    // time while dragging.
+    if (nSBCode == TB_THUMBTRACK) {
+        UpdateTimeText(std::nullopt);
+        return;
+    }
+
+    if (nSBCode == TB_ENDTRACK) {
+        return;
+    }
+
+    ShowTree();
+}
+
+LRESULT CTreeHistoryDlg::OnTreeSelChanged(LPNMHDR pnmh) {
+    if (m_populating) {
+        return 0;
+    }
+
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_TREE_HISTORY_TREE));
+    auto selectedItem = treeView.GetSelectedItem();
+    if (selectedItem) {
+        m_selectedHandle = static_cast<InstanceHandle>(selectedItem.GetData());
+    }
+
+    return 0;
+}
+
+void CTreeHistoryDlg::OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl) {
+    EndDialog(nID);
+}
+
+UINT64 CTreeHistoryDlg::SliderTime() {
+    auto slider = CTrackBarCtrl(GetDlgItem(IDC_TREE_HISTORY_SLIDER));
+    UINT64 timeMs = m_oldestMs + slider.GetPos() * kSliderStepMs;
+    return std::min(timeMs, m_nowMs);
+}
+
+void CTreeHistoryDlg::UpdateTimeText(std::optional<size_t> elementCount) {
+    UINT64 agoMs = m_nowMs - SliderTime();
+
+    std::wstring text;
+    if (agoMs == 0) {
+        text = L"Now";
+    } else {
+        text = std::format(L"{}.{} seconds ago", agoMs / 1000,
+                           agoMs % 1000 / 100);
+    }
+
+    if (elementCount) {
+        text += std::format(L", {} elements", *elementCount);
+    } else if (!m_populating) {
+        text += L"...";
+    }
+
+    SetDlgItemText(IDC_TREE_HISTORY_TIME, text.c_str());
+}
+
+void CTreeHistoryDlg::ShowTree() {
+    auto treeView = CTreeViewCtrlEx(GetDlgItem(IDC_TREE_HISTORY_TREE));
+
+    auto state = m_history.Reconstruct(SliderTime());
+
+    m_populating = true;
+
+    treeView.SetRedraw(FALSE);
+    treeView.DeleteAllItems();
+
+    if (!state) {
+        treeView.InsertItem(L"The history for this time was discarded",
+                            TVI_ROOT, TVI_LAST);
+        treeView.SetRedraw(TRUE);
+        UpdateTimeText(std::nullopt);
+        m_populating = false;
+        return;
+    }
+
+    CTreeItem selectedItem;
+
+    // Iterative, the reconstructed tree might be deep.
+    std::vector<std::pair<TreeHistory::Handle, HTREEITEM>> stack;
+    if (auto it = state->children.find(0); it != state->children.end()) {
+        for (auto i = it->second.rbegin(); i != it->second.rend(); ++i) {
+            stack.emplace_back(*i, TVI_ROOT);
+        }
+    }
+
+    while (!stack.empty()) {
+        auto [handle, parentItem] = stack.back();
+        stack.pop_back();
+
+        auto it = state->elements.find(handle);
+        if (it == state->elements.end()) {
+            continue;
+        }
+
+        auto item = treeView.InsertItem(
+            m_history.Title(it->second.title).c_str(), parentItem, TVI_LAST);
+        item.SetData(static_cast<DWORD_PTR>(handle));
+
+        if (handle == m_selectedHandle) {
+            selectedItem = item;
+        }
+
+        if (auto itChildren = state->children.find(handle);
+            itChildren != state->children.end()) {
+            const auto& childHandles = itChildren->second;
+            for (auto i = childHandles.rbegin(); i != childHandles.rend(); ++i) {
+                stack.emplace_back(*i, item);
+            }
+        }
+    }
+
+    if (selectedItem) {
+        selectedItem.Select();
+        selectedItem.EnsureVisible();
+    }
+
+    treeView.SetRedraw(TRUE);
+
+    UpdateTimeText(state->elements.size());
+
+    m_populating = false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "resource.h"
+#include "tree_history.h"
+
+class CTreeHistoryDlg : public CDialogImpl<CTreeHistoryDlg>,
+                        public CDialogResize<CTreeHistoryDlg> {
+   public:
+    enum { IDD = IDD_TREE_HISTORY };
+
+    // The history keeps being recorded while the dialog is open, the dialog
+    // only shows the range up to the time it was opened.
+    CTreeHistoryDlg(const TreeHistory& history,
+                    UINT64 nowMs,
+                    InstanceHandle selectedHandle);
+
+   private:
+    BEGIN_MSG_MAP_EX(CTreeHistoryDlg)
+        CHAIN_MSG_MAP(CDialogResize<CTreeHistoryDlg>)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        MSG_WM_HSCROLL(OnHScroll)
+        NOTIFY_HANDLER_EX(IDC_TREE_HISTORY_TREE, TVN_SELCHANGED,
+                          OnTreeSelChanged)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    END_MSG_MAP()
+
+    BEGIN_DLGRESIZE_MAP(CTreeHistoryDlg)
+        DLGRESIZE_CONTROL(IDC_TREE_HISTORY_SLIDER, DLSZ_SIZE_X)
+        DLGRESIZE_CONTROL(IDC_TREE_HISTORY_TIME, DLSZ_SIZE_X)
+        DLGRESIZE_CONTROL(IDC_TREE_HISTORY_TREE, DLSZ_SIZE_X | DLSZ_SIZE_Y)
+        DLGRESIZE_CONTROL(IDCANCEL, DLSZ_MOVE_X | DLSZ_MOVE_Y)
+    END_DLGRESIZE_MAP()
+
+    BOOL OnInitDialog(CWindow wndFocus, LPARAM lInitParam);
+    void OnHScroll(UINT nSBCode, UINT nPos, CScrollBar pScrollBar);
+    LRESULT OnTreeSelChanged(LPNMHDR pnmh);
+    void OnCancel(UINT uNotifyCode, int nID, CWindow wndCtl);
+
+    UINT64 SliderTime();
+    void UpdateTimeText(std::optional<size_t> elementCount);
+    void ShowTree();
+
+    const TreeHistory& m_history;
+    UINT64 m_nowMs;
+    UINT64 m_oldestMs;
+    InstanceHandle m_selectedHandle;
+    bool m_populating = false;
+};
@@ -0,0 +1,262 @@
+#include "stdafx.h"
+
+#include "ancestor_index.h"
+
+void AncestorIndex::Insert(Handle handle, Handle parent) {
+    if (Contains(handle)) {
+        Remove(handle);
+    }
+
+    Index index = AllocateNode();
+    m_nodes[index].handle = handle;
+    m_handleToIndex[handle] = index;
+
+    Index parentIndex = parent ? Find(parent) : kInvalidIndex;
+    if (parentIndex != kInvalidIndex) {
+        Link(index, parentIndex);
+        m_nodes[parentIndex].children.push_back(index);
+    } else {
+        auto& node = m_nodes[index];
+        node.pendingParent = parent;
+        node.parent = index;
+        node.jump = index;
+        node.root = index;
+        node.depth = 0;
+
+        if (parent) {
+            m_pendingChildren[parent].push_back(index);
+        }
+    }
+
+    if (auto it = m_pendingChildren.find(handle);
+        it != m_pendingChildren.end()) {
+        auto pendingChildren = std::move(it->second);
+        m_pendingChildren.erase(it);
+
+        for (Index childIndex : pendingChildren) {
+            m_nodes[childIndex].pendingParent = 0;
+            Relink(childIndex, index);
+        }
+    }
+}
+
+void AncestorIndex::Remove(Handle handle) {
+    Index index = Find(handle);
+    if (index == kInvalidIndex) {
+        return;
+    }
+
+    auto& node = m_nodes[index];
+
+    if (node.pendingParent) {
+        auto it = m_pendingChildren.find(node.pendingParent);
+        if (it != m_pendingChildren.end()) {
+            auto& siblings = it->second;
+            siblings.erase(std::remove(siblings.begin(), siblings.end(), index),
+                           siblings.end());
+            if (siblings.empty()) {
+                m_pendingChildren.erase(it);
+            }
+        }
+    } else if (node.parent != index) {
+        auto& siblings = m_nodes[node.parent].children;
+        auto it = std::find(siblings.begin(), siblings.end(), index);
+        if (it != siblings.end()) {
+            *it = siblings.back();
+            siblings.pop_back();
+        }
+    }
+
+    // The children stay in the index as fragments waiting for the element to
+    // be inserted again, the same way the element tree keeps them.
+    auto children = std::move(node.children);
+    node.children.clear();
+    for (Index childIndex : children) {
+        auto& child = m_nodes[childIndex];
+        child.pendingParent = handle;
+        m_pendingChildren[handle].push_back(childIndex);
+        Relink(childIndex, kInvalidIndex);
+    }
+
+    m_handleToIndex.erase(handle);
+    m_freeNodes.push_back(index);
+}
+
+bool AncestorIndex::Contains(Handle handle) const {
+    return Find(handle) != kInvalidIndex;
+}
+
+AncestorIndex::Handle AncestorIndex::Root(Handle handle) const {
+    Index index = Find(handle);
+    if (index == kInvalidIndex) {
+        return 0;
+    }
+
+    return m_nodes[m_nodes[index].root].handle;
+}
+
+bool AncestorIndex::IsAttached(Handle handle) const {
+    Index index = Find(handle);
+    if (index == kInvalidIndex) {
+        return false;
+    }
+
+    return !m_nodes[m_nodes[index].root].pendingParent;
+}
+
+std::optional<std::uint32_t> AncestorIndex::Depth(Handle handle) const {
+    Index index = Find(handle);
+    if (index == kInvalidIndex) {
+        return std::nullopt;
+    }
+
+    return m_nodes[index].depth;
+}
+
+AncestorIndex::Handle AncestorIndex::AncestorAtDepth(
+    Handle handle,
+    std::uint32_t depth) const {
+    Index index = Find(handle);
+    if (index == kInvalidIndex) {
+        return 0;
+    }
+
+    index = AncestorAtDepth(index, depth);
+    if (index == kInvalidIndex) {
+        return 0;
+    }
+
+    return m_nodes[index].handle;
+}
+
+bool AncestorIndex::IsAncestor(Handle ancestor, Handle descendant) const {
+    Index ancestorIndex = Find(ancestor);
+    Index descendantIndex = Find(descendant);
+    if (ancestorIndex == kInvalidIndex || descendantIndex == kInvalidIndex) {
+        return false;
+    }
+
+    const auto& ancestorNode = m_nodes[ancestorIndex];
+    const auto& descendantNode = m_nodes[descendantIndex];
+    if (ancestorNode.root != descendantNode.root ||
+        ancestorNode.depth > descendantNode.depth) {
+        return false;
+    }
+
+    return AncestorAtDepth(descendantIndex, ancestorNode.depth) ==
+           ancestorIndex;
+}
+
+AncestorIndex::Handle AncestorIndex::LowestCommonAncestor(Handle a,
+                                                          Handle b) const {
+    Index aIndex = Find(a);
+    Index bIndex = Find(b);
+    if (aIndex == kInvalidIndex || bIndex == kInvalidIndex ||
+        m_nodes[aIndex].root != m_nodes[bIndex].root) {
+        return 0;
+    }
+
+    std::uint32_t depth = std::min(m_nodes[aIndex].depth, m_nodes[bIndex].depth);
+    aIndex = AncestorAtDepth(aIndex, depth);
+    bIndex = AncestorAtDepth(bIndex, depth);
+
+    // Jump pointers only depend on the depth, so both sides always jump by the
+    // same distance.
+    while (aIndex != bIndex) {
+        Index aJump = m_nodes[aIndex].jump;
+        Index bJump = m_nodes[bIndex].jump;
+        if (aJump != bJump) {
+            aIndex = aJump;
+            bIndex = bJump;
+        } else {
+            aIndex = m_nodes[aIndex].parent;
+            bIndex = m_nodes[bIndex].parent;
+        }
+    }
+
+    return m_nodes[aIndex].handle;
+}
+
+AncestorIndex::Index AncestorIndex::Find(Handle handle) const {
+    auto it = m_handleToIndex.find(handle);
+    if (it == m_handleToIndex.end()) {
+        return kInvalidIndex;
+    }
+
+    return it->second;
+}
+
+AncestorIndex::Index AncestorIndex::AllocateNode() {
+    if (!m_freeNodes.empty()) {
+        Index index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_nodes[index] = {};
+        return index;
+    }
+
+    m_nodes.emplace_back();
+    return static_cast<Index>(m_nodes.size() - 1);
+}
+
+void AncestorIndex::Link(Index index, Index parent) {
+    const auto& parentNode = m_nodes[parent];
+    Index parentJump = parentNode.jump;
+    const auto& parentJumpNode = m_nodes[parentJump];
+    const auto& parentJumpJumpNode = m_nodes[parentJumpNode.jump];
+
+    auto& node = m_nodes[index];
+    node.parent = parent;
+    node.root = parentNode.root;
+    node.depth = parentNode.depth + 1;
+
+    if (parentNode.depth - parentJumpNode.depth ==
+        parentJumpNode.depth - parentJumpJumpNode.depth) {
+        node.jump = parentJumpNode.jump;
+    } else {
+        node.jump = parent;
+    }
+}
+
+// Links the node to a new parent, or makes it a root if parent is
+// kInvalidIndex, and updates its whole subtree.
+void AncestorIndex::Relink(Index index, Index parent) {
+    if (parent != kInvalidIndex) {
+        Link(index, parent);
+        m_nodes[parent].children.push_back(index);
+    } else {
+        auto& node = m_nodes[index];
+        node.parent = index;
+        node.jump = index;
+        node.root = index;
+        node.depth = 0;
+    }
+
+    std::vector<Index> stack{index};
+    while (!stack.empty()) {
+        Index current = stack.back();
+        stack.pop_back();
+
+        for (Index childIndex : m_nodes[current].children) {
+            Link(childIndex, current);
+            stack.push_back(childIndex);
+        }
+    }
+}
+
+AncestorIndex::Index AncestorIndex::AncestorAtDepth(Index index,
+                                                    std::uint32_t depth) const {
+    if (m_nodes[index].depth < depth) {
+        return kInvalidIndex;
+    }
+
+    while (m_nodes[index].depth > depth) {
+        Index jump = m_nodes[index].jump;
+        if (m_nodes[jump].depth >= depth) {
+            index = jump;
+        } else {
+            index = m_nodes[index].parent;
+        }
+    }
+
+    return index;
+}
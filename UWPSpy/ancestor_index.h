@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Maintains depth, root and jump pointers for every element, so that root
+// lookup is O(1), and ancestor tests and lowest common ancestor queries are
+// O(log n), without walking the parent chain.
+//
+// The jump pointers follow the skew-binary scheme (E. W. Myers, "An applicative
+// random-access stack", 1983): a node's jump pointer depends only on its parent
+// and is O(1) to compute on insertion.
+//
+// Like the element tree, children may be inserted before their parent. Such a
+// fragment is indexed with its topmost element as a temporary root, and is
+// attached once the parent is inserted.
+class AncestorIndex {
+   public:
+    using Handle = std::uint64_t;
+
+    void Insert(Handle handle, Handle parent);
+    void Remove(Handle handle);
+
+    bool Contains(Handle handle) const;
+
+    // Returns the topmost known ancestor (or the handle itself), 0 if the
+    // handle isn't indexed. The returned root might not be a real root if its
+    // parent wasn't inserted yet, see IsAttached.
+    Handle Root(Handle handle) const;
+
+    // Returns false if the handle's root is waiting for its parent.
+    bool IsAttached(Handle handle) const;
+
+    std::optional<std::uint32_t> Depth(Handle handle) const;
+
+    // Returns the ancestor of the handle at the given depth, 0 if there's no
+    // such ancestor.
+    Handle AncestorAtDepth(Handle handle, std::uint32_t depth) const;
+
+    // A handle is considered to be an ancestor of itself.
+    bool IsAncestor(Handle ancestor, Handle descendant) const;
+
+    // Returns 0 if the handles aren't in the same tree.
+    Handle LowestCommonAncestor(Handle a, Handle b) const;
+
+   private:
+    using Index = std::uint32_t;
+    static constexpr Index kInvalidIndex = static_cast<Index>(-1);
+
+    struct Node {
+        Handle handle;
+        // Set if the parent wasn't inserted yet, or was removed.
+        Handle pendingParent;
+        Index parent;  // Self for roots.
+        Index jump;    // Self for roots.
+        Index root;
+        std::uint32_t depth;
+        std::vector<Index> children;
+    };
+
+    Index Find(Handle handle) const;
+    Index AllocateNode();
+    void Link(Index index, Index parent);
+    void Relink(Index index, Index parent);
+    Index AncestorAtDepth(Index index, std::uint32_t depth) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<Index> m_freeNodes;
+    std::unordered_map<Handle, Index> m_handleToIndex;
+    // Fragment roots waiting for their parent to be inserted.
+    std::unordered_map<Handle, std::vector<Index>> m_pendingChildren;
+};
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+
+#include "attribute_filter_index.h"
+
+void AttributeFilterIndex::Clear() {
+    m_text.clear();
+    m_entries.clear();
+    m_lastValid = false;
+    m_matches.clear();
+}
+
+void AttributeFilterIndex::Add(std::wstring_view name,
+                               std::wstring_view value) {
+    Entry entry{
+        .offset = static_cast<std::uint32_t>(m_text.size()),
+        .nameLength = static_cast<std::uint32_t>(name.size()),
+        .length = static_cast<std::uint32_t>(name.size() + 1 + value.size()),
+    };
+
+    for (wchar_t c : name) {
+        m_text.push_back(TextSearch::FoldChar(c));
+    }
+
+    m_text.push_back(L'\0');
+
+    for (wchar_t c : value) {
+        m_text.push_back(TextSearch::FoldChar(c));
+    }
+
+    m_entries.push_back(entry);
+    m_lastValid = false;
+}
+
+const std::vector<std::uint32_t>& AttributeFilterIndex::Filter(
+    const TextSearch::Pattern& pattern) {
+    const std::wstring& needle = pattern.Folded();
+    bool prefix = pattern.IsPrefix();
+
+    if (m_lastValid && needle == m_lastNeedle && prefix == m_lastPrefix) {
+        return m_matches;
+    }
+
+    // Rows which don't contain the previous needle can't contain a needle
+    // that contains it. Similarly for prefixes, and a prefix match is also a
+    // substring match.
+    bool narrow = false;
+    if (m_lastValid) {
+        narrow = m_lastPrefix
+                     ? prefix && needle.starts_with(m_lastNeedle)
+                     : needle.find(m_lastNeedle) != needle.npos;
+    }
+
+    m_candidates.swap(m_matches);
+    m_matches.clear();
+
+    auto check = [this, &needle, prefix](std::uint32_t i) {
+        const Entry& entry = m_entries[i];
+        std::wstring_view text(m_text.data() + entry.offset, entry.length);
+        bool matches;
+        if (prefix) {
+            matches = TextSearch::StartsWithFolded(
+                          text.substr(0, entry.nameLength), needle) ||
+                      TextSearch::StartsWithFolded(
+                          text.substr(entry.nameLength + 1), needle);
+        } else {
+            matches = TextSearch::ContainsFolded(text, needle);
+        }
+
+        if (matches) {
+            m_matches.push_back(i);
+        }
+    };
+
+    if (narrow) {
+        for (std::uint32_t i : m_candidates) {
+            check(i);
+        }
+    } else {
+        for (std::uint32_t i = 0; i < m_entries.size(); i++) {
+            check(i);
+        }
+    }
+
+    m_lastNeedle = needle;
+    m_lastPrefix = prefix;
+    m_lastValid = true;
+    return m_matches;
+}
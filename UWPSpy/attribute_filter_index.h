@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_search.h"
+
+// The case-folded names and values of the rows of the attributes list, so
+// that the filter can be applied on each keystroke without formatting the
+// rows or fetching the property chain again. When the filter text grows, as
+// it does while typing, only the rows which matched the previous filter are
+// checked.
+class AttributeFilterIndex {
+   public:
+    void Clear();
+    void Add(std::wstring_view name, std::wstring_view value);
+
+    size_t Size() const { return m_entries.size(); }
+
+    // Returns the indices of the rows whose name or value matches the
+    // pattern, in the order they were added. The result is valid until the
+    // index is modified.
+    const std::vector<std::uint32_t>& Filter(const TextSearch::Pattern& pattern);
+
+   private:
+    struct Entry {
+        std::uint32_t offset;
+        std::uint32_t nameLength;
+        std::uint32_t length;
+    };
+
+    // The name and the value of each row, separated with a null character
+    // so that a match can't span both.
+    std::vector<wchar_t> m_text;
+    std::vector<Entry> m_entries;
+
+    bool m_lastValid = false;
+    std::wstring m_lastNeedle;
+    bool m_lastPrefix = false;
+    std::vector<std::uint32_t> m_matches;
+    std::vector<std::uint32_t> m_candidates;
+};
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+
+#include "detail_load_scheduler.h"
+
+void DetailLoadScheduler::Request(Handle handle,
+                                  std::vector<Handle> neighbors,
+                                  bool loadStages) {
+    m_handle = handle;
+
+    m_stages.clear();
+    if (loadStages) {
+        m_stages = {TaskKind::Summary, TaskKind::Attributes,
+                    TaskKind::VisualStates};
+    }
+
+    m_prefetch.clear();
+    for (Handle neighbor : neighbors) {
+        if (neighbor != handle) {
+            m_prefetch.push_back(neighbor);
+        }
+    }
+}
+
+void DetailLoadScheduler::Cancel() {
+    m_handle = 0;
+    m_stages.clear();
+    m_prefetch.clear();
+}
+
+std::optional<DetailLoadScheduler::Task> DetailLoadScheduler::Next() {
+    if (!m_stages.empty()) {
+        TaskKind kind = m_stages.front();
+        m_stages.pop_front();
+        return Task{
+            .kind = kind,
+            .handle = m_handle,
+        };
+    }
+
+    if (!m_prefetch.empty()) {
+        Handle handle = m_prefetch.front();
+        m_prefetch.pop_front();
+        return Task{
+            .kind = TaskKind::Prefetch,
+            .handle = handle,
+        };
+    }
+
+    return std::nullopt;
+}
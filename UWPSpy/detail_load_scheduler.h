@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+// Decides what to load next for the selected element details. The details are
+// loaded in stages, one stage per call, so that input such as a held arrow key
+// is handled between the stages. A new request cancels the pending stages of
+// the previous one. Once the selected element is fully loaded, the neighbors
+// of the selected element are prefetched, one per call.
+//
+// The diagnostics interface must be used on the UI thread, so nothing here is
+// asynchronous by itself, the caller runs the tasks from a timer.
+class DetailLoadScheduler {
+   public:
+    using Handle = std::uint64_t;
+
+    enum class TaskKind {
+        Summary,  // Class, name and rect.
+        Attributes,
+        VisualStates,
+        Prefetch,
+    };
+
+    struct Task {
+        TaskKind kind;
+        Handle handle;
+    };
+
+    // Replaces all pending tasks. If loadStages is false, the element was
+    // already loaded by the caller and only the neighbors are prefetched.
+    void Request(Handle handle,
+                 std::vector<Handle> neighbors,
+                 bool loadStages = true);
+
+    void Cancel();
+
+    // Returns and removes the next task, or nullopt if there is nothing to
+    // do.
+    std::optional<Task> Next();
+
+    bool HasPendingStages() const { return !m_stages.empty(); }
+    bool HasPendingTasks() const {
+        return !m_stages.empty() || !m_prefetch.empty();
+    }
+
+   private:
+    Handle m_handle = 0;
+    std::deque<TaskKind> m_stages;
+    std::deque<Handle> m_prefetch;
+};
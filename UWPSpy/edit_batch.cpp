@@ -0,0 +1,31 @@
+#include "stdafx.h"
+
+#include "edit_batch.h"
+
+void EditBatch::Add(Operation operation) {
+    // Merge with the previous operation if it sets the same value on the same
+    // property, so that adding elements one by one results in a single
+    // operation. Earlier operations aren't merged with, since that would
+    // change the order of the edits.
+    if (!m_operations.empty()) {
+        auto& last = m_operations.back();
+        if (last.propertyIndex == operation.propertyIndex &&
+            last.value == operation.value) {
+            last.elements.insert(last.elements.end(),
+                                 operation.elements.begin(),
+                                 operation.elements.end());
+            return;
+        }
+    }
+
+    m_operations.push_back(std::move(operation));
+}
+
+size_t EditBatch::EditCount() const {
+    size_t count = 0;
+    for (const auto& operation : m_operations) {
+        count += operation.elements.size();
+    }
+
+    return count;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A list of property edits which are applied together, e.g. the same change to
+// many list items. Each distinct value is created once and shared by all of
+// its edits. If an edit fails, the edits which were already made are rolled
+// back, so that the batch is applied either completely or not at all.
+class EditBatch {
+   public:
+    using Handle = std::uint64_t;
+    // An HRESULT, negative values are failures.
+    using Status = std::int32_t;
+
+    // The local value of a property. If not local, the property is cleared.
+    // Otherwise, it's set to valueHandle if it's not zero, or to a new
+    // instance created from type and value.
+    struct PropertyValue {
+        bool local = false;
+        Handle valueHandle = 0;
+        std::wstring type;
+        std::wstring value;
+
+        bool operator==(const PropertyValue&) const = default;
+    };
+
+    struct Operation {
+        std::vector<Handle> elements;
+        std::uint32_t propertyIndex;
+        PropertyValue value;
+    };
+
+    // An edit which was made, with the value it replaced.
+    struct Edit {
+        Handle element;
+        std::uint32_t propertyIndex;
+        PropertyValue before;
+        PropertyValue after;
+    };
+
+    struct Result {
+        Status status = 0;
+        // The edits in the order they were made. Empty on failure.
+        std::vector<Edit> edits;
+        size_t valuesCreated = 0;
+        // Set on failure.
+        Handle failedElement = 0;
+        bool rolledBack = false;
+        size_t rollbackFailures = 0;
+    };
+
+    void Add(Operation operation);
+    void Clear() { m_operations.clear(); }
+
+    bool Empty() const { return m_operations.empty(); }
+    const std::vector<Operation>& Operations() const { return m_operations; }
+    size_t EditCount() const;
+
+    // The service must implement:
+    //   Status CreateValue(const std::wstring& type, const std::wstring& value,
+    //                      Handle* valueHandle);
+    //   Status GetPreviousValue(Handle element, std::uint32_t propertyIndex,
+    //                           PropertyValue* previous);
+    //   Status SetValue(Handle element, std::uint32_t propertyIndex,
+    //                   Handle valueHandle);
+    //   Status ClearValue(Handle element, std::uint32_t propertyIndex);
+    //
+    // No other work should be done between the calls, e.g. processing window
+    // messages, so that the app sees the batch as a single change.
+    template <typename Service>
+    Result Apply(Service& service) const {
+        Result result;
+        result.edits.reserve(EditCount());
+
+        std::unordered_map<std::wstring, Handle> createdValues;
+
+        for (const auto& operation : m_operations) {
+            const PropertyValue& value = operation.value;
+
+            Handle valueHandle = value.valueHandle;
+            if (value.local && !valueHandle) {
+                std::wstring valueKey = value.type;
+                valueKey += L'\0';
+                valueKey += value.value;
+
+                if (auto it = createdValues.find(valueKey);
+                    it != createdValues.end()) {
+                    valueHandle = it->second;
+                } else {
+                    result.status = service.CreateValue(
+                        value.type, value.value, &valueHandle);
+                    if (result.status < 0) {
+                        break;
+                    }
+
+                    result.valuesCreated++;
+                    createdValues.emplace(std::move(valueKey), valueHandle);
+                }
+            }
+
+            for (Handle element : operation.elements) {
+                // An edit whose previous value is unknown can't be rolled
+                // back, so it isn't made.
+                PropertyValue previous;
+                result.status = service.GetPreviousValue(
+                    element, operation.propertyIndex, &previous);
+                if (result.status >= 0) {
+                    result.status =
+                        value.local ? service.SetValue(element,
+                                                       operation.propertyIndex,
+                                                       valueHandle)
+                                    : service.ClearValue(
+                                          element, operation.propertyIndex);
+                }
+
+                if (result.status < 0) {
+                    result.failedElement = element;
+                    break;
+                }
+
+                result.edits.push_back({
+                    .element = element,
+                    .propertyIndex = operation.propertyIndex,
+                    .before = std::move(previous),
+                    .after = value,
+                });
+            }
+
+            if (result.status < 0) {
+                break;
+            }
+        }
+
+        if (result.status >= 0) {
+            return result;
+        }
+
+        // Restore in reverse order, so that an element edited more than once
+        // ends up with its original value.
+        for (auto it = result.edits.rbegin(); it != result.edits.rend();
+             ++it) {
+            if (Restore(service, it->element, it->propertyIndex, it->before) <
+                0) {
+                result.rollbackFailures++;
+            }
+        }
+
+        result.edits.clear();
+        result.rolledBack = true;
+        return result;
+    }
+
+   private:
+    template <typename Service>
+    static Status Restore(Service& service,
+                          Handle element,
+                          std::uint32_t propertyIndex,
+                          const PropertyValue& value) {
+        if (!value.local) {
+            return service.ClearValue(element, propertyIndex);
+        }
+
+        Handle valueHandle = value.valueHandle;
+        if (!valueHandle) {
+            Status status =
+                service.CreateValue(value.type, value.value, &valueHandle);
+            if (status < 0) {
+                return status;
+            }
+        }
+
+        return service.SetValue(element, propertyIndex, valueHandle);
+    }
+
+    std::vector<Operation> m_operations;
+};
@@ -0,0 +1,109 @@
+#include "stdafx.h"
+
+#include "edit_journal.h"
+
+namespace {
+
+// Undoing a step restores the values in reverse order, so that a property
+// edited more than once in the step ends up with its first value.
+EditBatch BatchOfStep(const EditJournal::Step& step, bool undo) {
+    EditBatch batch;
+    if (undo) {
+        for (auto it = step.edits.rbegin(); it != step.edits.rend(); ++it) {
+            batch.Add({
+                .elements = {it->element},
+                .propertyIndex = it->propertyIndex,
+                .value = it->before,
+            });
+        }
+    } else {
+        for (const auto& edit : step.edits) {
+            batch.Add({
+                .elements = {edit.element},
+                .propertyIndex = edit.propertyIndex,
+                .value = edit.after,
+            });
+        }
+    }
+
+    return batch;
+}
+
+}  // namespace
+
+void EditJournal::Record(Step step) {
+    if (step.edits.empty()) {
+        return;
+    }
+
+    CountEdits(m_redoSteps, /*add=*/false);
+    m_redoSteps.clear();
+
+    CountEdits(step, /*add=*/true);
+    m_undoSteps.push_back(std::move(step));
+    while (m_undoSteps.size() > m_maxSteps) {
+        CountEdits(m_undoSteps.front(), /*add=*/false);
+        m_undoSteps.pop_front();
+    }
+}
+
+void EditJournal::Clear() {
+    m_undoSteps.clear();
+    m_redoSteps.clear();
+    m_elementEditCounts.clear();
+}
+
+EditBatch EditJournal::UndoBatch() const {
+    return CanUndo() ? BatchOfStep(m_undoSteps.back(), /*undo=*/true)
+                     : EditBatch{};
+}
+
+EditBatch EditJournal::RedoBatch() const {
+    return CanRedo() ? BatchOfStep(m_redoSteps.back(), /*undo=*/false)
+                     : EditBatch{};
+}
+
+void EditJournal::Undone() {
+    m_redoSteps.push_back(std::move(m_undoSteps.back()));
+    m_undoSteps.pop_back();
+}
+
+void EditJournal::Redone() {
+    m_undoSteps.push_back(std::move(m_redoSteps.back()));
+    m_redoSteps.pop_back();
+}
+
+void EditJournal::RemoveElement(Handle element) {
+    if (!m_elementEditCounts.erase(element)) {
+        return;
+    }
+
+    for (auto* steps : {&m_undoSteps, &m_redoSteps}) {
+        for (auto& step : *steps) {
+            std::erase_if(step.edits, [element](const Edit& edit) {
+                return edit.element == element;
+            });
+        }
+
+        std::erase_if(*steps, [](const Step& step) {
+            return step.edits.empty();
+        });
+    }
+}
+
+void EditJournal::CountEdits(const Step& step, bool add) {
+    for (const auto& edit : step.edits) {
+        if (add) {
+            m_elementEditCounts[edit.element]++;
+        } else if (auto it = m_elementEditCounts.find(edit.element);
+                   it != m_elementEditCounts.end() && --it->second == 0) {
+            m_elementEditCounts.erase(it);
+        }
+    }
+}
+
+void EditJournal::CountEdits(const std::deque<Step>& steps, bool add) {
+    for (const auto& step : steps) {
+        CountEdits(step, add);
+    }
+}
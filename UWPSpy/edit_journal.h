@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "edit_batch.h"
+
+// Records the property edits made with the dialog, with the values they
+// replaced, to allow undoing and redoing them, and reverting all edits of an
+// element or a subtree. A step is a group of edits which are undone together,
+// such as an edit batch.
+class EditJournal {
+   public:
+    using Handle = EditBatch::Handle;
+    using Edit = EditBatch::Edit;
+
+    struct Step {
+        std::wstring description;
+        std::vector<Edit> edits;
+    };
+
+    explicit EditJournal(size_t maxSteps = 100) : m_maxSteps(maxSteps) {}
+
+    // Clears the redo steps. The oldest step is dropped if the journal is
+    // full.
+    void Record(Step step);
+
+    void Clear();
+
+    bool CanUndo() const { return !m_undoSteps.empty(); }
+    bool CanRedo() const { return !m_redoSteps.empty(); }
+    const Step& NextUndo() const { return m_undoSteps.back(); }
+    const Step& NextRedo() const { return m_redoSteps.back(); }
+
+    // The batch which undoes or redoes the next step. Once it's applied,
+    // Undone() or Redone() must be called to move the step to the other
+    // stack.
+    EditBatch UndoBatch() const;
+    EditBatch RedoBatch() const;
+    void Undone();
+    void Redone();
+
+    // The batch which restores the original values of all properties that
+    // were edited on elements for which pred(element) returns true. The
+    // revert should be recorded as a new step, so that it can be undone too.
+    template <typename Pred>
+    EditBatch RevertBatch(Pred&& pred) const {
+        // The original value is the one before the earliest edit of each
+        // property.
+        std::set<std::pair<Handle, std::uint32_t>> seen;
+        std::vector<const Edit*> earliest;
+        for (const auto& step : m_undoSteps) {
+            for (const auto& edit : step.edits) {
+                if (pred(edit.element) &&
+                    seen.emplace(edit.element, edit.propertyIndex).second) {
+                    earliest.push_back(&edit);
+                }
+            }
+        }
+
+        EditBatch batch;
+        for (const Edit* edit : earliest) {
+            batch.Add({
+                .elements = {edit->element},
+                .propertyIndex = edit->propertyIndex,
+                .value = edit->before,
+            });
+        }
+
+        return batch;
+    }
+
+    // Drops the edits of an element which no longer exists.
+    void RemoveElement(Handle element);
+
+    // Calls f(valueHandle) for the value handles the journal refers to, to
+    // allow keeping their objects alive.
+    template <typename F>
+    void ForEachValueHandle(F&& f) const {
+        for (const auto* steps : {&m_undoSteps, &m_redoSteps}) {
+            for (const auto& step : *steps) {
+                for (const auto& edit : step.edits) {
+                    if (edit.before.valueHandle) {
+                        f(edit.before.valueHandle);
+                    }
+
+                    if (edit.after.valueHandle) {
+                        f(edit.after.valueHandle);
+                    }
+                }
+            }
+        }
+    }
+
+   private:
+    void CountEdits(const Step& step, bool add);
+    void CountEdits(const std::deque<Step>& steps, bool add);
+
+    size_t m_maxSteps;
+    std::deque<Step> m_undoSteps;
+    std::deque<Step> m_redoSteps;
+    // The number of recorded edits of each element, so that elements without
+    // edits, which are most of the removed ones, are skipped quickly.
+    std::unordered_map<Handle, size_t> m_elementEditCounts;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "lru_cache.h"
+
+// Caches the objects and class names of instance handles, which avoids a
+// cross-ABI call to the diagnostics interface each time the same handle is
+// resolved. Objects are kept as weak references, so that the cache doesn't
+// keep them alive, and an entry is only valid while its object is alive.
+//
+// Element handles must be invalidated when the element is removed. Other
+// handles, such as property values, are evicted when the cache is full.
+template <typename WeakRef>
+class HandleCache {
+   public:
+    using Handle = std::uint64_t;
+
+    struct Entry {
+        WeakRef object;
+        std::wstring className;
+    };
+
+    explicit HandleCache(size_t maxEntries = 4096) : m_entries(maxEntries) {}
+
+    // Doesn't count a hit or a miss, the caller does that once it knows
+    // whether the object is still alive.
+    const Entry* Find(Handle handle) { return m_entries.Get(handle); }
+
+    void Put(Handle handle, Entry entry) {
+        m_entries.Put(handle, std::move(entry), 1);
+    }
+
+    void Invalidate(Handle handle) { m_entries.Erase(handle); }
+    void Clear() { m_entries.Clear(); }
+
+    void CountHit() { m_hits++; }
+    void CountMiss() { m_misses++; }
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+
+   private:
+    LruCache<Handle, Entry> m_entries;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// A map which evicts the least recently used entries once the total cost of
+// the entries exceeds a limit. The cost of an entry is provided by the caller,
+// usually its approximate size in bytes.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+   public:
+    explicit LruCache(size_t costLimit) : m_costLimit(costLimit) {}
+
+    // Returns nullptr if not found. A found entry becomes the most recently
+    // used one. The pointer is valid until the cache is modified.
+    Value* Get(const Key& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            return nullptr;
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return &it->second->value;
+    }
+
+    // Doesn't change the order of the entries.
+    const Value* Peek(const Key& key) const {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            return nullptr;
+        }
+
+        return &it->second->value;
+    }
+
+    // An entry which exceeds the limit on its own is still inserted, and
+    // evicts everything else.
+    void Put(const Key& key, Value value, size_t cost) {
+        Erase(key);
+
+        m_entries.push_front({key, std::move(value), cost});
+        m_index.emplace(key, m_entries.begin());
+        m_cost += cost;
+
+        while (m_cost > m_costLimit && m_entries.size() > 1) {
+            const Entry& entry = m_entries.back();
+            m_cost -= entry.cost;
+            m_index.erase(entry.key);
+            m_entries.pop_back();
+        }
+    }
+
+    bool Erase(const Key& key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) {
+            return false;
+        }
+
+        m_cost -= it->second->cost;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+        return true;
+    }
+
+    // Erases all entries for which pred(key, value) returns true.
+    template <typename Pred>
+    size_t EraseIf(Pred pred) {
+        size_t erased = 0;
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (pred(it->key, it->value)) {
+                m_cost -= it->cost;
+                m_index.erase(it->key);
+                it = m_entries.erase(it);
+                erased++;
+            } else {
+                ++it;
+            }
+        }
+
+        return erased;
+    }
+
+    void Clear() {
+        m_entries.clear();
+        m_index.clear();
+        m_cost = 0;
+    }
+
+    size_t Size() const { return m_entries.size(); }
+    size_t Cost() const { return m_cost; }
+
+   private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    size_t m_costLimit;
+    size_t m_cost = 0;
+    EntryList m_entries;
+    std::unordered_map<Key, typename EntryList::iterator, Hash> m_index;
+};
@@ -0,0 +1,257 @@
+#include "stdafx.h"
+
+#include "metadata_cache.h"
+
+#include <cstring>
+
+// The file consists of the header, followed by the object kind records,
+// followed by the text of all names. All records are multiples of 8 bytes, so
+// the table is aligned if the file is.
+struct MetadataCache::FileText {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct MetadataCache::FileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t charSize;
+    std::uint32_t objectKindCount;
+    std::uint32_t textLength;
+    FileText key;
+    std::uint32_t reserved;
+};
+
+// Sorted by name hash.
+struct MetadataCache::FileObjectKind {
+    std::uint64_t nameHash;
+    FileText name;
+    std::int32_t kind;
+    std::uint32_t reserved;
+};
+
+namespace {
+
+constexpr std::uint32_t kFileMagic = 0x4D535755;  // "UWSM"
+// Version 1 also had property schemas.
+constexpr std::uint32_t kFileVersion = 2;
+
+template <typename Record>
+const Record* FindByHash(const Record* records,
+                         size_t count,
+                         std::uint64_t hash) {
+    const Record* end = records + count;
+    const Record* it = std::lower_bound(
+        records, end, hash, [](const Record& record, std::uint64_t hash) {
+            return record.nameHash < hash;
+        });
+    return it != end && it->nameHash == hash ? it : nullptr;
+}
+
+}  // namespace
+
+// static
+std::uint64_t MetadataCache::Hash(std::wstring_view text) {
+    // FNV-1a.
+    std::uint64_t hash = 0xCBF29CE484222325;
+    for (wchar_t c : text) {
+        hash ^= static_cast<std::uint64_t>(c);
+        hash *= 0x100000001B3;
+    }
+
+    return hash;
+}
+
+bool MetadataCache::Load(const void* data,
+                         size_t size,
+                         std::wstring_view key) {
+    Unload();
+
+    static_assert(sizeof(FileHeader) % 8 == 0);
+    static_assert(sizeof(FileObjectKind) % 8 == 0);
+
+    if (size < sizeof(FileHeader) ||
+        reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t)) {
+        return false;
+    }
+
+    const auto* header = static_cast<const FileHeader*>(data);
+    if (header->magic != kFileMagic || header->version != kFileVersion ||
+        header->charSize != sizeof(wchar_t)) {
+        return false;
+    }
+
+    // Computed in 64 bits, so that huge counts can't wrap around.
+    std::uint64_t kindsOffset = sizeof(FileHeader);
+    std::uint64_t textOffset =
+        kindsOffset +
+        std::uint64_t{header->objectKindCount} * sizeof(FileObjectKind);
+    std::uint64_t fileSize =
+        textOffset + std::uint64_t{header->textLength} * sizeof(wchar_t);
+    if (fileSize != size) {
+        return false;
+    }
+
+    const char* file = static_cast<const char*>(data);
+
+    m_fileText = reinterpret_cast<const wchar_t*>(file + textOffset);
+    m_fileTextLength = header->textLength;
+    if (FileTextView(header->key) != key) {
+        Unload();
+        return false;
+    }
+
+    m_fileKinds = reinterpret_cast<const FileObjectKind*>(file + kindsOffset);
+    m_fileKindCount = header->objectKindCount;
+
+    return true;
+}
+
+void MetadataCache::Unload() {
+    m_fileKinds = nullptr;
+    m_fileKindCount = 0;
+    m_fileText = nullptr;
+    m_fileTextLength = 0;
+}
+
+std::optional<std::int32_t> MetadataCache::FindObjectKind(
+    std::wstring_view className) {
+    if (auto it = m_objectKinds.find(className); it != m_objectKinds.end()) {
+        m_hits++;
+        return it->second;
+    }
+
+    if (!m_erasedObjectKinds.contains(className)) {
+        if (const auto* record = FindFileObjectKind(className)) {
+            m_hits++;
+            return record->kind;
+        }
+    }
+
+    m_misses++;
+    return std::nullopt;
+}
+
+void MetadataCache::PutObjectKind(std::wstring_view className,
+                                  std::int32_t kind) {
+    if (className.empty()) {
+        return;
+    }
+
+    if (auto it = m_erasedObjectKinds.find(className);
+        it != m_erasedObjectKinds.end()) {
+        m_erasedObjectKinds.erase(it);
+    }
+
+    m_objectKinds.insert_or_assign(std::wstring(className), kind);
+    m_modified = true;
+}
+
+void MetadataCache::EraseObjectKind(std::wstring_view className) {
+    if (auto it = m_objectKinds.find(className); it != m_objectKinds.end()) {
+        m_objectKinds.erase(it);
+    }
+
+    m_erasedObjectKinds.emplace(className);
+    m_staleEntries++;
+    m_modified = true;
+}
+
+std::vector<char> MetadataCache::Serialize(std::wstring_view key) const {
+    std::vector<wchar_t> text;
+    auto append = [&text](std::wstring_view s) {
+        FileText fileText{
+            .offset = static_cast<std::uint32_t>(text.size()),
+            .length = static_cast<std::uint32_t>(s.size()),
+        };
+        text.insert(text.end(), s.begin(), s.end());
+        return fileText;
+    };
+
+    // Every field is set, the header is written to disk as is.
+    FileHeader header{
+        .magic = kFileMagic,
+        .version = kFileVersion,
+        .charSize = sizeof(wchar_t),
+        .objectKindCount = 0,
+        .textLength = 0,
+        .key = append(key),
+        .reserved = 0,
+    };
+
+    // The loaded entries which weren't replaced or erased are kept.
+    std::vector<FileObjectKind> kinds;
+    for (const auto& [name, kind] : m_objectKinds) {
+        kinds.push_back({
+            .nameHash = Hash(name),
+            .name = append(name),
+            .kind = kind,
+            .reserved = 0,
+        });
+    }
+
+    for (size_t i = 0; i < m_fileKindCount; i++) {
+        const auto& record = m_fileKinds[i];
+        auto name = FileTextView(record.name);
+        if (name.empty() || m_objectKinds.contains(name) ||
+            m_erasedObjectKinds.contains(name)) {
+            continue;
+        }
+
+        kinds.push_back({
+            .nameHash = record.nameHash,
+            .name = append(name),
+            .kind = record.kind,
+            .reserved = 0,
+        });
+    }
+
+    std::sort(kinds.begin(), kinds.end(),
+              [](const FileObjectKind& a, const FileObjectKind& b) {
+                  return a.nameHash < b.nameHash;
+              });
+
+    header.objectKindCount = static_cast<std::uint32_t>(kinds.size());
+    header.textLength = static_cast<std::uint32_t>(text.size());
+
+    std::vector<char> file(sizeof(header) +
+                           kinds.size() * sizeof(FileObjectKind) +
+                           text.size() * sizeof(wchar_t));
+
+    char* p = file.data();
+    auto write = [&p](const void* data, size_t size) {
+        if (size > 0) {
+            std::memcpy(p, data, size);
+            p += size;
+        }
+    };
+
+    write(&header, sizeof(header));
+    write(kinds.data(), kinds.size() * sizeof(FileObjectKind));
+    write(text.data(), text.size() * sizeof(wchar_t));
+
+    return file;
+}
+
+std::wstring_view MetadataCache::FileTextView(const FileText& text) const {
+    if (text.offset > m_fileTextLength ||
+        text.length > m_fileTextLength - text.offset) {
+        return {};
+    }
+
+    return {m_fileText + text.offset, text.length};
+}
+
+const MetadataCache::FileObjectKind* MetadataCache::FindFileObjectKind(
+    std::wstring_view className) const {
+    std::uint64_t hash = Hash(className);
+    const FileObjectKind* end = m_fileKinds + m_fileKindCount;
+    for (const auto* record = FindByHash(m_fileKinds, m_fileKindCount, hash);
+         record && record != end && record->nameHash == hash; record++) {
+        if (FileTextView(record->name) == className) {
+            return record;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Type metadata which is kept between sessions: the object kind of each
+// runtime class. The file is used as is, e.g. when memory-mapped, with records
+// sorted by name hash for binary search, so loading it doesn't parse anything.
+// The file is only valid for the key it was written with, which identifies the
+// app and framework versions.
+//
+// Loaded entries might be stale, the caller validates an entry when using it
+// for the first time and erases it if it doesn't hold anymore. Entries added
+// in the session are merged with the loaded ones on Serialize.
+class MetadataCache {
+   public:
+    // A stable hash, e.g. for naming the file after its key.
+    static std::uint64_t Hash(std::wstring_view text);
+
+    // The data isn't copied and must stay valid until Unload is called.
+    // Returns false if the data isn't a file written for the key.
+    bool Load(const void* data, size_t size, std::wstring_view key);
+    // Drops the loaded entries, keeps the ones added in the session.
+    void Unload();
+
+    std::optional<std::int32_t> FindObjectKind(std::wstring_view className);
+    void PutObjectKind(std::wstring_view className, std::int32_t kind);
+    void EraseObjectKind(std::wstring_view className);
+
+    // Whether entries were added or erased since loading.
+    bool Modified() const { return m_modified; }
+
+    std::vector<char> Serialize(std::wstring_view key) const;
+
+    size_t LoadedObjectKinds() const { return m_fileKindCount; }
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+    std::uint64_t StaleEntries() const { return m_staleEntries; }
+
+   private:
+    struct FileText;
+    struct FileHeader;
+    struct FileObjectKind;
+
+    // Allows lookups by std::wstring_view without allocating a key.
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view s) const {
+            return std::hash<std::wstring_view>{}(s);
+        }
+    };
+
+    template <typename Value>
+    using NameMap =
+        std::unordered_map<std::wstring, Value, NameHash, std::equal_to<>>;
+    using NameSet = std::unordered_set<std::wstring, NameHash, std::equal_to<>>;
+
+    std::wstring_view FileTextView(const FileText& text) const;
+    const FileObjectKind* FindFileObjectKind(std::wstring_view className) const;
+
+    // The loaded file, if any.
+    const FileObjectKind* m_fileKinds = nullptr;
+    size_t m_fileKindCount = 0;
+    const wchar_t* m_fileText = nullptr;
+    size_t m_fileTextLength = 0;
+
+    // Entries added in the session take precedence over the loaded ones.
+    NameMap<std::int32_t> m_objectKinds;
+    NameSet m_erasedObjectKinds;
+    bool m_modified = false;
+
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+    std::uint64_t m_staleEntries = 0;
+};
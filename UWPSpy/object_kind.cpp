@@ -0,0 +1,104 @@
+#include "stdafx.h"
+
+#include "object_kind.h"
+
+namespace {
+
+struct KindProbe {
+    ObjectKind kind;
+    bool (*probe)(const wf::IInspectable& object);
+};
+
+::IInspectable* GetAbi(const wf::IInspectable& object) {
+    return reinterpret_cast<::IInspectable*>(winrt::get_abi(object));
+}
+
+// In the order of ClassifyObject. Elements are the most common, they're
+// checked first.
+constexpr KindProbe kKindProbes[] = {
+    {ObjectKind::WuxFrameworkElement,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<wux::FrameworkElement>());
+     }},
+    {ObjectKind::WuxUIElement,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<wux::UIElement>());
+     }},
+    {ObjectKind::MuxFrameworkElement,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<mux::FrameworkElement>());
+     }},
+    {ObjectKind::MuxUIElement,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<mux::UIElement>());
+     }},
+    {ObjectKind::WuxWindow,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<wux::Window>());
+     }},
+    {ObjectKind::MuxWindow,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(object.try_as<mux::Window>());
+     }},
+    {ObjectKind::WuxDesktopWindowXamlSource,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(
+             object.try_as<wux::Hosting::DesktopWindowXamlSource>());
+     }},
+    {ObjectKind::MuxDesktopWindowXamlSource,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(
+             object.try_as<mux::Hosting::DesktopWindowXamlSource>());
+     }},
+    {ObjectKind::MuxDesktopWindowXamlSourceWinUI2,
+     [](const wf::IInspectable& object) {
+         return static_cast<bool>(
+             try_as_with_guid_unsafe<mux::Hosting::DesktopWindowXamlSource>(
+                 GetAbi(object), IID_IDesktopWindowXamlSource_WinUI_2));
+     }},
+    {ObjectKind::MuxDesktopWindowXamlSourceWinUI1,
+     [](const wf::IInspectable& object) {
+         return try_as_with_guid_unsafe<
+                    mux::Hosting::DesktopWindowXamlSource>(
+                    GetAbi(object), IID_IDesktopWindowXamlSource_WinUI_1) ||
+                object.try_as<IDesktopWindowXamlSourceNative_WinUI>();
+     }},
+};
+
+}  // namespace
+
+ObjectKind ClassifyObject(const wf::IInspectable& object) {
+    for (const auto& kindProbe : kKindProbes) {
+        if (kindProbe.probe(object)) {
+            return kindProbe.kind;
+        }
+    }
+
+    return ObjectKind::Other;
+}
+
+bool ObjectHasKind(const wf::IInspectable& object, ObjectKind kind) {
+    if (kind == ObjectKind::Other) {
+        // Only confirmed by none of the known interfaces being found.
+        return ClassifyObject(object) == ObjectKind::Other;
+    }
+
+    for (const auto& kindProbe : kKindProbes) {
+        if (kindProbe.kind == kind) {
+            return kindProbe.probe(object);
+        }
+    }
+
+    // An unknown value, e.g. from a corrupted file.
+    return false;
+}
+
+size_t ClassifyObjectProbeCount(ObjectKind kind) {
+    for (size_t i = 0; i < std::size(kKindProbes); i++) {
+        if (kKindProbes[i].kind == kind) {
+            return i + 1;
+        }
+    }
+
+    return std::size(kKindProbes);
+}
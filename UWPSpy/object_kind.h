@@ -0,0 +1,75 @@
+#pragma once
+
+#include "winrt.hpp"
+
+// The framework interface an object is used through. Objects of the same
+// runtime class always have the same kind, so ClassifyObject only needs to be
+// called once per class, see runtime_class_cache.h.
+enum class ObjectKind {
+    Other,
+    WuxUIElement,
+    WuxFrameworkElement,
+    MuxUIElement,
+    MuxFrameworkElement,
+    WuxWindow,
+    MuxWindow,
+    WuxDesktopWindowXamlSource,
+    MuxDesktopWindowXamlSource,
+    // Experimental WinUI versions, see the IIDs below.
+    MuxDesktopWindowXamlSourceWinUI2,
+    MuxDesktopWindowXamlSourceWinUI1,
+};
+
+// Probes the object with QueryInterface until a known interface is found.
+ObjectKind ClassifyObject(const wf::IInspectable& object);
+
+// Confirms a kind found earlier, e.g. in a previous session. A single probe,
+// except for Other, which takes all the probes of ClassifyObject.
+bool ObjectHasKind(const wf::IInspectable& object, ObjectKind kind);
+
+// The number of probes ClassifyObject takes for an object of the kind, which
+// ObjectHasKind saves for kinds other than Other.
+size_t ClassifyObjectProbeCount(ObjectKind kind);
+
+inline bool IsWuxUIElement(ObjectKind kind) {
+    return kind == ObjectKind::WuxUIElement ||
+           kind == ObjectKind::WuxFrameworkElement;
+}
+
+inline bool IsMuxUIElement(ObjectKind kind) {
+    return kind == ObjectKind::MuxUIElement ||
+           kind == ObjectKind::MuxFrameworkElement;
+}
+
+// Can be carefully used to pass a guid of a different version of an interface,
+// and use the resulting object with functions that are the same in both
+// interface versions.
+template <typename To,
+          typename From,
+          std::enable_if_t<winrt::impl::is_com_interface_v<To>, int> = 0>
+winrt::impl::com_ref<To> try_as_with_guid_unsafe(From* ptr,
+                                                 winrt::guid guid) noexcept {
+    if (!ptr) {
+        return nullptr;
+    }
+
+    void* result{};
+    ptr->QueryInterface(guid, &result);
+    return winrt::impl::wrap_as_result<To>(result);
+}
+
+// 1.2.220727.1-experimental1 - 1.2.220909.2-experimental2
+// {A81014CD-55C1-506E-AA79-D9AC96DB9B8E}
+inline constexpr winrt::guid IID_IDesktopWindowXamlSource_WinUI_1{
+    0xa81014cd,
+    0x55c1,
+    0x506e,
+    {0xaa, 0x79, 0xd9, 0xac, 0x96, 0xdb, 0x9b, 0x8e}};
+
+// 1.3.230202101-experimental1 - 1.4.230518007-experimental1
+// {F2AA238F-1C21-581E-AADC-7D6EC5320F56}
+inline constexpr winrt::guid IID_IDesktopWindowXamlSource_WinUI_2{
+    0xf2aa238f,
+    0x1c21,
+    0x581e,
+    {0xaa, 0xdc, 0x7d, 0x6e, 0xc5, 0x32, 0x0f, 0x56}};
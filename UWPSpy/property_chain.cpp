@@ -0,0 +1,28 @@
+#include "stdafx.h"
+
+#include "property_chain.h"
+
+void PropertyChain::Reserve(size_t sourceCount,
+                            size_t valueCount,
+                            size_t textLength) {
+    m_sources.reserve(sourceCount);
+    m_values.reserve(valueCount);
+    m_text.reserve(textLength);
+}
+
+PropertyChain::Text PropertyChain::AddText(std::wstring_view text) {
+    Text result{
+        .offset = static_cast<std::uint32_t>(m_text.size()),
+        .length = static_cast<std::uint32_t>(text.size()),
+    };
+
+    m_text.insert(m_text.end(), text.begin(), text.end());
+    m_text.push_back(L'\0');
+    return result;
+}
+
+size_t PropertyChain::MemoryUsage() const {
+    return sizeof(*this) + m_sources.capacity() * sizeof(Source) +
+           m_values.capacity() * sizeof(Value) +
+           m_text.capacity() * sizeof(wchar_t);
+}
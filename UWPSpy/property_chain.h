@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lru_cache.h"
+
+// A decoded copy of the sources and values returned by
+// IVisualTreeService::GetPropertyValuesChain. The strings of all entries are
+// kept null-terminated in a single buffer, so a chain is three allocations
+// regardless of its size.
+class PropertyChain {
+   public:
+    struct Text {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct Source {
+        std::uint64_t handle;
+        Text targetType;
+        Text name;
+        std::int32_t source;  // BaseValueSource
+    };
+
+    struct Value {
+        std::uint32_t index;
+        std::uint32_t sourceIndex;
+        Text type;
+        Text declaringType;
+        Text valueType;
+        Text itemType;
+        Text value;
+        Text propertyName;
+        std::int64_t metadataBits;
+        bool overridden;
+    };
+
+    void Reserve(size_t sourceCount, size_t valueCount, size_t textLength);
+
+    Text AddText(std::wstring_view text);
+    void AddSource(const Source& source) { m_sources.push_back(source); }
+    void AddValue(const Value& value) { m_values.push_back(value); }
+
+    const std::vector<Source>& Sources() const { return m_sources; }
+    const std::vector<Value>& Values() const { return m_values; }
+
+    std::wstring_view View(Text text) const {
+        return {m_text.data() + text.offset, text.length};
+    }
+    const wchar_t* CStr(Text text) const { return m_text.data() + text.offset; }
+
+    // Returns nullptr if the source index is out of range.
+    const Source* SourceOf(const Value& value) const {
+        return value.sourceIndex < m_sources.size()
+                   ? &m_sources[value.sourceIndex]
+                   : nullptr;
+    }
+
+    size_t MemoryUsage() const;
+
+   private:
+    std::vector<Source> m_sources;
+    std::vector<Value> m_values;
+    std::vector<wchar_t> m_text;
+};
+
+// Keeps the decoded property chains of recently viewed elements. Entries must
+// be invalidated when the element properties might have changed. The app can
+// also change them on its own, e.g. with layout, bindings or animations,
+// without a notification. So entries expire after a short time: flipping back
+// and forth between elements uses the cached chains, but selecting an element
+// again later fetches its current values.
+class PropertyChainCache {
+   public:
+    using Handle = std::uint64_t;
+    using ChainPtr = std::shared_ptr<const PropertyChain>;
+
+    explicit PropertyChainCache(size_t memoryLimit = 16 * 1024 * 1024,
+                                std::uint64_t maxAgeMs = 5000)
+        : m_cache(memoryLimit), m_maxAgeMs(maxAgeMs) {}
+
+    // Returns the cached chain if it's not expired, or calls loader() and
+    // caches its result. A null result isn't cached, so that errors are
+    // retried next time.
+    template <typename Loader>
+    ChainPtr Get(Handle handle, std::uint64_t nowMs, Loader&& loader) {
+        auto* entry = m_cache.Get(handle);
+        if (entry && !Expired(*entry, nowMs)) {
+            m_hits++;
+            return entry->chain;
+        }
+
+        m_misses++;
+
+        ChainPtr chain = loader();
+        if (chain) {
+            Put(handle, chain, nowMs);
+        }
+
+        return chain;
+    }
+
+    bool Contains(Handle handle, std::uint64_t nowMs) const {
+        return static_cast<bool>(Peek(handle, nowMs));
+    }
+
+    // Returns the cached chain if it's not expired, or nullptr. Doesn't count
+    // a hit or a miss and doesn't change the eviction order.
+    ChainPtr Peek(Handle handle, std::uint64_t nowMs) const {
+        const Entry* entry = m_cache.Peek(handle);
+        return entry && !Expired(*entry, nowMs) ? entry->chain : nullptr;
+    }
+
+    // Replaces the cached chain, if any, e.g. with a chain which was just
+    // fetched.
+    void Put(Handle handle, ChainPtr chain, std::uint64_t nowMs) {
+        size_t cost = chain->MemoryUsage();
+        m_cache.Put(handle, {.chain = std::move(chain), .loadedMs = nowMs},
+                    cost);
+    }
+
+    void Invalidate(Handle handle) { m_cache.Erase(handle); }
+
+    // Invalidates all entries for which pred(handle) returns true.
+    template <typename Pred>
+    void InvalidateIf(Pred pred) {
+        m_cache.EraseIf(
+            [&pred](Handle handle, const Entry&) { return pred(handle); });
+    }
+
+    void Clear() { m_cache.Clear(); }
+
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+    size_t MemoryUsage() const { return m_cache.Cost(); }
+
+   private:
+    struct Entry {
+        ChainPtr chain;
+        std::uint64_t loadedMs;
+    };
+
+    bool Expired(const Entry& entry, std::uint64_t nowMs) const {
+        return nowMs - entry.loadedMs > m_maxAgeMs;
+    }
+
+    LruCache<Handle, Entry> m_cache;
+    std::uint64_t m_maxAgeMs;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
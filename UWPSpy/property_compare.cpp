@@ -0,0 +1,165 @@
+#include "stdafx.h"
+
+#include "property_compare.h"
+
+#include <unordered_map>
+
+namespace {
+
+struct Key {
+    std::uint32_t index;
+    // Only set in detailed mode.
+    std::int32_t source;
+    // Distinguishes values of the same property from the same kind of
+    // source, e.g. a style and its BasedOn style.
+    std::uint32_t ordinal;
+
+    bool operator==(const Key&) const = default;
+};
+
+struct KeyHash {
+    size_t operator()(const Key& key) const {
+        std::uint64_t h = (static_cast<std::uint64_t>(key.index) << 32) |
+                          static_cast<std::uint32_t>(key.source);
+        h ^= static_cast<std::uint64_t>(key.ordinal) * 0x9E3779B97F4A7C15ull;
+        return std::hash<std::uint64_t>{}(h);
+    }
+};
+
+struct KeyedValue {
+    Key key;
+    std::uint32_t value;
+};
+
+// The values to compare, in chain order, each with its join key.
+std::vector<KeyedValue> KeyedValues(const PropertyChain& chain,
+                                    bool detailed) {
+    const auto& values = chain.Values();
+
+    std::vector<KeyedValue> keyed;
+    keyed.reserve(values.size());
+
+    // The position of the last keyed value of each key, without the ordinal.
+    std::unordered_map<Key, size_t, KeyHash> positions;
+    positions.reserve(values.size());
+
+    for (std::uint32_t i = 0; i < values.size(); i++) {
+        const auto& v = values[i];
+
+        Key key{.index = v.index, .source = 0, .ordinal = 0};
+        if (detailed) {
+            const auto* src = chain.SourceOf(v);
+            key.source = src ? src->source : -1;
+        }
+
+        auto [it, inserted] = positions.try_emplace(key, keyed.size());
+        if (inserted) {
+            keyed.push_back({.key = key, .value = i});
+            continue;
+        }
+
+        if (detailed) {
+            key.ordinal = keyed[it->second].key.ordinal + 1;
+            it->second = keyed.size();
+            keyed.push_back({.key = key, .value = i});
+        } else if (values[keyed[it->second].value].overridden &&
+                   !v.overridden) {
+            // The effective value is the one which isn't overridden.
+            keyed[it->second].value = i;
+        }
+    }
+
+    return keyed;
+}
+
+PropertyComparison::Row CompareValues(const PropertyChain& first,
+                                      std::uint32_t firstIndex,
+                                      const PropertyChain& second,
+                                      std::uint32_t secondIndex,
+                                      std::int32_t localSource) {
+    const auto& a = first.Values()[firstIndex];
+    const auto& b = second.Values()[secondIndex];
+
+    PropertyComparison::Row row{
+        .first = firstIndex,
+        .second = secondIndex,
+        // Values which are objects are compared by their handles, i.e. they
+        // must be the same object.
+        .valueDiffers = a.metadataBits != b.metadataBits ||
+                        first.View(a.valueType) != second.View(b.valueType) ||
+                        first.View(a.value) != second.View(b.value),
+        .sourceDiffers = false,
+        .styleDiffers = false,
+    };
+
+    const auto* srcA = first.SourceOf(a);
+    const auto* srcB = second.SourceOf(b);
+    if (!srcA || !srcB) {
+        row.sourceDiffers = srcA != srcB;
+    } else if (srcA->source != srcB->source) {
+        row.sourceDiffers = true;
+    } else if (srcA->source != localSource) {
+        row.styleDiffers = srcA->handle != srcB->handle;
+    }
+
+    return row;
+}
+
+}  // namespace
+
+PropertyComparison CompareProperties(const PropertyChain& first,
+                                     const PropertyChain& second,
+                                     bool detailed,
+                                     std::int32_t localSource) {
+    auto firstValues = KeyedValues(first, detailed);
+    auto secondValues = KeyedValues(second, detailed);
+
+    std::unordered_map<Key, std::uint32_t, KeyHash> secondByKey;
+    secondByKey.reserve(secondValues.size());
+    for (const auto& keyed : secondValues) {
+        secondByKey.emplace(keyed.key, keyed.value);
+    }
+
+    PropertyComparison comparison;
+    comparison.rows.reserve(firstValues.size() + secondValues.size());
+
+    std::vector<bool> secondMatched(second.Values().size());
+
+    for (const auto& keyed : firstValues) {
+        auto it = secondByKey.find(keyed.key);
+        if (it == secondByKey.end()) {
+            comparison.rows.push_back({
+                .first = keyed.value,
+                .second = PropertyComparison::kNone,
+                .valueDiffers = true,
+                .sourceDiffers = true,
+                .styleDiffers = false,
+            });
+            continue;
+        }
+
+        secondMatched[it->second] = true;
+        comparison.rows.push_back(
+            CompareValues(first, keyed.value, second, it->second, localSource));
+    }
+
+    for (const auto& keyed : secondValues) {
+        if (!secondMatched[keyed.value]) {
+            comparison.rows.push_back({
+                .first = PropertyComparison::kNone,
+                .second = keyed.value,
+                .valueDiffers = true,
+                .sourceDiffers = true,
+                .styleDiffers = false,
+            });
+        }
+    }
+
+    for (const auto& row : comparison.rows) {
+        if (row.Differs()) {
+            comparison.differingRows++;
+        }
+    }
+
+    return comparison;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "property_chain.h"
+
+// The property values of two elements merged into one table, joined on the
+// property index. By default, the effective value of each property is
+// compared. In detailed mode, all values are compared, joined on the
+// property index and the value source, so that e.g. the style values of both
+// elements end up in the same row.
+struct PropertyComparison {
+    // A missing value on one side of a row.
+    static constexpr std::uint32_t kNone = 0xFFFFFFFF;
+
+    struct Row {
+        // Indices into the values of the first and the second chain.
+        std::uint32_t first;
+        std::uint32_t second;
+        bool valueDiffers;
+        // The value sources are of different kinds, e.g. local and style.
+        bool sourceDiffers;
+        // The values come from different style objects.
+        bool styleDiffers;
+
+        bool Differs() const {
+            return valueDiffers || sourceDiffers || styleDiffers;
+        }
+    };
+
+    // The rows of the first chain in its order, followed by the rows which
+    // only exist in the second chain.
+    std::vector<Row> rows;
+    size_t differingRows = 0;
+};
+
+// Runs in linear time in the size of both chains. The source of local values
+// is the element itself, so it's not compared as a style.
+PropertyComparison CompareProperties(const PropertyChain& first,
+                                     const PropertyChain& second,
+                                     bool detailed,
+                                     std::int32_t localSource);
@@ -0,0 +1,45 @@
+#include "stdafx.h"
+
+#include "property_crawler.h"
+
+void PropertyCrawler::Remove(Handle handle) {
+    auto it = m_elements.find(handle);
+    if (it == m_elements.end()) {
+        return;
+    }
+
+    if (it->second) {
+        m_pendingCount--;
+    }
+
+    m_elements.erase(it);
+}
+
+void PropertyCrawler::Clear() {
+    m_elements.clear();
+    m_queue.clear();
+    m_pendingCount = 0;
+}
+
+void PropertyCrawler::RecordSlice(std::chrono::microseconds duration) {
+    m_stats.slices++;
+    m_stats.busyTime += duration;
+    m_stats.maxSliceTime = std::max(m_stats.maxSliceTime, duration);
+}
+
+void PropertyCrawler::MarkDirty(Handle handle, bool add) {
+    auto it = m_elements.find(handle);
+    if (it == m_elements.end()) {
+        if (!add) {
+            return;
+        }
+
+        it = m_elements.try_emplace(handle, false).first;
+    }
+
+    if (!it->second) {
+        it->second = true;
+        m_queue.push_back(handle);
+        m_pendingCount++;
+    }
+}
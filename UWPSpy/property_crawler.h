@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+
+// Fetches the property chains of all elements in small slices, so that the app
+// UI thread isn't blocked for long. Only elements that were added or marked as
+// changed since they were last fetched are queued, so unchanged elements and
+// subtrees are skipped, and mutations during a crawl just queue more work.
+class PropertyCrawler {
+   public:
+    using Handle = std::uint64_t;
+
+    struct Stats {
+        std::uint64_t fetched = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t slices = 0;
+        std::chrono::microseconds busyTime{};
+        std::chrono::microseconds maxSliceTime{};
+    };
+
+    // Adds a new element, or marks an existing one as changed.
+    void Add(Handle handle) { MarkDirty(handle, /*add=*/true); }
+    void MarkDirty(Handle handle) { MarkDirty(handle, /*add=*/false); }
+
+    // Marks all known elements for which pred(handle) returns true.
+    template <typename Pred>
+    void MarkDirtyIf(Pred&& pred) {
+        for (auto& [handle, queued] : m_elements) {
+            if (!queued && pred(handle)) {
+                queued = true;
+                m_queue.push_back(handle);
+                m_pendingCount++;
+            }
+        }
+    }
+
+    void Remove(Handle handle);
+    void Clear();
+
+    bool HasPendingWork() const { return m_pendingCount > 0; }
+
+    // Fetches queued elements until budgetExceeded() returns true, at least
+    // one per call. fetch(handle) returns false on failure, failed elements
+    // aren't retried until they're marked as changed again. Returns the
+    // number of fetched elements.
+    template <typename Fetch, typename BudgetExceeded>
+    size_t Step(Fetch&& fetch, BudgetExceeded&& budgetExceeded) {
+        size_t count = 0;
+        while (!m_queue.empty()) {
+            if (count > 0 && budgetExceeded()) {
+                break;
+            }
+
+            Handle handle = m_queue.front();
+            m_queue.pop_front();
+
+            // Removed elements are left in the queue, skip them here.
+            auto it = m_elements.find(handle);
+            if (it == m_elements.end() || !it->second) {
+                continue;
+            }
+
+            it->second = false;
+            m_pendingCount--;
+            count++;
+
+            if (fetch(handle)) {
+                m_stats.fetched++;
+            } else {
+                m_stats.failed++;
+            }
+        }
+
+        return count;
+    }
+
+    void RecordSlice(std::chrono::microseconds duration);
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats() { m_stats = {}; }
+
+   private:
+    void MarkDirty(Handle handle, bool add);
+
+    // Element handle to whether it's queued.
+    std::unordered_map<Handle, bool> m_elements;
+    std::deque<Handle> m_queue;
+    // The number of queued elements which weren't removed.
+    size_t m_pendingCount = 0;
+    Stats m_stats;
+};
@@ -0,0 +1,545 @@
+#include "stdafx.h"
+
+#include "property_export.h"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+constexpr char kColumnarMagic[] = "UWPSPYC1";
+
+constexpr const char* kColumnNames[] = {
+    "Element",
+    "Parent",
+    "ElementType",
+    "PropertyIndex",
+    "Name",
+    "Value",
+    "Type",
+    "DeclaringType",
+    "ValueType",
+    "ItemType",
+    "Overridden",
+    "MetadataBits",
+    "Source",
+    "StyleTargetType",
+    "StyleName",
+};
+
+// A value of the chain with its element, in the order of kColumnNames.
+struct Row {
+    std::uint64_t element;
+    std::uint64_t parent;
+    std::wstring_view elementType;
+    std::uint32_t propertyIndex;
+    std::wstring_view name;
+    std::wstring_view value;
+    std::wstring_view type;
+    std::wstring_view declaringType;
+    std::wstring_view valueType;
+    std::wstring_view itemType;
+    bool overridden;
+    std::int64_t metadataBits;
+    std::wstring_view source;
+    std::wstring_view styleTargetType;
+    std::wstring_view styleName;
+};
+
+void AppendUtf8(std::string& out, std::wstring_view text) {
+    for (size_t i = 0; i < text.size(); i++) {
+        std::uint32_t c = static_cast<std::uint32_t>(text[i]);
+
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.size()) {
+            std::uint32_t low = static_cast<std::uint32_t>(text[i + 1]);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+
+        // A lone surrogate can't be encoded, element names and values are
+        // arbitrary strings which might contain one.
+        if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+            c = 0xFFFD;
+        }
+
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        } else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+void AppendCsvField(std::string& out, std::wstring_view text) {
+    if (text.find_first_of(L",\"\r\n") == text.npos) {
+        AppendUtf8(out, text);
+        return;
+    }
+
+    out += '"';
+    size_t start = 0;
+    for (size_t quote = text.find(L'"'); quote != text.npos;
+         quote = text.find(L'"', start)) {
+        AppendUtf8(out, text.substr(start, quote + 1 - start));
+        out += '"';
+        start = quote + 1;
+    }
+
+    AppendUtf8(out, text.substr(start));
+    out += '"';
+}
+
+void AppendCsvField(std::string& out, std::uint64_t value) {
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    out.append(p, end);
+}
+
+void AppendCsvField(std::string& out, std::int64_t value) {
+    if (value < 0) {
+        out += '-';
+        AppendCsvField(out, 0 - static_cast<std::uint64_t>(value));
+    } else {
+        AppendCsvField(out, static_cast<std::uint64_t>(value));
+    }
+}
+
+void AppendCsvRow(std::string& out, const Row& row) {
+    AppendCsvField(out, row.element);
+    out += ',';
+    AppendCsvField(out, row.parent);
+    out += ',';
+    AppendCsvField(out, row.elementType);
+    out += ',';
+    AppendCsvField(out, std::uint64_t{row.propertyIndex});
+    out += ',';
+    AppendCsvField(out, row.name);
+    out += ',';
+    AppendCsvField(out, row.value);
+    out += ',';
+    AppendCsvField(out, row.type);
+    out += ',';
+    AppendCsvField(out, row.declaringType);
+    out += ',';
+    AppendCsvField(out, row.valueType);
+    out += ',';
+    AppendCsvField(out, row.itemType);
+    out += ',';
+    out += row.overridden ? '1' : '0';
+    out += ',';
+    AppendCsvField(out, row.metadataBits);
+    out += ',';
+    AppendCsvField(out, row.source);
+    out += ',';
+    AppendCsvField(out, row.styleTargetType);
+    out += ',';
+    AppendCsvField(out, row.styleName);
+    out += "\r\n";
+}
+
+void AppendVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    out += static_cast<char>(value);
+}
+
+std::uint64_t ZigZag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^
+           static_cast<std::uint64_t>(value >> 63);
+}
+
+class IntColumn {
+   public:
+    void Add(std::uint64_t value) { AppendVarint(m_data, value); }
+    void AddSigned(std::int64_t value) { AppendVarint(m_data, ZigZag(value)); }
+
+    // Handles of consecutive rows are mostly equal or close.
+    void AddDelta(std::uint64_t value) {
+        AddSigned(static_cast<std::int64_t>(value - m_previous));
+        m_previous = value;
+    }
+
+    void WriteTo(std::string& out) const { out += m_data; }
+
+   private:
+    std::string m_data;
+    std::uint64_t m_previous = 0;
+};
+
+class StringColumn {
+   public:
+    void Add(std::wstring_view text) {
+        auto [it, inserted] = m_ids.try_emplace(
+            text, static_cast<std::uint32_t>(m_dictionary.size()));
+        if (inserted) {
+            m_dictionary.push_back(text);
+        }
+
+        AppendVarint(m_indices, it->second);
+    }
+
+    void WriteTo(std::string& out, std::string& scratch) const {
+        AppendVarint(out, m_dictionary.size());
+        for (auto text : m_dictionary) {
+            scratch.clear();
+            AppendUtf8(scratch, text);
+            AppendVarint(out, scratch.size());
+            out += scratch;
+        }
+
+        out += m_indices;
+    }
+
+   private:
+    std::unordered_map<std::wstring_view, std::uint32_t> m_ids;
+    std::vector<std::wstring_view> m_dictionary;
+    std::string m_indices;
+};
+
+struct RowGroup {
+    size_t rows = 0;
+    IntColumn element;
+    IntColumn parent;
+    StringColumn elementType;
+    IntColumn propertyIndex;
+    StringColumn name;
+    StringColumn value;
+    StringColumn type;
+    StringColumn declaringType;
+    StringColumn valueType;
+    StringColumn itemType;
+    IntColumn overridden;
+    IntColumn metadataBits;
+    StringColumn source;
+    StringColumn styleTargetType;
+    StringColumn styleName;
+
+    void Add(const Row& row) {
+        rows++;
+        element.AddDelta(row.element);
+        parent.AddDelta(row.parent);
+        elementType.Add(row.elementType);
+        propertyIndex.Add(row.propertyIndex);
+        name.Add(row.name);
+        value.Add(row.value);
+        type.Add(row.type);
+        declaringType.Add(row.declaringType);
+        valueType.Add(row.valueType);
+        itemType.Add(row.itemType);
+        overridden.Add(row.overridden);
+        metadataBits.AddSigned(row.metadataBits);
+        source.Add(row.source);
+        styleTargetType.Add(row.styleTargetType);
+        styleName.Add(row.styleName);
+    }
+
+    void WriteTo(std::string& out) const {
+        std::string scratch;
+        AppendVarint(out, rows);
+        element.WriteTo(out);
+        parent.WriteTo(out);
+        elementType.WriteTo(out, scratch);
+        propertyIndex.WriteTo(out);
+        name.WriteTo(out, scratch);
+        value.WriteTo(out, scratch);
+        type.WriteTo(out, scratch);
+        declaringType.WriteTo(out, scratch);
+        valueType.WriteTo(out, scratch);
+        itemType.WriteTo(out, scratch);
+        overridden.WriteTo(out);
+        metadataBits.WriteTo(out);
+        source.WriteTo(out, scratch);
+        styleTargetType.WriteTo(out, scratch);
+        styleName.WriteTo(out, scratch);
+    }
+};
+
+}  // namespace
+
+PropertyExporter::PropertyExporter(Format format,
+                                   Writer writer,
+                                   SourceToString sourceToString,
+                                   unsigned threadCount,
+                                   size_t batchSize)
+    : m_format(format),
+      m_writer(std::move(writer)),
+      m_sourceToString(std::move(sourceToString)),
+      m_batchSize(std::max(batchSize, size_t{1})) {
+    if (threadCount == 0) {
+        unsigned cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    m_maxPendingBatches = threadCount * 4;
+
+    // The header is written before any batch, on this thread.
+    std::string header;
+    if (m_format == Format::Csv) {
+        for (const char* name : kColumnNames) {
+            if (!header.empty()) {
+                header += ',';
+            }
+
+            header += name;
+        }
+
+        header += "\r\n";
+    } else {
+        header.append(kColumnarMagic, sizeof(kColumnarMagic) - 1);
+        AppendVarint(header, std::size(kColumnNames));
+        for (std::string_view name : kColumnNames) {
+            AppendVarint(header, name.size());
+            header += name;
+        }
+    }
+
+    if (!m_writer(header.data(), header.size())) {
+        m_failed = true;
+    }
+
+    m_bytesWritten = header.size();
+
+    // The started threads must be joined if starting another one fails, the
+    // destructor isn't called for a throwing constructor.
+    try {
+        m_threads.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; i++) {
+            m_threads.emplace_back([this] { WorkerThread(); });
+        }
+    } catch (...) {
+        StopThreads();
+        throw;
+    }
+}
+
+PropertyExporter::~PropertyExporter() {
+    Finish();
+}
+
+void PropertyExporter::Add(Element element) {
+    m_currentBatch.push_back(std::move(element));
+    m_addedElements++;
+    if (m_currentBatch.size() >= m_batchSize) {
+        FlushBatch();
+    }
+}
+
+bool PropertyExporter::Busy() const {
+    return m_pendingBatches >= m_maxPendingBatches;
+}
+
+bool PropertyExporter::Finish() {
+    if (m_finished) {
+        return !m_failed;
+    }
+
+    m_finished = true;
+    FlushBatch();
+    StopThreads();
+
+    return !m_failed;
+}
+
+void PropertyExporter::Cancel() {
+    if (m_finished) {
+        return;
+    }
+
+    m_finished = true;
+
+    // Batches which are being formatted are dropped once formatted, since
+    // nothing is written after a failure.
+    m_failed = true;
+    m_currentBatch.clear();
+
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_queue.clear();
+    }
+
+    StopThreads();
+}
+
+PropertyExporter::Stats PropertyExporter::GetStats() const {
+    return {
+        .elements = m_addedElements,
+        .rows = m_rows,
+        .batches = static_cast<size_t>(m_nextSequence),
+        .bytes = m_bytesWritten,
+    };
+}
+
+void PropertyExporter::WorkerThread() {
+    while (true) {
+        Batch batch;
+
+        {
+            std::unique_lock lock(m_queueMutex);
+            m_queueCondition.wait(
+                lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+
+            batch = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        std::string data;
+        if (!m_failed) {
+            size_t rows = 0;
+            data = FormatBatch(batch.elements, &rows);
+            m_rows += rows;
+        }
+
+        // The chains aren't needed anymore, release them before waiting for
+        // the previous batches.
+        batch.elements.clear();
+
+        WriteInOrder(batch.sequence, std::move(data));
+    }
+}
+
+void PropertyExporter::StopThreads() {
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_stopping = true;
+    }
+
+    m_queueCondition.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+
+    m_threads.clear();
+}
+
+void PropertyExporter::FlushBatch() {
+    if (m_currentBatch.empty()) {
+        return;
+    }
+
+    Batch batch{
+        .sequence = m_nextSequence++,
+        .elements = std::move(m_currentBatch),
+    };
+    m_currentBatch.clear();
+    m_currentBatch.reserve(m_batchSize);
+
+    m_pendingBatches++;
+
+    {
+        std::lock_guard lock(m_queueMutex);
+        m_queue.push_back(std::move(batch));
+    }
+
+    m_queueCondition.notify_one();
+}
+
+std::string PropertyExporter::FormatBatch(const std::vector<Element>& elements,
+                                          size_t* rows) const {
+    // Few distinct sources exist, their names are only formatted once.
+    std::unordered_map<std::int32_t, std::wstring> sourceNames;
+    auto sourceName = [this, &sourceNames](std::int32_t source) {
+        auto [it, inserted] = sourceNames.try_emplace(source);
+        if (inserted) {
+            it->second = m_sourceToString(source);
+        }
+
+        return std::wstring_view(it->second);
+    };
+
+    std::string out;
+    RowGroup rowGroup;
+
+    for (const auto& element : elements) {
+        // Set on a write failure or on Cancel, the batch won't be written.
+        if (m_failed) {
+            break;
+        }
+
+        const PropertyChain& chain = *element.chain;
+        for (const auto& v : chain.Values()) {
+            const auto* src = chain.SourceOf(v);
+
+            Row row{
+                .element = element.handle,
+                .parent = element.parentHandle,
+                .elementType = element.typeName,
+                .propertyIndex = v.index,
+                .name = chain.View(v.propertyName),
+                .value = chain.View(v.value),
+                .type = chain.View(v.type),
+                .declaringType = chain.View(v.declaringType),
+                .valueType = chain.View(v.valueType),
+                .itemType = chain.View(v.itemType),
+                .overridden = v.overridden,
+                .metadataBits = v.metadataBits,
+                .source = src ? sourceName(src->source) : std::wstring_view(),
+                .styleTargetType =
+                    src ? chain.View(src->targetType) : std::wstring_view(),
+                .styleName = src ? chain.View(src->name) : std::wstring_view(),
+            };
+
+            if (m_format == Format::Csv) {
+                AppendCsvRow(out, row);
+            } else {
+                rowGroup.Add(row);
+            }
+
+            (*rows)++;
+        }
+    }
+
+    if (m_format == Format::Columnar) {
+        rowGroup.WriteTo(out);
+    }
+
+    return out;
+}
+
+void PropertyExporter::WriteInOrder(std::uint64_t sequence, std::string data) {
+    std::lock_guard lock(m_outputMutex);
+
+    m_formatted.emplace(sequence, std::move(data));
+
+    // Whichever worker completes the next batch in order writes it, along
+    // with the following batches which are already formatted.
+    while (!m_formatted.empty() && m_formatted.begin()->first == m_nextWrite) {
+        auto node = m_formatted.extract(m_formatted.begin());
+        const std::string& batchData = node.mapped();
+
+        if (!m_failed && !batchData.empty()) {
+            if (m_writer(batchData.data(), batchData.size())) {
+                m_bytesWritten += batchData.size();
+            } else {
+                m_failed = true;
+            }
+        }
+
+        m_nextWrite++;
+        m_pendingBatches--;
+    }
+}
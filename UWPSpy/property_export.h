@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "property_chain.h"
+
+// Writes the detailed property values of many elements to a file, one row per
+// value. Elements are added on the calling thread and grouped into batches,
+// which are formatted on worker threads. The formatted batches are written
+// in the order the elements were added, as soon as all previous batches were
+// written, so the output is streamed rather than kept in memory.
+//
+// Formats:
+// * Csv: UTF-8, with a header row, quoted per RFC 4180.
+// * Columnar: the "UWPSPYC1" magic and the column names, followed by a row
+//   group per batch. A row group is the row count and then each column:
+//   integer columns as LEB128 varints, zigzag-encoded if signed, handles as
+//   deltas from the previous row; string columns as a dictionary of the
+//   distinct UTF-8 strings followed by an index into it for each row. All
+//   lengths and counts are varints.
+class PropertyExporter {
+   public:
+    using Handle = std::uint64_t;
+    using ChainPtr = std::shared_ptr<const PropertyChain>;
+
+    enum class Format {
+        Csv,
+        Columnar,
+    };
+
+    // Called one call at a time, on a worker thread, or on the constructing
+    // thread for the header. Returning false fails the export, the remaining
+    // batches are dropped.
+    using Writer = std::function<bool(const char* data, size_t size)>;
+    // Called on worker threads concurrently.
+    using SourceToString = std::function<std::wstring(std::int32_t source)>;
+
+    struct Element {
+        Handle handle;
+        Handle parentHandle;
+        std::wstring typeName;
+        ChainPtr chain;
+    };
+
+    struct Stats {
+        size_t elements = 0;
+        size_t rows = 0;
+        size_t batches = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    // A thread count of zero uses all cores but one, which is left for the
+    // thread adding the elements.
+    PropertyExporter(Format format,
+                     Writer writer,
+                     SourceToString sourceToString,
+                     unsigned threadCount = 0,
+                     size_t batchSize = 64);
+    ~PropertyExporter();
+
+    PropertyExporter(const PropertyExporter&) = delete;
+    PropertyExporter& operator=(const PropertyExporter&) = delete;
+
+    void Add(Element element);
+
+    // Whether enough batches are waiting to be formatted or written that
+    // adding more elements should wait, to bound the memory usage.
+    bool Busy() const;
+
+    // Formats the remaining elements and waits for everything to be written.
+    // Returns false if writing failed.
+    bool Finish();
+
+    // Drops the elements which weren't formatted yet and waits for the worker
+    // threads without writing anything else. Failed returns true afterwards.
+    void Cancel();
+
+    bool Failed() const { return m_failed; }
+
+    // Complete once Finish returns.
+    Stats GetStats() const;
+
+   private:
+    struct Batch {
+        std::uint64_t sequence;
+        std::vector<Element> elements;
+    };
+
+    void WorkerThread();
+    void StopThreads();
+    void FlushBatch();
+    std::string FormatBatch(const std::vector<Element>& elements,
+                            size_t* rows) const;
+    void WriteInOrder(std::uint64_t sequence, std::string data);
+
+    Format m_format;
+    Writer m_writer;
+    SourceToString m_sourceToString;
+    size_t m_batchSize;
+    size_t m_maxPendingBatches;
+
+    std::vector<Element> m_currentBatch;
+    std::uint64_t m_nextSequence = 0;
+    size_t m_addedElements = 0;
+    bool m_finished = false;
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    std::deque<Batch> m_queue;
+    bool m_stopping = false;
+
+    // Formatted batches which wait for the previous ones to be written.
+    std::mutex m_outputMutex;
+    std::map<std::uint64_t, std::string> m_formatted;
+    std::uint64_t m_nextWrite = 0;
+    std::uint64_t m_bytesWritten = 0;
+
+    // Added but not written yet.
+    std::atomic<size_t> m_pendingBatches = 0;
+    std::atomic<size_t> m_rows = 0;
+    std::atomic<bool> m_failed = false;
+
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,64 @@
+#include "stdafx.h"
+
+#include "property_schema.h"
+
+PropertySchema::PropertySchema(const PropertyChain& chain) {
+    for (const auto& v : chain.Values()) {
+        if (v.overridden) {
+            continue;
+        }
+
+        auto name = chain.View(v.propertyName);
+        auto type = chain.View(v.type);
+
+        m_properties.push_back({
+            .index = v.index,
+            .name = std::wstring(name),
+            .type = std::wstring(type),
+            .declaringType = std::wstring(chain.View(v.declaringType)),
+            .label = std::format(L"{} ({})", name, type),
+        });
+    }
+}
+
+bool PropertySchema::Matches(const PropertyChain& chain) const {
+    size_t i = 0;
+    for (const auto& v : chain.Values()) {
+        if (v.overridden) {
+            continue;
+        }
+
+        if (i == m_properties.size()) {
+            return false;
+        }
+
+        const auto& p = m_properties[i++];
+        if (p.index != v.index || p.name != chain.View(v.propertyName) ||
+            p.type != chain.View(v.type) ||
+            p.declaringType != chain.View(v.declaringType)) {
+            return false;
+        }
+    }
+
+    return i == m_properties.size();
+}
+
+PropertySchemaCache::SchemaPtr PropertySchemaCache::Get(
+    std::wstring_view typeName,
+    const PropertyChain& chain) {
+    if (typeName.empty()) {
+        m_misses++;
+        return std::make_shared<PropertySchema>(chain);
+    }
+
+    std::wstring key(typeName);
+    if (auto* schema = m_cache.Get(key); schema && (*schema)->Matches(chain)) {
+        m_hits++;
+        return *schema;
+    }
+
+    m_misses++;
+    auto schema = std::make_shared<PropertySchema>(chain);
+    m_cache.Put(key, schema, 1);
+    return schema;
+}
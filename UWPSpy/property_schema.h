@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lru_cache.h"
+#include "property_chain.h"
+
+// The properties that can be set on an element, as listed in the property
+// name combo box: the non-overridden values of its property chain. Elements
+// of the same runtime type usually have the same schema, so the combo box
+// contents and their measured width are shared between them.
+class PropertySchema {
+   public:
+    struct Property {
+        std::uint32_t index;
+        std::wstring name;
+        std::wstring type;
+        std::wstring declaringType;
+        std::wstring label;  // "Name (Type)"
+    };
+
+    explicit PropertySchema(const PropertyChain& chain);
+
+    // Whether the chain has exactly the properties of the schema, in the same
+    // order. Doesn't allocate.
+    bool Matches(const PropertyChain& chain) const;
+
+    const std::vector<Property>& Properties() const { return m_properties; }
+
+    // The dropped width of the combo box filled with the labels, or 0 if not
+    // measured yet.
+    int DroppedWidth() const { return m_droppedWidth; }
+    void SetDroppedWidth(int width) { m_droppedWidth = width; }
+
+   private:
+    std::vector<Property> m_properties;
+    int m_droppedWidth = 0;
+};
+
+// Keeps the last schema seen for each runtime type. A schema is replaced if an
+// element of the same type turns out to have different properties, e.g. due to
+// attached properties.
+class PropertySchemaCache {
+   public:
+    using SchemaPtr = std::shared_ptr<PropertySchema>;
+
+    explicit PropertySchemaCache(size_t maxEntries = 256)
+        : m_cache(maxEntries) {}
+
+    // Schemas of elements without a type name aren't cached.
+    SchemaPtr Get(std::wstring_view typeName, const PropertyChain& chain);
+
+    void Clear() { m_cache.Clear(); }
+
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+
+   private:
+    LruCache<std::wstring, SchemaPtr> m_cache;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
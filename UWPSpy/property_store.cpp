@@ -0,0 +1,423 @@
+#include "stdafx.h"
+
+#include "property_store.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+#define PROPERTY_STORE_X86 1
+#include <emmintrin.h>
+#else
+#define PROPERTY_STORE_X86 0
+#endif
+
+namespace {
+
+// Rows of replaced elements are removed once there are more of them than live
+// rows.
+constexpr size_t kMinDeadRowsToCompact = 4096;
+
+// Appends the indices of the rows whose value is valueId.
+void ScanEquals(const std::vector<std::uint32_t>& values,
+                std::uint32_t valueId,
+                std::vector<std::uint32_t>* rows) {
+    size_t i = 0;
+    size_t size = values.size();
+
+#if PROPERTY_STORE_X86
+    const __m128i needle = _mm_set1_epi32(static_cast<int>(valueId));
+    for (; i + 4 <= size; i += 4) {
+        __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(values.data() + i));
+        __m128i equal = _mm_cmpeq_epi32(v, needle);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        if (!mask) {
+            continue;
+        }
+
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) {
+                rows->push_back(static_cast<std::uint32_t>(i + lane));
+            }
+        }
+    }
+#endif
+
+    for (; i < size; i++) {
+        if (values[i] == valueId) {
+            rows->push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+}
+
+// Appends the indices of the rows whose value is marked in matches. Branchless,
+// so that the loop doesn't depend on how many rows match.
+void ScanLookup(const std::vector<std::uint32_t>& values,
+                const std::vector<std::uint8_t>& matches,
+                std::vector<std::uint32_t>* rows) {
+    size_t size = values.size();
+    rows->resize(size);
+
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++) {
+        (*rows)[count] = static_cast<std::uint32_t>(i);
+        count += matches[values[i]];
+    }
+
+    rows->resize(count);
+}
+
+}  // namespace
+
+std::uint32_t PropertyStore::Dictionary::Intern(std::wstring_view str) {
+    if (auto it = m_ids.find(str); it != m_ids.end()) {
+        return it->second;
+    }
+
+    auto id = static_cast<std::uint32_t>(m_strings.size());
+    const auto& stored = m_strings.emplace_back(str);
+    m_ids.emplace(stored, id);
+    return id;
+}
+
+std::optional<std::uint32_t> PropertyStore::Dictionary::Find(
+    std::wstring_view str) const {
+    if (auto it = m_ids.find(str); it != m_ids.end()) {
+        return it->second;
+    }
+
+    return std::nullopt;
+}
+
+void PropertyStore::Dictionary::Clear() {
+    m_ids.clear();
+    m_strings.clear();
+}
+
+std::vector<std::uint32_t> PropertyStore::Dictionary::Compact(
+    const std::vector<std::uint8_t>& used) {
+    std::vector<std::uint32_t> newIds(m_strings.size(), UINT32_MAX);
+    std::deque<std::wstring> strings;
+    std::unordered_map<std::wstring_view, std::uint32_t> ids;
+    for (std::uint32_t i = 0; i < m_strings.size(); i++) {
+        if (used[i]) {
+            newIds[i] = static_cast<std::uint32_t>(strings.size());
+            const auto& stored = strings.emplace_back(std::move(m_strings[i]));
+            ids.emplace(stored, newIds[i]);
+        }
+    }
+
+    m_strings = std::move(strings);
+    m_ids = std::move(ids);
+    return newIds;
+}
+
+void PropertyStore::Put(Handle handle,
+                        std::wstring_view typeName,
+                        const PropertyChain& chain) {
+    Erase(handle);
+
+    auto elementId = static_cast<std::uint32_t>(m_elements.size());
+    std::uint32_t rowCount = 0;
+
+    for (const auto& v : chain.Values()) {
+        if (v.overridden) {
+            continue;
+        }
+
+        std::uint32_t propertyId =
+            m_propertyNames.Intern(chain.View(v.propertyName));
+        if (propertyId >= m_columns.size()) {
+            m_columns.resize(propertyId + 1);
+        }
+
+        const auto* src = chain.SourceOf(v);
+
+        Column& column = m_columns[propertyId];
+        column.elementIds.push_back(elementId);
+        column.valueIds.push_back(m_values.Intern(chain.View(v.value)));
+        column.styleNameIds.push_back(
+            m_styleNames.Intern(src ? chain.View(src->name) : L""));
+        column.sources.push_back(
+            static_cast<std::int8_t>(src ? src->source : -1));
+        rowCount++;
+    }
+
+    m_elements.push_back({
+        .handle = handle,
+        .typeId = m_typeNames.Intern(typeName),
+        .rowCount = rowCount,
+    });
+    m_alive.push_back(1);
+    m_elementIds[handle] = elementId;
+    m_liveRows += rowCount;
+}
+
+void PropertyStore::Erase(Handle handle) {
+    auto it = m_elementIds.find(handle);
+    if (it == m_elementIds.end()) {
+        return;
+    }
+
+    std::uint32_t elementId = it->second;
+    m_elementIds.erase(it);
+
+    m_alive[elementId] = 0;
+    m_liveRows -= m_elements[elementId].rowCount;
+    m_deadRows += m_elements[elementId].rowCount;
+
+    if (m_deadRows >= kMinDeadRowsToCompact && m_deadRows > m_liveRows) {
+        Compact();
+    }
+}
+
+void PropertyStore::Clear() {
+    m_typeNames.Clear();
+    m_propertyNames.Clear();
+    m_values.Clear();
+    m_styleNames.Clear();
+    m_columns.clear();
+    m_elements.clear();
+    m_alive.clear();
+    m_elementIds.clear();
+    m_liveRows = 0;
+    m_deadRows = 0;
+}
+
+std::vector<std::wstring> PropertyStore::TypeNames() const {
+    std::vector<std::uint8_t> used(m_typeNames.Size());
+    for (const auto& [handle, elementId] : m_elementIds) {
+        used[m_elements[elementId].typeId] = 1;
+    }
+
+    std::vector<std::wstring> names;
+    for (std::uint32_t i = 0; i < used.size(); i++) {
+        if (used[i]) {
+            names.emplace_back(m_typeNames.At(i));
+        }
+    }
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::vector<std::wstring> PropertyStore::PropertyNames() const {
+    std::vector<std::wstring> names;
+    for (std::uint32_t i = 0; i < m_propertyNames.Size(); i++) {
+        names.emplace_back(m_propertyNames.At(i));
+    }
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+PropertyStore::QueryResult PropertyStore::Run(const Query& query) const {
+    QueryResult result;
+
+    auto propertyId = m_propertyNames.Find(query.propertyName);
+    if (!propertyId || *propertyId >= m_columns.size()) {
+        return result;
+    }
+
+    std::optional<std::uint32_t> typeId;
+    if (!query.typeName.empty()) {
+        typeId = m_typeNames.Find(query.typeName);
+        if (!typeId) {
+            return result;
+        }
+    }
+
+    const Column& column = m_columns[*propertyId];
+    result.scannedRows = column.valueIds.size();
+
+    // Evaluate the value predicate on the dictionary, then select the rows.
+    std::vector<std::uint32_t> rows;
+    switch (query.valueOp) {
+        case ValueOp::Any:
+            rows.resize(column.valueIds.size());
+            for (std::uint32_t i = 0; i < rows.size(); i++) {
+                rows[i] = i;
+            }
+            break;
+
+        case ValueOp::Equals:
+            if (auto valueId = m_values.Find(query.value)) {
+                ScanEquals(column.valueIds, *valueId, &rows);
+            }
+            break;
+
+        case ValueOp::NotEquals:
+        case ValueOp::Contains: {
+            std::vector<std::uint8_t> matches(m_values.Size());
+            for (std::uint32_t i = 0; i < matches.size(); i++) {
+                auto value = m_values.At(i);
+                if (query.valueOp == ValueOp::NotEquals) {
+                    matches[i] = value != query.value;
+                } else {
+                    matches[i] = value.find(query.value) != value.npos;
+                }
+            }
+
+            ScanLookup(column.valueIds, matches, &rows);
+            break;
+        }
+    }
+
+    // Indexed by the id of the group key.
+    std::vector<size_t> counts;
+    switch (query.groupBy) {
+        case GroupBy::Value:
+            counts.resize(m_values.Size());
+            break;
+        case GroupBy::Source:
+            counts.resize(256);
+            break;
+        case GroupBy::StyleName:
+            counts.resize(m_styleNames.Size());
+            break;
+        case GroupBy::Type:
+            counts.resize(m_typeNames.Size());
+            break;
+    }
+
+    std::vector<Handle> firstHandles(counts.size());
+
+    for (std::uint32_t row : rows) {
+        std::uint32_t elementId = column.elementIds[row];
+        if (!m_alive[elementId]) {
+            continue;
+        }
+
+        if (typeId && m_elements[elementId].typeId != *typeId) {
+            continue;
+        }
+
+        result.matchedRows++;
+
+        std::uint32_t groupId = 0;
+        switch (query.groupBy) {
+            case GroupBy::Value:
+                groupId = column.valueIds[row];
+                break;
+            case GroupBy::Source:
+                groupId = static_cast<std::uint8_t>(column.sources[row]);
+                break;
+            case GroupBy::StyleName:
+                groupId = column.styleNameIds[row];
+                break;
+            case GroupBy::Type:
+                groupId = m_elements[elementId].typeId;
+                break;
+        }
+
+        if (!counts[groupId]++) {
+            firstHandles[groupId] = m_elements[elementId].handle;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < counts.size(); i++) {
+        if (!counts[i]) {
+            continue;
+        }
+
+        std::wstring key;
+        switch (query.groupBy) {
+            case GroupBy::Value:
+                key = m_values.At(i);
+                break;
+            case GroupBy::Source:
+                break;
+            case GroupBy::StyleName:
+                key = m_styleNames.At(i);
+                break;
+            case GroupBy::Type:
+                key = m_typeNames.At(i);
+                break;
+        }
+
+        result.groups.push_back({
+            .key = std::move(key),
+            .source = query.groupBy == GroupBy::Source
+                          ? static_cast<std::int8_t>(i)
+                          : -1,
+            .count = counts[i],
+            .firstHandle = firstHandles[i],
+        });
+    }
+
+    std::stable_sort(
+        result.groups.begin(), result.groups.end(),
+        [](const Group& a, const Group& b) { return a.count > b.count; });
+
+    return result;
+}
+
+void PropertyStore::Compact() {
+    // Renumber the live elements, keeping their order.
+    std::vector<std::uint32_t> newIds(m_elements.size(), UINT32_MAX);
+    std::vector<ElementSlot> elements;
+    for (std::uint32_t i = 0; i < m_elements.size(); i++) {
+        if (m_alive[i]) {
+            newIds[i] = static_cast<std::uint32_t>(elements.size());
+            elements.push_back(m_elements[i]);
+        }
+    }
+
+    // Only the strings of the remaining rows and elements are kept, so that
+    // the dictionaries don't grow with each replaced value, and queries don't
+    // evaluate predicates on strings which are no longer used.
+    std::vector<std::uint8_t> usedValues(m_values.Size());
+    std::vector<std::uint8_t> usedStyleNames(m_styleNames.Size());
+    std::vector<std::uint8_t> usedTypeNames(m_typeNames.Size());
+    for (const auto& element : elements) {
+        usedTypeNames[element.typeId] = 1;
+    }
+
+    for (auto& column : m_columns) {
+        size_t count = 0;
+        for (size_t row = 0; row < column.elementIds.size(); row++) {
+            std::uint32_t newId = newIds[column.elementIds[row]];
+            if (newId == UINT32_MAX) {
+                continue;
+            }
+
+            column.elementIds[count] = newId;
+            column.valueIds[count] = column.valueIds[row];
+            column.styleNameIds[count] = column.styleNameIds[row];
+            column.sources[count] = column.sources[row];
+            usedValues[column.valueIds[row]] = 1;
+            usedStyleNames[column.styleNameIds[row]] = 1;
+            count++;
+        }
+
+        column.elementIds.resize(count);
+        column.valueIds.resize(count);
+        column.styleNameIds.resize(count);
+        column.sources.resize(count);
+    }
+
+    auto newValueIds = m_values.Compact(usedValues);
+    auto newStyleNameIds = m_styleNames.Compact(usedStyleNames);
+    auto newTypeIds = m_typeNames.Compact(usedTypeNames);
+
+    for (auto& column : m_columns) {
+        for (auto& valueId : column.valueIds) {
+            valueId = newValueIds[valueId];
+        }
+
+        for (auto& styleNameId : column.styleNameIds) {
+            styleNameId = newStyleNameIds[styleNameId];
+        }
+    }
+
+    for (auto& element : elements) {
+        element.typeId = newTypeIds[element.typeId];
+    }
+
+    for (auto& [handle, elementId] : m_elementIds) {
+        elementId = newIds[elementId];
+    }
+
+    m_elements = std::move(elements);
+    m_alive.assign(m_elements.size(), 1);
+    m_deadRows = 0;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "property_chain.h"
+
+// The effective property values collected for the whole tree, e.g. by
+// PropertyCrawler, for analyses over all elements.
+//
+// Values are stored in columns per property, with all strings dictionary
+// encoded: a row of a property column is an element id, a value id, a style
+// name id and the BaseValueSource of the value. Queries evaluate predicates
+// once per dictionary entry, and then scan the integer columns.
+class PropertyStore {
+   public:
+    using Handle = std::uint64_t;
+
+    enum class ValueOp {
+        Any,
+        Equals,
+        NotEquals,
+        Contains,
+    };
+
+    enum class GroupBy {
+        Value,
+        Source,
+        StyleName,
+        Type,
+    };
+
+    struct Query {
+        // Matched exactly. If empty, elements of all types are matched.
+        std::wstring typeName;
+        std::wstring propertyName;
+        ValueOp valueOp = ValueOp::Any;
+        std::wstring value;
+        GroupBy groupBy = GroupBy::Value;
+    };
+
+    struct Group {
+        // The value, style name or type name. Empty if grouped by source.
+        std::wstring key;
+        // The BaseValueSource if grouped by source, otherwise -1. Also -1 for
+        // values without a source.
+        std::int32_t source;
+        size_t count;
+        Handle firstHandle;
+    };
+
+    struct QueryResult {
+        // Sorted by count, largest first.
+        std::vector<Group> groups;
+        size_t matchedRows = 0;
+        size_t scannedRows = 0;
+    };
+
+    // Replaces the previous values of the element, if any. Only the
+    // effective, non-overridden values of the chain are stored.
+    void Put(Handle handle,
+             std::wstring_view typeName,
+             const PropertyChain& chain);
+    void Erase(Handle handle);
+    void Clear();
+
+    size_t ElementCount() const { return m_elementIds.size(); }
+    size_t RowCount() const { return m_liveRows; }
+
+    // Sorted, for choosing the query parameters.
+    std::vector<std::wstring> TypeNames() const;
+    std::vector<std::wstring> PropertyNames() const;
+
+    QueryResult Run(const Query& query) const;
+
+   private:
+    class Dictionary {
+       public:
+        std::uint32_t Intern(std::wstring_view str);
+        std::optional<std::uint32_t> Find(std::wstring_view str) const;
+        std::wstring_view At(std::uint32_t id) const { return m_strings[id]; }
+        std::uint32_t Size() const {
+            return static_cast<std::uint32_t>(m_strings.size());
+        }
+        void Clear();
+        // Keeps the strings whose id is marked in used, in the same order.
+        // Returns the new ids, indexed by the old ids.
+        std::vector<std::uint32_t> Compact(
+            const std::vector<std::uint8_t>& used);
+
+       private:
+        // A deque, so that the views in m_ids stay valid.
+        std::deque<std::wstring> m_strings;
+        std::unordered_map<std::wstring_view, std::uint32_t> m_ids;
+    };
+
+    struct Column {
+        std::vector<std::uint32_t> elementIds;
+        std::vector<std::uint32_t> valueIds;
+        std::vector<std::uint32_t> styleNameIds;
+        std::vector<std::int8_t> sources;
+    };
+
+    struct ElementSlot {
+        Handle handle;
+        std::uint32_t typeId;
+        std::uint32_t rowCount;
+    };
+
+    void Compact();
+
+    Dictionary m_typeNames;
+    Dictionary m_propertyNames;
+    Dictionary m_values;
+    Dictionary m_styleNames;
+
+    // Indexed by property name id.
+    std::vector<Column> m_columns;
+
+    // Indexed by element id. A replaced or erased element keeps its rows
+    // until the columns are compacted, but is no longer alive.
+    std::vector<ElementSlot> m_elements;
+    std::vector<std::uint8_t> m_alive;
+    std::unordered_map<Handle, std::uint32_t> m_elementIds;
+
+    size_t m_liveRows = 0;
+    size_t m_deadRows = 0;
+};
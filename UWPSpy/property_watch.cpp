@@ -0,0 +1,225 @@
+#include "stdafx.h"
+
+#include "property_watch.h"
+
+PropertyWatchEngine::History::History(size_t capacity)
+    : m_entries(std::max(capacity, size_t{1})) {}
+
+bool PropertyWatchEngine::History::Record(std::uint64_t timeMs,
+                                          std::wstring_view value) {
+    if (auto last = Last(); last && *last == value) {
+        return false;
+    }
+
+    if (m_size == 0) {
+        m_baseTimeMs = timeMs;
+        m_lastTimeMs = timeMs;
+    }
+
+    if (m_size == Capacity()) {
+        // Drop the oldest entry, the next one becomes relative to its time.
+        m_baseTimeMs += m_entries[m_first].timeDelta;
+        m_first = (m_first + 1) % Capacity();
+        m_size--;
+    }
+
+    // Values are only referenced by the entries in the buffer, drop the rest
+    // before the dictionary grows too much.
+    if (m_values.size() >= Capacity() * 2) {
+        CompactValues();
+    }
+
+    m_entries[(m_first + m_size) % Capacity()] = {
+        .timeDelta = static_cast<std::uint32_t>(timeMs - m_lastTimeMs),
+        .value = InternValue(value),
+    };
+    m_size++;
+    m_lastTimeMs = timeMs;
+    return true;
+}
+
+std::optional<std::wstring_view> PropertyWatchEngine::History::Last() const {
+    if (m_size == 0) {
+        return std::nullopt;
+    }
+
+    const Entry& entry = m_entries[(m_first + m_size - 1) % Capacity()];
+    return m_values[entry.value];
+}
+
+std::wstring PropertyWatchEngine::History::Summary(size_t maxPoints) const {
+    size_t skip = m_size > maxPoints ? m_size - maxPoints : 0;
+
+    std::vector<std::wstring_view> values;
+    std::vector<double> numbers;
+    bool allNumbers = true;
+
+    size_t i = 0;
+    ForEach([&](std::uint64_t, std::wstring_view value) {
+        if (i++ < skip) {
+            return;
+        }
+
+        values.push_back(value);
+
+        if (allNumbers) {
+            wchar_t* end = nullptr;
+            std::wstring str(value);
+            double number = std::wcstod(str.c_str(), &end);
+            if (str.empty() || *end) {
+                allNumbers = false;
+            } else {
+                numbers.push_back(number);
+            }
+        }
+    });
+
+    if (values.empty()) {
+        return {};
+    }
+
+    std::wstring result;
+
+    if (allNumbers && numbers.size() > 1) {
+        constexpr wchar_t kBars[] = L"\x2581\x2582\x2583\x2584\x2585\x2586"
+                                    L"\x2587\x2588";
+        constexpr size_t kBarCount = std::size(kBars) - 1;
+
+        auto [minIt, maxIt] =
+            std::minmax_element(numbers.begin(), numbers.end());
+        double min = *minIt;
+        double range = *maxIt - min;
+        for (double number : numbers) {
+            size_t bar = 0;
+            if (range > 0) {
+                bar = static_cast<size_t>(
+                    (number - min) / range * (kBarCount - 1) + 0.5);
+            }
+
+            result += kBars[bar];
+        }
+
+        result += L' ';
+        result += values.back();
+        return result;
+    }
+
+    for (auto value : values) {
+        if (!result.empty()) {
+            result += L" \x2192 ";
+        }
+
+        result += value;
+    }
+
+    return result;
+}
+
+std::uint32_t PropertyWatchEngine::History::InternValue(
+    std::wstring_view value) {
+    for (size_t i = 0; i < m_values.size(); i++) {
+        if (m_values[i] == value) {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+
+    m_values.emplace_back(value);
+    return static_cast<std::uint32_t>(m_values.size() - 1);
+}
+
+void PropertyWatchEngine::History::CompactValues() {
+    std::vector<std::wstring> values;
+    std::vector<std::uint32_t> remap(m_values.size(), UINT32_MAX);
+
+    for (size_t i = 0; i < m_size; i++) {
+        Entry& entry = m_entries[(m_first + i) % Capacity()];
+        if (remap[entry.value] == UINT32_MAX) {
+            remap[entry.value] = static_cast<std::uint32_t>(values.size());
+            values.push_back(std::move(m_values[entry.value]));
+        }
+
+        entry.value = remap[entry.value];
+    }
+
+    m_values = std::move(values);
+}
+
+bool PropertyWatchEngine::Pin(Handle handle,
+                              std::uint32_t propertyIndex,
+                              std::wstring propertyName,
+                              int accessor) {
+    auto it = m_watches.begin() + LowerBound(handle, propertyIndex);
+    if (it != m_watches.end() && it->handle == handle &&
+        it->propertyIndex == propertyIndex) {
+        return false;
+    }
+
+    // Keep the round position on the same watch.
+    if (static_cast<size_t>(it - m_watches.begin()) < m_cursor) {
+        m_cursor++;
+    }
+
+    m_watches.insert(it, Watch{
+                             .handle = handle,
+                             .propertyIndex = propertyIndex,
+                             .propertyName = std::move(propertyName),
+                             .accessor = accessor,
+                             .history = History(m_historyCapacity),
+                         });
+    return true;
+}
+
+bool PropertyWatchEngine::Unpin(Handle handle, std::uint32_t propertyIndex) {
+    size_t i = LowerBound(handle, propertyIndex);
+    if (i == m_watches.size() || m_watches[i].handle != handle ||
+        m_watches[i].propertyIndex != propertyIndex) {
+        return false;
+    }
+
+    m_watches.erase(m_watches.begin() + i);
+    if (i < m_cursor) {
+        m_cursor--;
+    }
+
+    return true;
+}
+
+void PropertyWatchEngine::UnpinElement(Handle handle) {
+    size_t first = LowerBound(handle, 0);
+    size_t last = first;
+    while (last < m_watches.size() && m_watches[last].handle == handle) {
+        last++;
+    }
+
+    m_watches.erase(m_watches.begin() + first, m_watches.begin() + last);
+    if (m_cursor > first) {
+        m_cursor -= std::min(m_cursor, last) - first;
+    }
+}
+
+void PropertyWatchEngine::Clear() {
+    m_watches.clear();
+    m_cursor = 0;
+}
+
+const PropertyWatchEngine::Watch* PropertyWatchEngine::Find(
+    Handle handle,
+    std::uint32_t propertyIndex) const {
+    size_t i = LowerBound(handle, propertyIndex);
+    if (i == m_watches.size() || m_watches[i].handle != handle ||
+        m_watches[i].propertyIndex != propertyIndex) {
+        return nullptr;
+    }
+
+    return &m_watches[i];
+}
+
+size_t PropertyWatchEngine::LowerBound(Handle handle,
+                                       std::uint32_t propertyIndex) const {
+    auto it = std::lower_bound(
+        m_watches.begin(), m_watches.end(), std::pair(handle, propertyIndex),
+        [](const Watch& watch, const std::pair<Handle, std::uint32_t>& key) {
+            return std::pair(watch.handle, watch.propertyIndex) < key;
+        });
+    return it - m_watches.begin();
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Records how the values of pinned element properties change over time. The
+// caller samples the watches from a timer, and each call stops once the
+// caller's time budget is used up. The next call continues where the previous
+// one stopped, so that many watches don't stall the app UI thread.
+class PropertyWatchEngine {
+   public:
+    using Handle = std::uint64_t;
+
+    // The value changes of a property, in a fixed-size ring buffer. Only
+    // changes are stored: each entry has the time since the previous entry and
+    // an index in a small dictionary of the distinct values.
+    class History {
+       public:
+        explicit History(size_t capacity);
+
+        // Returns true if the value differs from the last recorded one.
+        bool Record(std::uint64_t timeMs, std::wstring_view value);
+
+        size_t Size() const { return m_size; }
+        size_t Capacity() const { return m_entries.size(); }
+
+        // Calls f(timeMs, value) for each change, oldest first.
+        template <typename F>
+        void ForEach(F&& f) const {
+            std::uint64_t timeMs = m_baseTimeMs;
+            for (size_t i = 0; i < m_size; i++) {
+                const Entry& entry = m_entries[(m_first + i) % Capacity()];
+                timeMs += entry.timeDelta;
+                f(timeMs, std::wstring_view(m_values[entry.value]));
+            }
+        }
+
+        std::optional<std::wstring_view> Last() const;
+
+        // A sparkline of the last changes if all values are numbers, otherwise
+        // the last distinct values.
+        std::wstring Summary(size_t maxPoints) const;
+
+       private:
+        struct Entry {
+            std::uint32_t timeDelta;
+            std::uint32_t value;
+        };
+
+        std::uint32_t InternValue(std::wstring_view value);
+        void CompactValues();
+
+        std::vector<Entry> m_entries;
+        size_t m_first = 0;
+        size_t m_size = 0;
+        // The time of the entry before the oldest one, the oldest entry's
+        // delta is relative to it.
+        std::uint64_t m_baseTimeMs = 0;
+        std::uint64_t m_lastTimeMs = 0;
+        std::vector<std::wstring> m_values;
+    };
+
+    struct Watch {
+        Handle handle;
+        std::uint32_t propertyIndex;
+        std::wstring propertyName;
+        // Chosen by the caller, e.g. a typed accessor for common properties.
+        int accessor;
+        History history;
+    };
+
+    struct StepResult {
+        size_t sampled = 0;
+        bool roundComplete = false;
+        // Elements with at least one changed value.
+        std::vector<Handle> changedHandles;
+    };
+
+    explicit PropertyWatchEngine(size_t historyCapacity = 64)
+        : m_historyCapacity(historyCapacity) {}
+
+    // Returns false if the property is already pinned.
+    bool Pin(Handle handle,
+             std::uint32_t propertyIndex,
+             std::wstring propertyName,
+             int accessor);
+    bool Unpin(Handle handle, std::uint32_t propertyIndex);
+    void UnpinElement(Handle handle);
+    void Clear();
+
+    const Watch* Find(Handle handle, std::uint32_t propertyIndex) const;
+    size_t Count() const { return m_watches.size(); }
+
+    // Samples watches in order, starting from the first one not sampled in
+    // the current round, until all watches were sampled or budgetExceeded()
+    // returns true. At least one watch is sampled per call.
+    // read(const Watch&) returns the current value, or nullopt on failure.
+    template <typename Read, typename BudgetExceeded>
+    StepResult Step(std::uint64_t nowMs,
+                    Read&& read,
+                    BudgetExceeded&& budgetExceeded) {
+        StepResult result;
+
+        while (m_cursor < m_watches.size()) {
+            if (result.sampled > 0 && budgetExceeded()) {
+                break;
+            }
+
+            Watch& watch = m_watches[m_cursor++];
+            result.sampled++;
+
+            std::optional<std::wstring> value = read(std::as_const(watch));
+            if (value && watch.history.Record(nowMs, *value) &&
+                (result.changedHandles.empty() ||
+                 result.changedHandles.back() != watch.handle)) {
+                result.changedHandles.push_back(watch.handle);
+            }
+        }
+
+        if (m_cursor >= m_watches.size()) {
+            result.roundComplete = true;
+            m_cursor = 0;
+        }
+
+        return result;
+    }
+
+   private:
+    // The position of the watch, or of where it would be inserted.
+    size_t LowerBound(Handle handle, std::uint32_t propertyIndex) const;
+
+    size_t m_historyCapacity;
+    // Sorted by handle, so that the watches of an element are sampled
+    // together.
+    std::vector<Watch> m_watches;
+    size_t m_cursor = 0;
+};
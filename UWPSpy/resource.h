@@ -6,6 +6,10 @@
 #define IDD_MAINDLG                     129
 #define IDB_SELBOX                      202
 #define IDD_ABOUT                       203
+#define IDD_REPEATED_SUBTREES           204
+#define IDD_TREE_HISTORY                205
+#define IDD_PROPERTY_QUERY              206
+#define IDD_PROPERTY_COMPARE            207
 #define IDC_ELEMENT_TREE                1000
 #define IDC_SPLIT_TOGGLE                1001
 #define IDC_CLASS_STATIC                1002
@@ -31,14 +35,33 @@
 #define IDC_ABOUT_BUTTON_RAMEN_SOFTWARE 1022
 #define IDC_ABOUT_BUTTON_HOMEPAGE       1023
 #define IDC_ABOUT_BUTTON_SOURCE_CODE    1024
+#define IDC_REPEATED_SUBTREES_LIST      1025
+#define IDC_ELEMENT_FILTER              1026
+#define IDC_ATTRIBUTE_FILTER            1027
+#define IDC_TREE_HISTORY_SLIDER         1028
+#define IDC_TREE_HISTORY_TIME           1029
+#define IDC_TREE_HISTORY_TREE           1030
+#define IDC_PROPERTY_QUERY_TYPE         1031
+#define IDC_PROPERTY_QUERY_PROPERTY     1032
+#define IDC_PROPERTY_QUERY_OP           1033
+#define IDC_PROPERTY_QUERY_VALUE        1034
+#define IDC_PROPERTY_QUERY_GROUP_BY     1035
+#define IDC_PROPERTY_QUERY_RUN          1036
+#define IDC_PROPERTY_QUERY_STATUS       1037
+#define IDC_PROPERTY_QUERY_RESULTS      1038
+#define IDC_PROPERTY_COMPARE_DIFF_ONLY  1039
+#define IDC_PROPERTY_COMPARE_DETAILED   1040
+#define IDC_PROPERTY_COMPARE_REFRESH    1041
+#define IDC_PROPERTY_COMPARE_STATUS     1042
+#define IDC_PROPERTY_COMPARE_LIST       1043
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        204
+#define _APS_NEXT_RESOURCE_VALUE        208
 #define _APS_NEXT_COMMAND_VALUE         32775
-#define _APS_NEXT_CONTROL_VALUE         1025
+#define _APS_NEXT_CONTROL_VALUE         1044
 #define _APS_NEXT_SYMED_VALUE           100
 #endif
 #endif
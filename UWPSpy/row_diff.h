@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// The difference between the rows shown in a list and the rows that should
+// replace them. If the row count is unchanged, each row is compared with the
+// row at the same position, and only the rows with a different key or
+// different contents are redrawn. Otherwise, rows are matched by key until the
+// first inserted or removed row. The rows after it are shifted, and all of
+// them have to be redrawn.
+//
+// Each row is compared at most once, so the diff is linear in the row count
+// rather than in the number of changes. It's meant for lists which are short
+// enough to compare on each refresh, such as the attributes of an element.
+struct RowDiff {
+    // Rows which have to be redrawn, before layoutChangedAt.
+    std::vector<size_t> changedRows;
+    // The first position from which rows are shifted. Equal to the new row
+    // count if the row count is unchanged.
+    size_t layoutChangedAt = 0;
+    size_t oldCount = 0;
+    size_t newCount = 0;
+
+    bool LayoutChanged() const {
+        return layoutChangedAt < std::max(oldCount, newCount);
+    }
+};
+
+// sameKey(oldIndex, newIndex) and sameContent(oldIndex, newIndex) compare an
+// old row with a new row. sameContent is only called for rows with the same
+// key.
+template <typename SameKey, typename SameContent>
+RowDiff DiffRows(size_t oldCount,
+                 size_t newCount,
+                 SameKey&& sameKey,
+                 SameContent&& sameContent) {
+    RowDiff diff{
+        .changedRows = {},
+        .layoutChangedAt = 0,
+        .oldCount = oldCount,
+        .newCount = newCount,
+    };
+
+    if (oldCount == newCount) {
+        for (size_t i = 0; i < newCount; i++) {
+            if (!sameKey(i, i) || !sameContent(i, i)) {
+                diff.changedRows.push_back(i);
+            }
+        }
+
+        diff.layoutChangedAt = newCount;
+        return diff;
+    }
+
+    size_t commonCount = std::min(oldCount, newCount);
+    size_t i = 0;
+    for (; i < commonCount; i++) {
+        if (!sameKey(i, i)) {
+            break;
+        }
+
+        if (!sameContent(i, i)) {
+            diff.changedRows.push_back(i);
+        }
+    }
+
+    diff.layoutChangedAt = i;
+    return diff;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Caches a value per runtime class name, such as the interfaces implemented by
+// objects of the class. Objects of the same runtime class implement the same
+// interfaces, so probing them with QueryInterface once per class is enough.
+template <typename Value>
+class RuntimeClassCache {
+   public:
+    // compute() is called on a miss. Objects without a class name aren't
+    // cached.
+    template <typename Compute>
+    Value Get(std::wstring_view className, Compute&& compute) {
+        if (className.empty()) {
+            m_misses++;
+            return compute();
+        }
+
+        if (auto it = m_values.find(className); it != m_values.end()) {
+            m_hits++;
+            return it->second;
+        }
+
+        m_misses++;
+        Value value = compute();
+        m_values.emplace(className, value);
+        return value;
+    }
+
+    void Clear() { m_values.clear(); }
+
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+
+   private:
+    // Allows lookups by std::wstring_view without allocating a key.
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view s) const {
+            return std::hash<std::wstring_view>{}(s);
+        }
+    };
+
+    std::unordered_map<std::wstring, Value, Hash, std::equal_to<>> m_values;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
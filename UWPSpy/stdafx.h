@@ -5,6 +5,7 @@
 // STL
 
 #include <algorithm>
+#include <chrono>
 #include <format>
 #include <functional>
 #include <optional>
@@ -12,6 +13,7 @@
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 // WTL
@@ -24,6 +26,7 @@
 #define _ATL_CSTRING_EXPLICIT_CONSTRUCTORS
 
 #include <atlbase.h>
+#include <atlfile.h>
 #include <atlstr.h>
 #include <atltypes.h>
 
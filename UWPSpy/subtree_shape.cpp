@@ -0,0 +1,105 @@
+#include "stdafx.h"
+
+#include "subtree_shape.h"
+
+namespace {
+
+// https://xorshift.di.unimi.it/splitmix64.c
+std::uint64_t Mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+}  // namespace
+
+namespace SubtreeShape {
+
+std::uint64_t TypeHash(std::wstring_view type) {
+    // FNV-1a.
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (wchar_t c : type) {
+        hash ^= static_cast<std::uint16_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+Hasher::Hasher(std::uint64_t typeHash) : m_state(Mix(typeHash)) {}
+
+void Hasher::AddChild(std::uint64_t childShapeHash) {
+    m_state = Mix(m_state + 0x9e3779b97f4a7c15ULL + childShapeHash);
+    m_childCount++;
+}
+
+std::uint64_t Hasher::Finish() const {
+    std::uint64_t hash = Mix(m_state ^ m_childCount);
+    // 0 is reserved for "no hash".
+    return hash ? hash : 1;
+}
+
+std::vector<RepeatedShape> FindRepeatedShapes(const std::vector<Entry>& entries,
+                                              size_t maxResults) {
+    struct Group {
+        RepeatedShape shape;
+        // The shape of the parent if it's the same for all entries, otherwise
+        // 0.
+        std::uint64_t commonParentShapeHash;
+    };
+
+    std::unordered_map<std::uint64_t, Group> groups;
+    groups.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        auto [it, inserted] = groups.try_emplace(entry.shapeHash);
+        auto& group = it->second;
+        if (inserted) {
+            group.shape = {
+                .shapeHash = entry.shapeHash,
+                .representative = entry.handle,
+                .count = 0,
+                .subtreeSize = entry.subtreeSize,
+            };
+            group.commonParentShapeHash = entry.parentShapeHash;
+        } else if (group.commonParentShapeHash != entry.parentShapeHash) {
+            group.commonParentShapeHash = 0;
+        }
+
+        group.shape.count++;
+    }
+
+    std::vector<RepeatedShape> result;
+
+    for (const auto& [shapeHash, group] : groups) {
+        if (group.shape.count < 2 || group.shape.subtreeSize < 2) {
+            continue;
+        }
+
+        if (group.commonParentShapeHash) {
+            auto parentGroup = groups.find(group.commonParentShapeHash);
+            if (parentGroup != groups.end() &&
+                parentGroup->second.shape.count == group.shape.count) {
+                continue;
+            }
+        }
+
+        result.push_back(group.shape);
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const RepeatedShape& a, const RepeatedShape& b) {
+                  return a.TotalSize() > b.TotalSize();
+              });
+
+    if (result.size() > maxResults) {
+        result.resize(maxResults);
+    }
+
+    return result;
+}
+
+}  // namespace SubtreeShape
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Structural (Merkle) hashing of element subtrees. The shape hash of an
+// element depends only on its type and on the shape hashes of its children, in
+// order, so identical template expansions end up with identical hashes.
+
+namespace SubtreeShape {
+
+std::uint64_t TypeHash(std::wstring_view type);
+
+// Incrementally builds the shape hash of an element from its children.
+class Hasher {
+   public:
+    explicit Hasher(std::uint64_t typeHash);
+
+    void AddChild(std::uint64_t childShapeHash);
+    std::uint64_t Finish() const;
+
+   private:
+    std::uint64_t m_state;
+    std::uint64_t m_childCount = 0;
+};
+
+struct Entry {
+    std::uint64_t handle;
+    std::uint64_t shapeHash;
+    std::uint64_t parentShapeHash;  // 0 for the root of the scanned subtree.
+    std::uint64_t subtreeSize;
+};
+
+struct RepeatedShape {
+    std::uint64_t shapeHash;
+    std::uint64_t representative;
+    std::uint64_t count;
+    std::uint64_t subtreeSize;
+
+    std::uint64_t TotalSize() const { return count * subtreeSize; }
+};
+
+// Groups the entries by shape, and returns the repeated shapes, heaviest
+// (count × subtree size) first. Single-element shapes are skipped, as are
+// shapes which only repeat because their parent shape repeats, e.g. the single
+// child of a repeated item template.
+std::vector<RepeatedShape> FindRepeatedShapes(const std::vector<Entry>& entries,
+                                              size_t maxResults);
+
+}  // namespace SubtreeShape
@@ -0,0 +1,330 @@
+#include "stdafx.h"
+
+#include "text_search.h"
+
+#include <cwctype>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+#define TEXT_SEARCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define TEXT_SEARCH_X86 0
+#endif
+
+// MSVC allows AVX2 intrinsics in any function, GCC and Clang require the
+// target to be enabled per function.
+#if TEXT_SEARCH_X86 && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+using TextSearch::Utf16::Path;
+
+// wchar_t is UTF-16 on Windows. Elsewhere, the UTF-16 functions are only used
+// directly, e.g. by tests.
+constexpr bool kWcharIsUtf16 = sizeof(wchar_t) == 2;
+
+// Only called if wchar_t is UTF-16.
+std::u16string_view AsUtf16(std::wstring_view text) {
+    return {reinterpret_cast<const char16_t*>(text.data()), text.size()};
+}
+
+template <typename Char>
+bool EqualsFolded(const Char* text, const Char* folded, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (TextSearch::FoldChar(static_cast<wchar_t>(text[i])) !=
+            static_cast<wchar_t>(folded[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Char>
+bool ContainsFoldedScalar(std::basic_string_view<Char> haystack,
+                          std::basic_string_view<Char> foldedNeedle,
+                          size_t start) {
+    size_t m = foldedNeedle.size();
+    for (size_t i = start; i + m <= haystack.size(); i++) {
+        if (EqualsFolded(haystack.data() + i, foldedNeedle.data(), m)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#if TEXT_SEARCH_X86
+
+__m128i FoldAscii(__m128i v) {
+    const __m128i offset = _mm_sub_epi16(v, _mm_set1_epi16('A'));
+    const __m128i isUpper =
+        _mm_and_si128(_mm_cmpgt_epi16(offset, _mm_set1_epi16(-1)),
+                      _mm_cmplt_epi16(offset, _mm_set1_epi16(26)));
+    return _mm_or_si128(v, _mm_and_si128(isUpper, _mm_set1_epi16(0x20)));
+}
+
+TARGET_AVX2 __m256i FoldAscii(__m256i v) {
+    const __m256i offset = _mm256_sub_epi16(v, _mm256_set1_epi16('A'));
+    const __m256i isUpper =
+        _mm256_and_si256(_mm256_cmpgt_epi16(offset, _mm256_set1_epi16(-1)),
+                         _mm256_cmpgt_epi16(_mm256_set1_epi16(26), offset));
+    return _mm256_or_si256(v,
+                           _mm256_and_si256(isUpper, _mm256_set1_epi16(0x20)));
+}
+
+unsigned CountTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Filters candidate positions by comparing the first and the last needle
+// characters, 8 positions at a time, then verifies the candidates.
+// https://0x80.pl/articles/simd-strfind.html
+bool ContainsFoldedSse2(std::u16string_view haystack,
+                        std::u16string_view foldedNeedle) {
+    const char16_t* h = haystack.data();
+    const char16_t* f = foldedNeedle.data();
+    size_t n = haystack.size();
+    size_t m = foldedNeedle.size();
+
+    const __m128i first = _mm_set1_epi16(static_cast<short>(f[0]));
+    const __m128i last = _mm_set1_epi16(static_cast<short>(f[m - 1]));
+
+    size_t i = 0;
+    for (; i + m - 1 + 8 <= n; i += 8) {
+        const __m128i blockFirst = FoldAscii(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i)));
+        const __m128i blockLast = FoldAscii(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + m - 1)));
+
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(blockFirst, first),
+                                            _mm_cmpeq_epi16(blockLast, last))));
+        while (mask) {
+            unsigned bit = CountTrailingZeros(mask);
+            if (m <= 2 || EqualsFolded(h + i + bit / 2 + 1, f + 1, m - 2)) {
+                return true;
+            }
+
+            // Two mask bits per 16-bit lane.
+            mask &= ~(3u << bit);
+        }
+    }
+
+    return ContainsFoldedScalar(haystack, foldedNeedle, i);
+}
+
+TARGET_AVX2 bool ContainsFoldedAvx2(std::u16string_view haystack,
+                                    std::u16string_view foldedNeedle) {
+    const char16_t* h = haystack.data();
+    const char16_t* f = foldedNeedle.data();
+    size_t n = haystack.size();
+    size_t m = foldedNeedle.size();
+
+    const __m256i first = _mm256_set1_epi16(static_cast<short>(f[0]));
+    const __m256i last = _mm256_set1_epi16(static_cast<short>(f[m - 1]));
+
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        const __m256i blockFirst = FoldAscii(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i)));
+        const __m256i blockLast = FoldAscii(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(h + i + m - 1)));
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi16(blockFirst, first),
+                             _mm256_cmpeq_epi16(blockLast, last))));
+        while (mask) {
+            unsigned bit = CountTrailingZeros(mask);
+            if (m <= 2 || EqualsFolded(h + i + bit / 2 + 1, f + 1, m - 2)) {
+                return true;
+            }
+
+            mask &= ~(3u << bit);
+        }
+    }
+
+    return ContainsFoldedScalar(haystack, foldedNeedle, i);
+}
+
+bool StartsWithFoldedSse2(std::u16string_view haystack,
+                          std::u16string_view foldedNeedle) {
+    const char16_t* h = haystack.data();
+    const char16_t* f = foldedNeedle.data();
+    size_t m = foldedNeedle.size();
+
+    size_t i = 0;
+    for (; i + 8 <= m; i += 8) {
+        const __m128i block = FoldAscii(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i)));
+        const __m128i needle =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(f + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(block, needle)) != 0xFFFF &&
+            !EqualsFolded(h + i, f + i, 8)) {
+            // The vector path only folds ASCII, recheck with the scalar path
+            // before reporting a mismatch.
+            return false;
+        }
+    }
+
+    return EqualsFolded(h + i, f + i, m - i);
+}
+
+bool HasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // TEXT_SEARCH_X86
+
+}  // namespace
+
+namespace TextSearch {
+
+wchar_t FoldChar(wchar_t c) {
+    if (c < 0x80) {
+        return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c | 0x20) : c;
+    }
+
+    wchar_t lower = static_cast<wchar_t>(std::towlower(c));
+    return lower < 0x80 ? c : lower;
+}
+
+std::wstring FoldCase(std::wstring_view text) {
+    std::wstring folded(text.size(), L'\0');
+    std::transform(text.begin(), text.end(), folded.begin(), FoldChar);
+    return folded;
+}
+
+bool ContainsFolded(std::wstring_view haystack,
+                    std::wstring_view foldedNeedle) {
+    if constexpr (kWcharIsUtf16) {
+        static const Path path = Utf16::BestPath();
+        return Utf16::ContainsFolded(AsUtf16(haystack), AsUtf16(foldedNeedle),
+                                     path);
+    }
+
+    return ContainsFoldedScalar(haystack, foldedNeedle, 0);
+}
+
+bool StartsWithFolded(std::wstring_view haystack,
+                      std::wstring_view foldedNeedle) {
+    if constexpr (kWcharIsUtf16) {
+        static const Path path = Utf16::BestPath();
+        return Utf16::StartsWithFolded(AsUtf16(haystack),
+                                       AsUtf16(foldedNeedle), path);
+    }
+
+    return foldedNeedle.size() <= haystack.size() &&
+           EqualsFolded(haystack.data(), foldedNeedle.data(),
+                        foldedNeedle.size());
+}
+
+namespace Utf16 {
+
+Path BestPath() {
+#if TEXT_SEARCH_X86
+    return HasAvx2() ? Path::Avx2 : Path::Sse2;
+#else
+    return Path::Scalar;
+#endif
+}
+
+bool IsSupported(Path path) {
+    switch (path) {
+        case Path::Scalar:
+            return true;
+
+        case Path::Sse2:
+            return TEXT_SEARCH_X86;
+
+        case Path::Avx2:
+#if TEXT_SEARCH_X86
+            return HasAvx2();
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+bool ContainsFolded(std::u16string_view haystack,
+                    std::u16string_view foldedNeedle,
+                    Path path) {
+    size_t m = foldedNeedle.size();
+    if (m == 0) {
+        return true;
+    }
+
+    if (m > haystack.size()) {
+        return false;
+    }
+
+    // The vector path only folds ASCII, so it can't find candidates for a
+    // needle which starts or ends with a non-ASCII character.
+    if (path == Path::Scalar || foldedNeedle.front() >= 0x80 ||
+        foldedNeedle.back() >= 0x80) {
+        return ContainsFoldedScalar(haystack, foldedNeedle, 0);
+    }
+
+#if TEXT_SEARCH_X86
+    return path == Path::Avx2 ? ContainsFoldedAvx2(haystack, foldedNeedle)
+                              : ContainsFoldedSse2(haystack, foldedNeedle);
+#else
+    return ContainsFoldedScalar(haystack, foldedNeedle, 0);
+#endif
+}
+
+bool StartsWithFolded(std::u16string_view haystack,
+                      std::u16string_view foldedNeedle,
+                      Path path) {
+    if (foldedNeedle.size() > haystack.size()) {
+        return false;
+    }
+
+    // There's no AVX2 version, prefixes are short.
+#if TEXT_SEARCH_X86
+    if (path != Path::Scalar) {
+        return StartsWithFoldedSse2(haystack, foldedNeedle);
+    }
+#endif
+
+    return EqualsFolded(haystack.data(), foldedNeedle.data(),
+                        foldedNeedle.size());
+}
+
+}  // namespace Utf16
+
+}  // namespace TextSearch
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Case-insensitive UTF-16 matching, used for filtering the element tree and the
+// attribute list. The haystack is case-folded on the fly with SSE2 or AVX2,
+// depending on the CPU, and candidate positions are verified with a scalar
+// loop.
+//
+// Case folding: ASCII letters are folded in the vector path. Other characters
+// are folded with towlower, unless that would map them into the ASCII range
+// (e.g. the Kelvin sign), to keep both paths consistent.
+
+namespace TextSearch {
+
+wchar_t FoldChar(wchar_t c);
+std::wstring FoldCase(std::wstring_view text);
+
+// The needle must already be folded with FoldCase.
+bool ContainsFolded(std::wstring_view haystack, std::wstring_view foldedNeedle);
+bool StartsWithFolded(std::wstring_view haystack,
+                      std::wstring_view foldedNeedle);
+
+// The UTF-16 implementation of the functions above, which they use if wchar_t
+// is UTF-16. The path can be chosen, e.g. to compare the vector paths with the
+// scalar path on any platform. A path must be supported by the CPU.
+namespace Utf16 {
+
+enum class Path {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// The fastest supported path.
+Path BestPath();
+bool IsSupported(Path path);
+
+bool ContainsFolded(std::u16string_view haystack,
+                    std::u16string_view foldedNeedle,
+                    Path path);
+// Avx2 uses the SSE2 path.
+bool StartsWithFolded(std::u16string_view haystack,
+                      std::u16string_view foldedNeedle,
+                      Path path);
+
+}  // namespace Utf16
+
+// A leading '^' anchors the pattern to the start of the text.
+class Pattern {
+   public:
+    Pattern() = default;
+    explicit Pattern(std::wstring_view text) {
+        if (!text.empty() && text.front() == L'^') {
+            m_prefix = true;
+            text.remove_prefix(1);
+        }
+
+        m_folded = FoldCase(text);
+    }
+
+    bool IsEmpty() const { return m_folded.empty(); }
+    bool IsPrefix() const { return m_prefix; }
+    const std::wstring& Folded() const { return m_folded; }
+
+    // An empty pattern matches everything.
+    bool FoundIn(std::wstring_view text) const {
+        return m_prefix ? StartsWithFolded(text, m_folded)
+                        : ContainsFolded(text, m_folded);
+    }
+
+    bool operator==(const Pattern&) const = default;
+
+   private:
+    std::wstring m_folded;
+    bool m_prefix = false;
+};
+
+}  // namespace TextSearch
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Caches the measured widths of strings per font, such as the property labels
+// of the property name combo box, which mostly repeat between element types.
+// The measurement is done by a callback, so that a device context is only
+// needed when a string wasn't measured before.
+class TextWidthCache {
+   public:
+    // Identifies the font, e.g. a font handle.
+    using FontKey = std::uint64_t;
+
+    explicit TextWidthCache(size_t maxEntries = 16384)
+        : m_maxEntries(maxEntries) {}
+
+    // measure(text) is called on a miss and returns the width in pixels.
+    template <typename Measure>
+    int Width(FontKey font, std::wstring_view text, Measure&& measure) {
+        if (font != m_font) {
+            // Widths of a previous font, e.g. before a DPI change, aren't
+            // needed anymore.
+            m_widths.clear();
+            m_font = font;
+        }
+
+        if (auto it = m_widths.find(text); it != m_widths.end()) {
+            m_hits++;
+            return it->second;
+        }
+
+        m_misses++;
+        int width = measure(text);
+
+        if (m_widths.size() >= m_maxEntries) {
+            m_widths.clear();
+        }
+
+        m_widths.emplace(text, width);
+        return width;
+    }
+
+    void Clear() { m_widths.clear(); }
+
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+
+   private:
+    // Allows lookups by std::wstring_view without allocating a key.
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view s) const {
+            return std::hash<std::wstring_view>{}(s);
+        }
+    };
+
+    size_t m_maxEntries;
+    FontKey m_font = 0;
+    std::unordered_map<std::wstring, int, Hash, std::equal_to<>> m_widths;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
@@ -0,0 +1,271 @@
+#include "stdafx.h"
+
+#include "tree_history.h"
+
+namespace {
+
+// A new checkpoint is taken once the current segment has this many mutations,
+// or a quarter of the tree size if larger. The replay of a reconstruction is
+// bounded by the same number.
+constexpr size_t kMinMutationsPerSegment = 1024;
+constexpr size_t kTreeSizeToMutationsRatio = 4;
+
+// Rough per-entry costs of the hash maps, including the node allocation and
+// the bucket.
+constexpr size_t kMapEntryOverhead = 48;
+
+}  // namespace
+
+size_t TreeHistory::TreeState::EstimateMemoryUsage() const {
+    size_t usage = elements.size() * (sizeof(Handle) + sizeof(Element) +
+                                      kMapEntryOverhead);
+    for (const auto& [parent, childHandles] : children) {
+        usage += sizeof(Handle) + sizeof(std::vector<Handle>) +
+                 kMapEntryOverhead + childHandles.capacity() * sizeof(Handle);
+    }
+
+    return usage;
+}
+
+TreeHistory::TreeHistory(size_t memoryLimit) : m_memoryLimit(memoryLimit) {}
+
+void TreeHistory::RecordAdd(std::uint64_t timeMs,
+                            Handle handle,
+                            Handle parent,
+                            std::uint32_t childIndex,
+                            std::wstring_view title) {
+    Record({
+        .timeMs = timeMs,
+        .handle = handle,
+        .parent = parent,
+        .childIndex = childIndex,
+        .title = InternTitle(title),
+        .add = true,
+    });
+}
+
+void TreeHistory::RecordRemove(std::uint64_t timeMs, Handle handle) {
+    if (!m_current.elements.contains(handle)) {
+        return;
+    }
+
+    Record({
+        .timeMs = timeMs,
+        .handle = handle,
+        .parent = 0,
+        .childIndex = 0,
+        .title = 0,
+        .add = false,
+    });
+}
+
+void TreeHistory::Clear() {
+    m_memoryUsage = 0;
+    m_current = {};
+    m_segments.clear();
+    m_titleIds.clear();
+    m_titles.clear();
+    m_freeTitleIds.clear();
+}
+
+std::optional<TreeHistory::TreeState> TreeHistory::Reconstruct(
+    std::uint64_t timeMs) const {
+    auto it = std::upper_bound(
+        m_segments.begin(), m_segments.end(), timeMs,
+        [](std::uint64_t timeMs, const Segment& segment) {
+            return timeMs < segment.startTimeMs;
+        });
+    if (it == m_segments.begin()) {
+        return std::nullopt;
+    }
+
+    const Segment& segment = *--it;
+
+    TreeState state = segment.checkpoint;
+    for (const auto& mutation : segment.mutations) {
+        if (mutation.timeMs > timeMs) {
+            break;
+        }
+
+        Apply(state, mutation);
+    }
+
+    return state;
+}
+
+std::optional<std::uint64_t> TreeHistory::OldestTime() const {
+    if (m_segments.empty()) {
+        return std::nullopt;
+    }
+
+    return m_segments.front().startTimeMs;
+}
+
+// Same logic as CMainDlg::ElementAdded and CMainDlg::ElementRemoved.
+void TreeHistory::Apply(TreeState& state, const Mutation& mutation) {
+    if (!mutation.add) {
+        auto it = state.elements.find(mutation.handle);
+        if (it == state.elements.end()) {
+            return;
+        }
+
+        auto itChildren = state.children.find(it->second.parent);
+        if (itChildren != state.children.end()) {
+            auto& siblings = itChildren->second;
+            siblings.erase(
+                std::remove(siblings.begin(), siblings.end(), mutation.handle),
+                siblings.end());
+
+            // Otherwise, every parent which ever existed would be copied to
+            // all following checkpoints.
+            if (siblings.empty()) {
+                state.children.erase(itChildren);
+            }
+        }
+
+        state.elements.erase(it);
+        return;
+    }
+
+    if (state.elements.contains(mutation.handle)) {
+        Apply(state, {
+                         .timeMs = mutation.timeMs,
+                         .handle = mutation.handle,
+                         .parent = 0,
+                         .childIndex = 0,
+                         .title = 0,
+                         .add = false,
+                     });
+    }
+
+    state.elements[mutation.handle] = {
+        .parent = mutation.parent,
+        .title = mutation.title,
+    };
+
+    auto& siblings = state.children[mutation.parent];
+    if (mutation.parent && mutation.childIndex <= siblings.size()) {
+        siblings.insert(siblings.begin() + mutation.childIndex,
+                        mutation.handle);
+    } else {
+        siblings.push_back(mutation.handle);
+    }
+}
+
+TreeHistory::TitleId TreeHistory::InternTitle(std::wstring_view title) {
+    auto it = m_titleIds.find(title);
+    if (it != m_titleIds.end()) {
+        return it->second;
+    }
+
+    TitleId id;
+    if (!m_freeTitleIds.empty()) {
+        id = m_freeTitleIds.back();
+        m_freeTitleIds.pop_back();
+        m_titles[id].text = title;
+    } else {
+        id = static_cast<TitleId>(m_titles.size());
+        m_titles.push_back({.text = std::wstring(title), .references = 0});
+    }
+
+    const auto& storedTitle = m_titles[id];
+    m_titleIds.emplace(storedTitle.text, id);
+    m_memoryUsage += TitleMemoryUsage(storedTitle);
+
+    // Unreferenced until the mutation is recorded.
+    return id;
+}
+
+void TreeHistory::AddTitleReference(TitleId id) {
+    m_titles[id].references++;
+}
+
+void TreeHistory::ReleaseTitle(TitleId id) {
+    auto& title = m_titles[id];
+    if (--title.references > 0) {
+        return;
+    }
+
+    m_memoryUsage -= TitleMemoryUsage(title);
+    m_titleIds.erase(title.text);
+    title.text = std::wstring();
+    m_freeTitleIds.push_back(id);
+}
+
+// static
+size_t TreeHistory::TitleMemoryUsage(const InternedTitle& title) {
+    return sizeof(InternedTitle) + title.text.capacity() * sizeof(wchar_t) +
+           kMapEntryOverhead;
+}
+
+void TreeHistory::Record(const Mutation& mutation) {
+    if (m_segments.empty() ||
+        m_segments.back().mutations.size() >=
+            std::max(kMinMutationsPerSegment,
+                     m_current.elements.size() / kTreeSizeToMutationsRatio)) {
+        StartSegment(mutation.timeMs);
+    }
+
+    // The references of m_current are updated before applying, which might
+    // replace or remove an element. The new title is referenced first, in
+    // case it's also the replaced one.
+    if (mutation.add) {
+        // By the element and by the mutation.
+        AddTitleReference(mutation.title);
+        AddTitleReference(mutation.title);
+    }
+
+    if (auto it = m_current.elements.find(mutation.handle);
+        it != m_current.elements.end()) {
+        ReleaseTitle(it->second.title);
+    }
+
+    Apply(m_current, mutation);
+
+    auto& mutations = m_segments.back().mutations;
+    size_t capacity = mutations.capacity();
+    mutations.push_back(mutation);
+    m_memoryUsage += (mutations.capacity() - capacity) * sizeof(Mutation);
+
+    EnforceMemoryLimit();
+}
+
+void TreeHistory::StartSegment(std::uint64_t timeMs) {
+    Segment segment{
+        .startTimeMs = timeMs,
+        .checkpoint = m_current,
+        .checkpointMemoryUsage = m_current.EstimateMemoryUsage(),
+        .mutations = {},
+    };
+
+    segment.mutations.reserve(kMinMutationsPerSegment);
+
+    for (const auto& [handle, element] : segment.checkpoint.elements) {
+        AddTitleReference(element.title);
+    }
+
+    m_memoryUsage += segment.checkpointMemoryUsage +
+                     segment.mutations.capacity() * sizeof(Mutation);
+    m_segments.push_back(std::move(segment));
+}
+
+void TreeHistory::EnforceMemoryLimit() {
+    // The current segment is always kept, even if it alone exceeds the limit.
+    while (m_memoryUsage > m_memoryLimit && m_segments.size() > 1) {
+        const auto& segment = m_segments.front();
+        m_memoryUsage -= segment.checkpointMemoryUsage +
+                         segment.mutations.capacity() * sizeof(Mutation);
+
+        for (const auto& [handle, element] : segment.checkpoint.elements) {
+            ReleaseTitle(element.title);
+        }
+
+        for (const auto& mutation : segment.mutations) {
+            if (mutation.add) {
+                ReleaseTitle(mutation.title);
+            }
+        }
+
+        m_segments.pop_front();
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A bounded in-memory history of element tree mutations, which allows
+// reconstructing the tree as it was at a given time.
+//
+// The history is split into segments, each starting with a full checkpoint of
+// the tree followed by the mutations recorded after it, similar to video
+// keyframes. A reconstruction copies one checkpoint and replays at most one
+// segment of mutations. A new checkpoint is taken once the mutation count of
+// the current segment reaches a fraction of the tree size, which keeps the
+// checkpoint memory proportional to the mutation memory. The oldest segments
+// are dropped when the memory limit is exceeded.
+//
+// Titles are interned and counted toward the limit. A title is dropped once no
+// checkpoint, mutation or element of the current tree refers to it.
+class TreeHistory {
+   public:
+    using Handle = std::uint64_t;
+    using TitleId = std::uint32_t;
+
+    // Mirrors the element maps of the main dialog: children can be added
+    // before their parent, and root elements are kept under the 0 handle.
+    struct TreeState {
+        struct Element {
+            Handle parent;
+            TitleId title;
+        };
+
+        std::unordered_map<Handle, Element> elements;
+        std::unordered_map<Handle, std::vector<Handle>> children;
+
+        size_t EstimateMemoryUsage() const;
+    };
+
+    explicit TreeHistory(size_t memoryLimit = 128 * 1024 * 1024);
+
+    void RecordAdd(std::uint64_t timeMs,
+                   Handle handle,
+                   Handle parent,
+                   std::uint32_t childIndex,
+                   std::wstring_view title);
+    void RecordRemove(std::uint64_t timeMs, Handle handle);
+    void Clear();
+
+    // Returns nullopt if the time is before the oldest retained checkpoint.
+    std::optional<TreeState> Reconstruct(std::uint64_t timeMs) const;
+
+    std::optional<std::uint64_t> OldestTime() const;
+    // Valid for the titles of a reconstructed state until the next mutation is
+    // recorded.
+    const std::wstring& Title(TitleId id) const { return m_titles[id].text; }
+    size_t MemoryUsage() const { return m_memoryUsage; }
+
+   private:
+    struct Mutation {
+        std::uint64_t timeMs;
+        Handle handle;
+        Handle parent;
+        std::uint32_t childIndex;
+        TitleId title;
+        bool add;
+    };
+
+    struct InternedTitle {
+        std::wstring text;
+        // Checkpoint elements, add mutations and elements of m_current.
+        size_t references;
+    };
+
+    struct Segment {
+        std::uint64_t startTimeMs;
+        TreeState checkpoint;
+        size_t checkpointMemoryUsage;
+        std::vector<Mutation> mutations;
+    };
+
+    static void Apply(TreeState& state, const Mutation& mutation);
+
+    TitleId InternTitle(std::wstring_view title);
+    void AddTitleReference(TitleId id);
+    void ReleaseTitle(TitleId id);
+    static size_t TitleMemoryUsage(const InternedTitle& title);
+    void Record(const Mutation& mutation);
+    void StartSegment(std::uint64_t timeMs);
+    void EnforceMemoryLimit();
+
+    size_t m_memoryLimit;
+    size_t m_memoryUsage = 0;
+
+    TreeState m_current;
+    std::deque<Segment> m_segments;
+
+    // A deque keeps the strings in place, the views in m_titleIds refer to
+    // them. The ids of dropped titles are reused.
+    std::deque<InternedTitle> m_titles;
+    std::vector<TitleId> m_freeTitleIds;
+    std::unordered_map<std::wstring_view, TitleId> m_titleIds;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "lru_cache.h"
+
+// Caches the instances created from a type name and a value string, such as
+// with IVisualTreeService::CreateInstance, so that setting the same value on
+// many elements reuses one instance. An entry keeps its object alive, which
+// keeps its handle valid.
+//
+// Instances of mutable types, which might be modified through one element
+// while being shared with others, can be excluded by type name.
+template <typename ObjectRef>
+class ValueInstanceCache {
+   public:
+    using Handle = std::uint64_t;
+
+    struct Entry {
+        Handle handle;
+        ObjectRef object;
+    };
+
+    explicit ValueInstanceCache(size_t memoryLimit = 256 * 1024)
+        : m_cache(memoryLimit) {}
+
+    // Returns nullptr for a miss or an excluded type.
+    const Entry* Find(std::wstring_view type, std::wstring_view value) {
+        if (IsExcluded(type)) {
+            return nullptr;
+        }
+
+        if (const Entry* entry = m_cache.Get(MakeKey(type, value))) {
+            m_hits++;
+            return entry;
+        }
+
+        m_misses++;
+        return nullptr;
+    }
+
+    // Does nothing for an excluded type.
+    void Put(std::wstring_view type, std::wstring_view value, Entry entry) {
+        if (IsExcluded(type)) {
+            return;
+        }
+
+        std::wstring key = MakeKey(type, value);
+        size_t cost = key.size() * sizeof(wchar_t) + kEntryOverhead;
+        m_cache.Put(std::move(key), std::move(entry), cost);
+    }
+
+    // E.g. if the handle turned out to be no longer valid.
+    void Invalidate(std::wstring_view type, std::wstring_view value) {
+        m_cache.Erase(MakeKey(type, value));
+    }
+
+    bool IsExcluded(std::wstring_view type) const {
+        return m_excludedTypes.find(type) != m_excludedTypes.end();
+    }
+
+    // Excluding a type releases its cached instances.
+    void SetExcluded(std::wstring_view type, bool excluded) {
+        if (!excluded) {
+            if (auto it = m_excludedTypes.find(type);
+                it != m_excludedTypes.end()) {
+                m_excludedTypes.erase(it);
+            }
+
+            return;
+        }
+
+        m_excludedTypes.emplace(type);
+
+        std::wstring prefix = MakeKey(type, {});
+        m_cache.EraseIf([&prefix](const std::wstring& key, const Entry&) {
+            return key.starts_with(prefix);
+        });
+    }
+
+    void Clear() { m_cache.Clear(); }
+
+    size_t Size() const { return m_cache.Size(); }
+    size_t MemoryUsage() const { return m_cache.Cost(); }
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+
+   private:
+    // A rough estimate of the list and map nodes, and of the object itself.
+    static constexpr size_t kEntryOverhead = 256;
+
+    // Type names can't contain a null character, so the key is unambiguous.
+    static std::wstring MakeKey(std::wstring_view type,
+                                std::wstring_view value) {
+        std::wstring key;
+        key.reserve(type.size() + 1 + value.size());
+        key += type;
+        key += L'\0';
+        key += value;
+        return key;
+    }
+
+    // Allows lookups by std::wstring_view without allocating a key.
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view s) const {
+            return std::hash<std::wstring_view>{}(s);
+        }
+    };
+
+    LruCache<std::wstring, Entry> m_cache;
+    std::unordered_set<std::wstring, Hash, std::equal_to<>> m_excludedTypes;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+};
@@ -221,9 +221,17 @@ HRESULT VisualTreeWatcher::OnVisualTreeChange(
     return S_OK;
 }
 
-HRESULT VisualTreeWatcher::OnElementStateChanged(InstanceHandle,
+HRESULT VisualTreeWatcher::OnElementStateChanged(InstanceHandle element,
                                                  VisualElementState,
-                                                 LPCWSTR) noexcept {
+                                                 LPCWSTR) noexcept try {
+    auto* dlgMain = DlgMainForCurrentThread();
+    if (dlgMain) {
+        dlgMain->ElementStateChanged(element);
+    }
+
+    return S_OK;
+} catch (...) {
+    ATLASSERT(FALSE);
     return S_OK;
 }
 
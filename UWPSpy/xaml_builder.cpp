@@ -0,0 +1,166 @@
+#include "stdafx.h"
+
+#include "xaml_builder.h"
+
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+#define XAML_BUILDER_X86 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define XAML_BUILDER_X86 0
+#endif
+
+namespace {
+
+// The vector path operates on UTF-16 code units.
+constexpr bool kVectorizable = sizeof(wchar_t) == 2;
+
+// https://stackoverflow.com/a/5665377
+// Apostrophes aren't escaped, attributes are always double-quoted.
+std::wstring_view EscapeSequence(wchar_t c) {
+    switch (c) {
+        case L'&':
+            return L"&amp;";
+        case L'"':
+            return L"&quot;";
+        case L'<':
+            return L"&lt;";
+        case L'>':
+            return L"&gt;";
+    }
+
+    return {};
+}
+
+size_t FindSpecialScalar(const wchar_t* data, size_t start, size_t size) {
+    for (size_t i = start; i < size; i++) {
+        wchar_t c = data[i];
+        if (c == L'&' || c == L'"' || c == L'<' || c == L'>') {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+#if XAML_BUILDER_X86
+
+unsigned CountTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+size_t FindSpecialSse2(const wchar_t* data, size_t start, size_t size) {
+    const __m128i amp = _mm_set1_epi16('&');
+    const __m128i quot = _mm_set1_epi16('"');
+    const __m128i lt = _mm_set1_epi16('<');
+    const __m128i gt = _mm_set1_epi16('>');
+
+    size_t i = start;
+    for (; i + 8 <= size; i += 8) {
+        const __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i special =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(block, amp),
+                                      _mm_cmpeq_epi16(block, quot)),
+                         _mm_or_si128(_mm_cmpeq_epi16(block, lt),
+                                      _mm_cmpeq_epi16(block, gt)));
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask) {
+            // Two mask bits per 16-bit lane.
+            return i + CountTrailingZeros(mask) / 2;
+        }
+    }
+
+    return FindSpecialScalar(data, i, size);
+}
+
+#endif  // XAML_BUILDER_X86
+
+// Returns the index of the first character at or after start which needs
+// escaping, or size if there's none.
+size_t FindSpecial(const wchar_t* data, size_t start, size_t size) {
+#if XAML_BUILDER_X86
+    if constexpr (kVectorizable) {
+        return FindSpecialSse2(data, start, size);
+    }
+#endif
+
+    return FindSpecialScalar(data, start, size);
+}
+
+}  // namespace
+
+size_t EscapedXmlAttributeLength(std::wstring_view data) {
+    size_t length = data.size();
+    for (size_t pos = FindSpecial(data.data(), 0, data.size());
+         pos < data.size();
+         pos = FindSpecial(data.data(), pos + 1, data.size())) {
+        length += EscapeSequence(data[pos]).size() - 1;
+    }
+
+    return length;
+}
+
+void AppendEscapedXmlAttribute(std::wstring& buffer, std::wstring_view data) {
+    size_t runStart = 0;
+    while (runStart < data.size()) {
+        size_t pos = FindSpecial(data.data(), runStart, data.size());
+        buffer.append(data.data() + runStart, pos - runStart);
+        if (pos == data.size()) {
+            break;
+        }
+
+        buffer += EscapeSequence(data[pos]);
+        runStart = pos + 1;
+    }
+}
+
+std::wstring EscapeXmlAttribute(std::wstring_view data) {
+    std::wstring buffer;
+    buffer.reserve(EscapedXmlAttributeLength(data));
+    AppendEscapedXmlAttribute(buffer, data);
+    return buffer;
+}
+
+XamlBuilder& XamlBuilder::Add(std::wstring_view text, bool escape) {
+    if (m_count == m_parts.size()) {
+        throw std::length_error("Too many XAML parts");
+    }
+
+    m_parts[m_count++] = {.text = text, .escape = escape};
+    return *this;
+}
+
+std::wstring XamlBuilder::Build() const {
+    size_t length = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        const Part& part = m_parts[i];
+        length += part.escape ? EscapedXmlAttributeLength(part.text)
+                              : part.text.size();
+    }
+
+    std::wstring xaml;
+    xaml.reserve(length);
+    for (size_t i = 0; i < m_count; i++) {
+        const Part& part = m_parts[i];
+        if (part.escape) {
+            AppendEscapedXmlAttribute(xaml, part.text);
+        } else {
+            xaml += part.text;
+        }
+    }
+
+    return xaml;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+// Escapes text for use in a double-quoted XML attribute. Runs of characters
+// which don't need escaping are found with SSE2 and copied as a whole.
+size_t EscapedXmlAttributeLength(std::wstring_view data);
+void AppendEscapedXmlAttribute(std::wstring& buffer, std::wstring_view data);
+std::wstring EscapeXmlAttribute(std::wstring_view data);
+
+// Builds a XAML document from text parts and attribute values to escape. The
+// length of the document is computed before it's assembled, so that it's
+// allocated once. The parts aren't copied, they must stay valid until Build
+// is called.
+class XamlBuilder {
+   public:
+    XamlBuilder& Text(std::wstring_view text) {
+        return Add(text, /*escape=*/false);
+    }
+
+    XamlBuilder& Attribute(std::wstring_view value) {
+        return Add(value, /*escape=*/true);
+    }
+
+    std::wstring Build() const;
+
+   private:
+    // Enough for the documents built in this app, more parts are a bug.
+    static constexpr size_t kMaxParts = 32;
+
+    struct Part {
+        std::wstring_view text;
+        bool escape;
+    };
+
+    XamlBuilder& Add(std::wstring_view text, bool escape);
+
+    std::array<Part, kMaxParts> m_parts;
+    size_t m_count = 0;
+};
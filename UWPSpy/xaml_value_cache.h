@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "lru_cache.h"
+
+// Caches the values parsed from the XAML of a style setter, so that setting
+// the same XAML again, e.g. while iterating on a template or a gradient, skips
+// the parser. The parsed value depends on the target class and the property,
+// so they're part of the key along with the text. A cached value is set on
+// every element it's used for, so the caller only puts values which can be
+// shared between elements.
+template <typename ObjectRef>
+class XamlValueCache {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit XamlValueCache(size_t memoryLimit = 4 * 1024 * 1024)
+        : m_cache(memoryLimit) {}
+
+    // Returns nullptr if not found. The pointer is valid until the cache is
+    // modified.
+    const ObjectRef* Find(int kind,
+                          std::wstring_view className,
+                          std::wstring_view property,
+                          std::wstring_view xaml) {
+        if (const ObjectRef* value =
+                m_cache.Get(MakeKey(kind, className, property, xaml))) {
+            m_hits++;
+            return value;
+        }
+
+        m_misses++;
+        return nullptr;
+    }
+
+    void Put(int kind,
+             std::wstring_view className,
+             std::wstring_view property,
+             std::wstring_view xaml,
+             ObjectRef value) {
+        std::wstring key = MakeKey(kind, className, property, xaml);
+        // The parsed object is assumed to be about as large as its text.
+        size_t cost = key.size() * sizeof(wchar_t) + xaml.size() * 2 +
+                      kEntryOverhead;
+        m_cache.Put(std::move(key), std::move(value), cost);
+    }
+
+    void Clear() { m_cache.Clear(); }
+
+    void RecordParse(Clock::duration duration) {
+        m_parses++;
+        m_parseTime += duration;
+    }
+
+    size_t Size() const { return m_cache.Size(); }
+    size_t MemoryUsage() const { return m_cache.Cost(); }
+    std::uint64_t Hits() const { return m_hits; }
+    std::uint64_t Misses() const { return m_misses; }
+    std::uint64_t Parses() const { return m_parses; }
+    Clock::duration ParseTime() const { return m_parseTime; }
+
+   private:
+    static constexpr size_t kEntryOverhead = 256;
+
+    // Class and property names can't contain a null character, so the key is
+    // unambiguous.
+    static std::wstring MakeKey(int kind,
+                                std::wstring_view className,
+                                std::wstring_view property,
+                                std::wstring_view xaml) {
+        std::wstring key;
+        key.reserve(1 + className.size() + 1 + property.size() + 1 +
+                    xaml.size());
+        key += static_cast<wchar_t>(L'0' + kind);
+        key += className;
+        key += L'\0';
+        key += property;
+        key += L'\0';
+        key += xaml;
+        return key;
+    }
+
+    LruCache<std::wstring, ObjectRef> m_cache;
+    std::uint64_t m_hits = 0;
+    std::uint64_t m_misses = 0;
+    std::uint64_t m_parses = 0;
+    Clock::duration m_parseTime{};
+};
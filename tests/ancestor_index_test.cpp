@@ -0,0 +1,198 @@
+#include "ancestor_index.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+
+#include "test.h"
+
+namespace {
+
+using Handle = AncestorIndex::Handle;
+
+// The element tree as the dialog keeps it: each element with the parent it
+// was inserted with, which might not be inserted yet. Queries walk the parent
+// chain.
+class NaiveTree {
+   public:
+    void Insert(Handle handle, Handle parent) { m_parents[handle] = parent; }
+    void Remove(Handle handle) { m_parents.erase(handle); }
+
+    bool Contains(Handle handle) const { return m_parents.contains(handle); }
+
+    // The handle and its inserted ancestors, from the handle up.
+    std::vector<Handle> Path(Handle handle) const {
+        std::vector<Handle> path;
+        for (auto it = m_parents.find(handle); it != m_parents.end();
+             it = m_parents.find(it->second)) {
+            path.push_back(it->first);
+        }
+
+        return path;
+    }
+
+    bool IsAttached(Handle handle) const {
+        auto path = Path(handle);
+        return !path.empty() && m_parents.at(path.back()) == 0;
+    }
+
+    Handle LowestCommonAncestor(Handle a, Handle b) const {
+        auto aPath = Path(a);
+        auto bPath = Path(b);
+        if (aPath.empty() || bPath.empty() || aPath.back() != bPath.back()) {
+            return 0;
+        }
+
+        std::set<Handle> aAncestors(aPath.begin(), aPath.end());
+        for (Handle handle : bPath) {
+            if (aAncestors.contains(handle)) {
+                return handle;
+            }
+        }
+
+        return 0;
+    }
+
+   private:
+    std::map<Handle, Handle> m_parents;
+};
+
+// Compares every query of the index with the naive tree. Pairs of handles are
+// sampled for the pairwise queries.
+void CheckMatches(const AncestorIndex& index,
+                  const NaiveTree& tree,
+                  Handle maxHandle,
+                  std::mt19937& random) {
+    std::uniform_int_distribution<Handle> randomHandle(1, maxHandle);
+
+    for (Handle handle = 1; handle <= maxHandle; handle++) {
+        CHECK_EQ(index.Contains(handle), tree.Contains(handle));
+
+        auto path = tree.Path(handle);
+        if (path.empty()) {
+            CHECK_EQ(index.Root(handle), Handle{0});
+            CHECK(!index.Depth(handle));
+            continue;
+        }
+
+        auto depth = static_cast<std::uint32_t>(path.size() - 1);
+        CHECK_EQ(index.Root(handle), path.back());
+        CHECK_EQ(index.IsAttached(handle), tree.IsAttached(handle));
+        CHECK(index.Depth(handle) == depth);
+
+        std::uint32_t queriedDepth =
+            std::uniform_int_distribution<std::uint32_t>(0, depth)(random);
+        CHECK_EQ(index.AncestorAtDepth(handle, queriedDepth),
+                 path[depth - queriedDepth]);
+        CHECK_EQ(index.AncestorAtDepth(handle, depth + 1), Handle{0});
+
+        Handle other = randomHandle(random);
+        auto otherPath = tree.Path(other);
+        bool isAncestor = std::find(otherPath.begin(), otherPath.end(),
+                                    handle) != otherPath.end();
+        CHECK_EQ(index.IsAncestor(handle, other), isAncestor);
+        CHECK_EQ(index.LowestCommonAncestor(handle, other),
+                 tree.LowestCommonAncestor(handle, other));
+
+        // Also test against an ancestor, which exercises the jump pointers
+        // more than unrelated elements do.
+        Handle ancestor = path[path.size() / 2];
+        CHECK(index.IsAncestor(ancestor, handle));
+        CHECK_EQ(index.IsAncestor(handle, ancestor), ancestor == handle);
+        CHECK_EQ(index.LowestCommonAncestor(handle, ancestor), ancestor);
+    }
+}
+
+TEST(ChildrenInsertedBeforeTheirParentAreAttached) {
+    AncestorIndex index;
+    index.Insert(3, 2);
+    index.Insert(4, 3);
+    CHECK_EQ(index.Root(4), Handle{3});
+    CHECK(!index.IsAttached(4));
+    CHECK(index.Depth(4) == 1u);
+
+    index.Insert(1, 0);
+    index.Insert(2, 1);
+    CHECK_EQ(index.Root(4), Handle{1});
+    CHECK(index.IsAttached(4));
+    CHECK(index.Depth(4) == 3u);
+    CHECK(index.IsAncestor(1, 4));
+    CHECK_EQ(index.LowestCommonAncestor(4, 2), Handle{2});
+}
+
+TEST(RemovedElementsDetachTheirChildren) {
+    AncestorIndex index;
+    index.Insert(1, 0);
+    index.Insert(2, 1);
+    index.Insert(3, 2);
+
+    index.Remove(2);
+    CHECK(!index.Contains(2));
+    CHECK_EQ(index.Root(3), Handle{3});
+    CHECK(!index.IsAttached(3));
+    CHECK(!index.IsAncestor(1, 3));
+    CHECK_EQ(index.LowestCommonAncestor(1, 3), Handle{0});
+
+    // Reinserting the element under another parent moves the children too.
+    index.Insert(5, 0);
+    index.Insert(2, 5);
+    CHECK_EQ(index.Root(3), Handle{5});
+    CHECK(index.IsAttached(3));
+    CHECK(index.Depth(3) == 2u);
+}
+
+TEST(DeepChainsUseJumpPointers) {
+    constexpr Handle kDepth = 10000;
+
+    AncestorIndex index;
+    for (Handle handle = 1; handle <= kDepth; handle++) {
+        index.Insert(handle, handle - 1);
+    }
+
+    CHECK_EQ(index.Root(kDepth), Handle{1});
+    CHECK(index.Depth(kDepth) == kDepth - 1);
+    CHECK_EQ(index.AncestorAtDepth(kDepth, 1234), Handle{1235});
+    CHECK(index.IsAncestor(2, kDepth));
+    CHECK_EQ(index.LowestCommonAncestor(kDepth, 5000), Handle{5000});
+}
+
+TEST(RandomInsertsAndRemovesMatchParentWalk) {
+    constexpr Handle kMaxHandle = 150;
+    constexpr int kSteps = 3000;
+
+    std::mt19937 random(27);
+    std::uniform_int_distribution<Handle> randomHandle(1, kMaxHandle);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    AncestorIndex index;
+    NaiveTree tree;
+
+    for (int step = 0; step < kSteps; step++) {
+        Handle handle = randomHandle(random);
+        int action = percent(random);
+        if (action < 65) {
+            // A parent with a slightly lower handle keeps the tree acyclic
+            // and deep. The parent might not be inserted yet.
+            Handle parent = 0;
+            if (handle > 1 && percent(random) >= 10) {
+                parent = std::uniform_int_distribution<Handle>(
+                    handle > 8 ? handle - 8 : 1, handle - 1)(random);
+            }
+
+            index.Insert(handle, parent);
+            tree.Insert(handle, parent);
+        } else {
+            index.Remove(handle);
+            tree.Remove(handle);
+        }
+
+        if (step % 10 == 0) {
+            CheckMatches(index, tree, kMaxHandle, random);
+        }
+    }
+
+    CheckMatches(index, tree, kMaxHandle, random);
+}
+
+}  // namespace
@@ -0,0 +1,205 @@
+#include "edit_batch.h"
+
+#include "fake_tree_service.h"
+#include "test.h"
+
+namespace {
+
+using Handle = EditBatch::Handle;
+using PropertyValue = EditBatch::PropertyValue;
+
+PropertyValue LocalValue(const std::wstring& value) {
+    return {.local = true, .type = L"String", .value = value};
+}
+
+TEST(AppliesAllEdits) {
+    FakeTreeService service;
+    Handle original = service.SetInitialValue(2, 7, L"original");
+
+    EditBatch batch;
+    batch.Add(
+        {.elements = {1, 2}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {3}, .propertyIndex = 7, .value = {}});
+    CHECK_EQ(batch.Operations().size(), size_t{2});
+    CHECK_EQ(batch.EditCount(), size_t{3});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status >= 0);
+    CHECK(!result.rolledBack);
+    CHECK_EQ(result.edits.size(), size_t{3});
+    CHECK(!result.edits[0].before.local);
+    CHECK_EQ(result.edits[1].before.valueHandle, original);
+
+    Handle value = service.LocalValue(1, 7);
+    CHECK(value != 0);
+    CHECK_EQ(service.LocalValue(2, 7), value);
+    CHECK_EQ(service.LocalValue(3, 7), Handle{0});
+}
+
+TEST(FailureMidBatchRollsBack) {
+    FakeTreeService service;
+    Handle original = service.SetInitialValue(1, 7, L"original");
+    service.failSet = {3};
+
+    EditBatch batch;
+    batch.Add({.elements = {1, 2, 3, 4},
+               .propertyIndex = 7,
+               .value = LocalValue(L"a")});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status < 0);
+    CHECK_EQ(result.failedElement, Handle{3});
+    CHECK(result.rolledBack);
+    CHECK(result.edits.empty());
+    CHECK_EQ(result.rollbackFailures, size_t{0});
+
+    // The edited elements are restored, the element after the failure wasn't
+    // touched.
+    CHECK_EQ(service.LocalValue(1, 7), original);
+    CHECK_EQ(service.LocalValue(2, 7), Handle{0});
+    CHECK_EQ(service.LocalValue(4, 7), Handle{0});
+}
+
+TEST(FailureMidBatchAcrossOperations) {
+    FakeTreeService service;
+    service.failSet = {9};
+
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {1}, .propertyIndex = 8, .value = LocalValue(L"b")});
+    batch.Add({.elements = {9}, .propertyIndex = 7, .value = LocalValue(L"c")});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status < 0);
+    CHECK_EQ(result.failedElement, Handle{9});
+    CHECK(result.rolledBack);
+    CHECK_EQ(service.LocalValue(1, 7), Handle{0});
+    CHECK_EQ(service.LocalValue(1, 8), Handle{0});
+}
+
+TEST(SameElementEditedTwiceRollsBackToOriginal) {
+    FakeTreeService service;
+    Handle original = service.SetInitialValue(1, 7, L"original");
+    service.failSet = {2};
+
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"b")});
+    batch.Add({.elements = {2}, .propertyIndex = 7, .value = LocalValue(L"c")});
+    CHECK_EQ(batch.Operations().size(), size_t{3});
+
+    auto result = batch.Apply(service);
+    CHECK(result.rolledBack);
+    CHECK_EQ(result.rollbackFailures, size_t{0});
+    CHECK_EQ(service.LocalValue(1, 7), original);
+}
+
+TEST(SameElementEditedTwiceRecordsBothEdits) {
+    FakeTreeService service;
+
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"b")});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status >= 0);
+    CHECK_EQ(result.edits.size(), size_t{2});
+    CHECK(!result.edits[0].before.local);
+    // The second edit replaced the value of the first one.
+    CHECK(result.edits[1].before.local);
+    CHECK(result.edits[1].before.valueHandle != 0);
+
+    const auto* value = service.FindValue(service.LocalValue(1, 7));
+    CHECK(value && value->value == L"b");
+}
+
+TEST(RollbackFailuresAreCounted) {
+    FakeTreeService service;
+    service.failSet = {3};
+    service.failClear = {1, 2};
+
+    EditBatch batch;
+    batch.Add(
+        {.elements = {1, 2, 3}, .propertyIndex = 7, .value = LocalValue(L"a")});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status < 0);
+    CHECK(result.rolledBack);
+    CHECK_EQ(result.rollbackFailures, size_t{2});
+}
+
+TEST(RollbackFailuresOnlyCountFailedRestores) {
+    FakeTreeService service;
+    service.SetInitialValue(2, 7, L"original");
+    service.failSet = {3};
+    service.failClear = {1};
+
+    EditBatch batch;
+    batch.Add(
+        {.elements = {1, 2, 3}, .propertyIndex = 7, .value = LocalValue(L"a")});
+
+    // Element 2 is restored with SetValue, element 1 with a failing
+    // ClearValue.
+    auto result = batch.Apply(service);
+    CHECK(result.rolledBack);
+    CHECK_EQ(result.rollbackFailures, size_t{1});
+    CHECK(service.LocalValue(1, 7) != 0);
+}
+
+TEST(EqualValuesAreCreatedOnce) {
+    FakeTreeService service;
+
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {2}, .propertyIndex = 8, .value = LocalValue(L"a")});
+    batch.Add({.elements = {3}, .propertyIndex = 9, .value = LocalValue(L"a")});
+    batch.Add({.elements = {4}, .propertyIndex = 7, .value = LocalValue(L"b")});
+    CHECK_EQ(batch.Operations().size(), size_t{4});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status >= 0);
+    CHECK_EQ(result.valuesCreated, size_t{2});
+    CHECK_EQ(service.createCalls, size_t{2});
+    CHECK_EQ(service.LocalValue(1, 7), service.LocalValue(2, 8));
+    CHECK_EQ(service.LocalValue(1, 7), service.LocalValue(3, 9));
+    CHECK(service.LocalValue(1, 7) != service.LocalValue(4, 7));
+}
+
+TEST(ValuesWithDifferentTypesAreNotShared) {
+    FakeTreeService service;
+
+    PropertyValue number = LocalValue(L"1");
+    number.type = L"Double";
+
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"1")});
+    batch.Add({.elements = {2}, .propertyIndex = 8, .value = number});
+
+    auto result = batch.Apply(service);
+    CHECK_EQ(result.valuesCreated, size_t{2});
+    CHECK(service.LocalValue(1, 7) != service.LocalValue(2, 8));
+}
+
+TEST(ExistingValueHandlesAreNotCreated) {
+    FakeTreeService service;
+    Handle existing = service.SetInitialValue(1, 7, L"shared");
+    size_t createCalls = service.createCalls;
+
+    EditBatch batch;
+    batch.Add({.elements = {2, 3},
+               .propertyIndex = 7,
+               .value = {
+                   .local = true,
+                   .valueHandle = existing,
+                   .type = L"",
+                   .value = L"",
+               }});
+
+    auto result = batch.Apply(service);
+    CHECK(result.status >= 0);
+    CHECK_EQ(result.valuesCreated, size_t{0});
+    CHECK_EQ(service.createCalls, createCalls);
+    CHECK_EQ(service.LocalValue(3, 7), existing);
+}
+
+}  // namespace
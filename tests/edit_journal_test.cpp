@@ -0,0 +1,254 @@
+#include "edit_journal.h"
+
+#include "fake_tree_service.h"
+#include "test.h"
+
+namespace {
+
+using Handle = EditBatch::Handle;
+using Edit = EditBatch::Edit;
+using PropertyValue = EditBatch::PropertyValue;
+
+PropertyValue LocalValue(const std::wstring& value) {
+    return {.local = true, .type = L"String", .value = value};
+}
+
+// An existing value, such as the value of another property.
+PropertyValue ExistingValue(Handle valueHandle) {
+    PropertyValue value;
+    value.local = true;
+    value.valueHandle = valueHandle;
+    return value;
+}
+
+Edit MakeEdit(Handle element,
+              std::uint32_t propertyIndex,
+              PropertyValue before,
+              PropertyValue after) {
+    return {
+        .element = element,
+        .propertyIndex = propertyIndex,
+        .before = std::move(before),
+        .after = std::move(after),
+    };
+}
+
+// Applies the batch and checks that it succeeded.
+void Apply(const EditBatch& batch, FakeTreeService& service) {
+    auto result = batch.Apply(service);
+    CHECK(result.status >= 0);
+}
+
+std::wstring ValueOf(const FakeTreeService& service,
+                     Handle element,
+                     std::uint32_t propertyIndex) {
+    const auto* value =
+        service.FindValue(service.LocalValue(element, propertyIndex));
+    return value ? value->value : L"(cleared)";
+}
+
+TEST(UndoRestoresValuesInReverseOrder) {
+    FakeTreeService service;
+    EditJournal journal;
+
+    // A step which edits the same property twice, the way an edit batch
+    // records it.
+    EditBatch batch;
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"a")});
+    batch.Add({.elements = {2}, .propertyIndex = 7, .value = LocalValue(L"x")});
+    batch.Add({.elements = {1}, .propertyIndex = 7, .value = LocalValue(L"b")});
+    auto result = batch.Apply(service);
+    CHECK_EQ(result.edits.size(), size_t{3});
+    journal.Record({.description = L"Edit", .edits = std::move(result.edits)});
+    CHECK_EQ(ValueOf(service, 1, 7), L"b");
+
+    CHECK(journal.CanUndo());
+    CHECK(!journal.CanRedo());
+    EditBatch undo = journal.UndoBatch();
+    CHECK_EQ(undo.EditCount(), size_t{3});
+    // The last edit is undone first.
+    CHECK_EQ(undo.Operations().front().elements.front(), Handle{1});
+    CHECK(undo.Operations().front().value.local);
+
+    Apply(undo, service);
+    journal.Undone();
+    CHECK_EQ(ValueOf(service, 1, 7), L"(cleared)");
+    CHECK_EQ(ValueOf(service, 2, 7), L"(cleared)");
+    CHECK(!journal.CanUndo());
+    CHECK(journal.CanRedo());
+
+    // Redoing applies the edits in their original order, so the last value
+    // wins.
+    Apply(journal.RedoBatch(), service);
+    journal.Redone();
+    CHECK_EQ(ValueOf(service, 1, 7), L"b");
+    CHECK_EQ(ValueOf(service, 2, 7), L"x");
+    CHECK(journal.CanUndo());
+    CHECK(!journal.CanRedo());
+}
+
+TEST(UndoAndRedoMoveWholeSteps) {
+    EditJournal journal;
+    journal.Record({.description = L"First",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"a"))}});
+    journal.Record({.description = L"Second",
+                    .edits = {MakeEdit(2, 7, {}, LocalValue(L"b")),
+                              MakeEdit(3, 7, {}, LocalValue(L"b"))}});
+
+    CHECK_EQ(journal.NextUndo().description, L"Second");
+    journal.Undone();
+    CHECK_EQ(journal.NextUndo().description, L"First");
+    CHECK_EQ(journal.NextRedo().description, L"Second");
+    CHECK_EQ(journal.NextRedo().edits.size(), size_t{2});
+
+    // A new step clears the redo steps.
+    journal.Record({.description = L"Third",
+                    .edits = {MakeEdit(4, 7, {}, LocalValue(L"c"))}});
+    CHECK(!journal.CanRedo());
+    CHECK_EQ(journal.NextUndo().description, L"Third");
+}
+
+TEST(EmptyStepsAreNotRecorded) {
+    EditJournal journal;
+    journal.Record({.description = L"Nothing", .edits = {}});
+    CHECK(!journal.CanUndo());
+}
+
+TEST(RevertBatchUsesEarliestBeforeValue) {
+    EditJournal journal;
+    journal.Record({.description = L"First",
+                    .edits = {MakeEdit(1, 7, LocalValue(L"original"),
+                                       LocalValue(L"a"))}});
+    journal.Record(
+        {.description = L"Second",
+         .edits = {MakeEdit(1, 7, LocalValue(L"a"), LocalValue(L"b")),
+                   MakeEdit(2, 7, {}, LocalValue(L"c"))}});
+    journal.Record({.description = L"Third",
+                    .edits = {MakeEdit(1, 8, {}, LocalValue(L"d")),
+                              MakeEdit(1, 7, LocalValue(L"b"),
+                                       LocalValue(L"e"))}});
+
+    EditBatch batch = journal.RevertBatch([](Handle) { return true; });
+    const auto& operations = batch.Operations();
+    CHECK_EQ(batch.EditCount(), size_t{3});
+    CHECK_EQ(operations.size(), size_t{3});
+    if (operations.size() == 3) {
+        CHECK_EQ(operations[0].elements, std::vector<Handle>{1});
+        CHECK_EQ(operations[0].propertyIndex, std::uint32_t{7});
+        CHECK(operations[0].value == LocalValue(L"original"));
+        CHECK_EQ(operations[1].elements, std::vector<Handle>{2});
+        CHECK(!operations[1].value.local);
+        CHECK_EQ(operations[2].elements, std::vector<Handle>{1});
+        CHECK_EQ(operations[2].propertyIndex, std::uint32_t{8});
+        CHECK(!operations[2].value.local);
+    }
+
+    // Only the elements matching the predicate are reverted.
+    batch = journal.RevertBatch([](Handle element) { return element == 2; });
+    CHECK_EQ(batch.EditCount(), size_t{1});
+    CHECK_EQ(batch.Operations().front().elements, std::vector<Handle>{2});
+}
+
+TEST(RevertBatchIgnoresUndoneSteps) {
+    EditJournal journal;
+    journal.Record({.description = L"First",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"a"))}});
+    journal.Record(
+        {.description = L"Second",
+         .edits = {MakeEdit(1, 7, LocalValue(L"a"), LocalValue(L"b"))}});
+    journal.Undone();
+    journal.Undone();
+
+    EditBatch batch = journal.RevertBatch([](Handle) { return true; });
+    CHECK(batch.Empty());
+}
+
+TEST(RemoveElementDropsEmptiedSteps) {
+    EditJournal journal;
+    journal.Record({.description = L"Only 1",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"a"))}});
+    journal.Record({.description = L"1 and 2",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"b")),
+                              MakeEdit(2, 7, {}, LocalValue(L"c"))}});
+    journal.Record({.description = L"Only 3",
+                    .edits = {MakeEdit(3, 7, {}, LocalValue(L"d"))}});
+    journal.Undone();
+
+    journal.RemoveElement(1);
+    CHECK_EQ(journal.NextUndo().description, L"1 and 2");
+    CHECK_EQ(journal.NextUndo().edits.size(), size_t{1});
+    CHECK_EQ(journal.NextUndo().edits.front().element, Handle{2});
+    journal.Undone();
+    CHECK(!journal.CanUndo());
+
+    // Redo steps are dropped too.
+    journal.RemoveElement(3);
+    CHECK_EQ(journal.NextRedo().description, L"1 and 2");
+    journal.RemoveElement(2);
+    CHECK(!journal.CanRedo());
+}
+
+TEST(TrimmingKeepsEditCountsConsistent) {
+    EditJournal journal(/*maxSteps=*/2);
+    journal.Record({.description = L"1",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"a"))}});
+    journal.Record({.description = L"1 again",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"b"))}});
+    // Trims the first step, element 1 still has an edit.
+    journal.Record({.description = L"2",
+                    .edits = {MakeEdit(2, 7, {}, LocalValue(L"c"))}});
+
+    journal.RemoveElement(1);
+    CHECK_EQ(journal.NextUndo().description, L"2");
+    journal.Undone();
+    CHECK(!journal.CanUndo());
+    journal.Redone();
+
+    // Trims the step of element 2, whose count drops to zero. A new edit of
+    // the element is counted from scratch.
+    journal.Record({.description = L"3",
+                    .edits = {MakeEdit(3, 7, {}, LocalValue(L"d"))}});
+    journal.Record({.description = L"2 again",
+                    .edits = {MakeEdit(2, 7, {}, LocalValue(L"e"))}});
+    CHECK_EQ(journal.NextUndo().description, L"2 again");
+
+    journal.RemoveElement(2);
+    CHECK_EQ(journal.NextUndo().description, L"3");
+    journal.Undone();
+    CHECK(!journal.CanUndo());
+}
+
+TEST(ClearingRedoKeepsEditCountsConsistent) {
+    EditJournal journal;
+    journal.Record({.description = L"1",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"a"))}});
+    journal.Record({.description = L"1 again",
+                    .edits = {MakeEdit(1, 7, {}, LocalValue(L"b"))}});
+    journal.Undone();
+
+    // Drops the redo step, the first step of element 1 stays.
+    journal.Record({.description = L"2",
+                    .edits = {MakeEdit(2, 7, {}, LocalValue(L"c"))}});
+
+    journal.RemoveElement(1);
+    CHECK_EQ(journal.NextUndo().description, L"2");
+    journal.Undone();
+    CHECK(!journal.CanUndo());
+}
+
+TEST(ForEachValueHandleVisitsBothStacks) {
+    EditJournal journal;
+    journal.Record(
+        {.description = L"1",
+         .edits = {MakeEdit(1, 7, ExistingValue(10), ExistingValue(11))}});
+    journal.Record({.description = L"2",
+                    .edits = {MakeEdit(2, 7, {}, LocalValue(L"a"))}});
+    journal.Undone();
+
+    std::vector<Handle> handles;
+    journal.ForEachValueHandle(
+        [&handles](Handle valueHandle) { handles.push_back(valueHandle); });
+    CHECK_EQ(handles, (std::vector<Handle>{10, 11}));
+}
+
+}  // namespace
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "edit_batch.h"
+
+// Keeps the local values of element properties in memory, like the tree
+// service of the dialog. Calls can be made to fail per element.
+class FakeTreeService {
+   public:
+    using Handle = EditBatch::Handle;
+    using PropertyValue = EditBatch::PropertyValue;
+    using Status = EditBatch::Status;
+
+    static constexpr Status kFailed = -1;
+
+    struct Value {
+        std::wstring type;
+        std::wstring value;
+    };
+
+    Status CreateValue(const std::wstring& type,
+                       const std::wstring& value,
+                       Handle* valueHandle) {
+        *valueHandle = m_nextValueHandle++;
+        m_values[*valueHandle] = {type, value};
+        createCalls++;
+        return 0;
+    }
+
+    Status GetPreviousValue(Handle element,
+                            std::uint32_t propertyIndex,
+                            PropertyValue* previous) {
+        *previous = {};
+        if (auto it = m_local.find({element, propertyIndex});
+            it != m_local.end()) {
+            previous->local = true;
+            previous->valueHandle = it->second;
+        }
+
+        return 0;
+    }
+
+    Status SetValue(Handle element,
+                    std::uint32_t propertyIndex,
+                    Handle valueHandle) {
+        if (failSet.contains(element) || !m_values.contains(valueHandle)) {
+            return kFailed;
+        }
+
+        m_local[{element, propertyIndex}] = valueHandle;
+        return 0;
+    }
+
+    Status ClearValue(Handle element, std::uint32_t propertyIndex) {
+        if (failClear.contains(element)) {
+            return kFailed;
+        }
+
+        m_local.erase({element, propertyIndex});
+        return 0;
+    }
+
+    // The value which was set directly, without a batch.
+    Handle SetInitialValue(Handle element,
+                           std::uint32_t propertyIndex,
+                           const std::wstring& value) {
+        Handle valueHandle;
+        CreateValue(L"String", value, &valueHandle);
+        m_local[{element, propertyIndex}] = valueHandle;
+        return valueHandle;
+    }
+
+    // The local value handle, or zero if not set.
+    Handle LocalValue(Handle element, std::uint32_t propertyIndex) const {
+        auto it = m_local.find({element, propertyIndex});
+        return it != m_local.end() ? it->second : 0;
+    }
+
+    const Value* FindValue(Handle valueHandle) const {
+        auto it = m_values.find(valueHandle);
+        return it != m_values.end() ? &it->second : nullptr;
+    }
+
+    std::set<Handle> failSet;
+    std::set<Handle> failClear;
+    size_t createCalls = 0;
+
+   private:
+    Handle m_nextValueHandle = 1000;
+    std::map<Handle, Value> m_values;
+    std::map<std::pair<Handle, std::uint32_t>, Handle> m_local;
+};
@@ -0,0 +1,105 @@
+#include "metadata_cache.h"
+
+#include <cstring>
+
+#include "test.h"
+
+namespace {
+
+// Files are memory-mapped, which aligns them. A copy in 64-bit words has the
+// same alignment.
+class AlignedFile {
+   public:
+    explicit AlignedFile(const std::vector<char>& file)
+        : m_words((file.size() + 7) / 8), m_size(file.size()) {
+        std::memcpy(m_words.data(), file.data(), file.size());
+    }
+
+    const void* Data() const { return m_words.data(); }
+    size_t Size() const { return m_size; }
+
+   private:
+    std::vector<std::uint64_t> m_words;
+    size_t m_size;
+};
+
+TEST(LoadsSerializedKinds) {
+    MetadataCache cache;
+    cache.PutObjectKind(L"Windows.UI.Xaml.Controls.Grid", 2);
+    cache.PutObjectKind(L"Windows.UI.Xaml.Controls.TextBlock", 2);
+    cache.PutObjectKind(L"Microsoft.UI.Xaml.Window", 6);
+    cache.PutObjectKind(L"", 1);
+    CHECK(cache.Modified());
+
+    AlignedFile file(cache.Serialize(L"app|1"));
+
+    MetadataCache loaded;
+    CHECK(loaded.Load(file.Data(), file.Size(), L"app|1"));
+    CHECK(!loaded.Modified());
+    CHECK_EQ(loaded.LoadedObjectKinds(), size_t{3});
+    CHECK(loaded.FindObjectKind(L"Windows.UI.Xaml.Controls.Grid") == 2);
+    CHECK(loaded.FindObjectKind(L"Microsoft.UI.Xaml.Window") == 6);
+    CHECK(!loaded.FindObjectKind(L"Windows.UI.Xaml.Controls.Border"));
+    CHECK(!loaded.FindObjectKind(L""));
+    CHECK_EQ(loaded.Hits(), std::uint64_t{2});
+    CHECK_EQ(loaded.Misses(), std::uint64_t{2});
+}
+
+TEST(RejectsOtherKeysAndTruncatedFiles) {
+    MetadataCache cache;
+    cache.PutObjectKind(L"Grid", 2);
+    auto data = cache.Serialize(L"app|1");
+
+    MetadataCache loaded;
+    AlignedFile file(data);
+    CHECK(!loaded.Load(file.Data(), file.Size(), L"app|2"));
+    CHECK(!loaded.FindObjectKind(L"Grid"));
+
+    data.pop_back();
+    AlignedFile truncated(data);
+    CHECK(!loaded.Load(truncated.Data(), truncated.Size(), L"app|1"));
+    CHECK(!loaded.Load(file.Data(), 8, L"app|1"));
+}
+
+TEST(MergesSessionChangesWithLoadedKinds) {
+    MetadataCache cache;
+    cache.PutObjectKind(L"Grid", 2);
+    cache.PutObjectKind(L"Border", 2);
+    cache.PutObjectKind(L"Stale", 1);
+    AlignedFile file(cache.Serialize(L"app|1"));
+
+    MetadataCache loaded;
+    CHECK(loaded.Load(file.Data(), file.Size(), L"app|1"));
+    loaded.EraseObjectKind(L"Stale");
+    loaded.PutObjectKind(L"Border", 4);
+    loaded.PutObjectKind(L"Window", 5);
+    CHECK(!loaded.FindObjectKind(L"Stale"));
+    CHECK_EQ(loaded.StaleEntries(), std::uint64_t{1});
+
+    AlignedFile merged(loaded.Serialize(L"app|1"));
+    loaded.Unload();
+
+    MetadataCache reloaded;
+    CHECK(reloaded.Load(merged.Data(), merged.Size(), L"app|1"));
+    CHECK_EQ(reloaded.LoadedObjectKinds(), size_t{3});
+    CHECK(reloaded.FindObjectKind(L"Grid") == 2);
+    CHECK(reloaded.FindObjectKind(L"Border") == 4);
+    CHECK(reloaded.FindObjectKind(L"Window") == 5);
+    CHECK(!reloaded.FindObjectKind(L"Stale"));
+}
+
+TEST(ReservedBytesAreZero) {
+    MetadataCache cache;
+    cache.PutObjectKind(L"Grid", 2);
+    auto data = cache.Serialize(L"app|1");
+
+    // The last field of the 32-byte header, and of the 24-byte record.
+    CHECK(data.size() > 56);
+    for (size_t offset : {28, 52}) {
+        std::uint32_t reserved;
+        std::memcpy(&reserved, data.data() + offset, sizeof(reserved));
+        CHECK_EQ(reserved, std::uint32_t{0});
+    }
+}
+
+}  // namespace
@@ -0,0 +1,94 @@
+#include "property_chain.h"
+
+#include <functional>
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+using ChainPtr = PropertyChainCache::ChainPtr;
+
+ChainPtr MakeChain(std::wstring_view value) {
+    auto chain = std::make_shared<PropertyChain>();
+    chain->AddText(value);
+    return chain;
+}
+
+// Loads a new chain on each call, and counts the calls.
+struct Loader {
+    int loads = 0;
+
+    ChainPtr operator()() {
+        loads++;
+        return MakeChain(L"Value " + std::to_wstring(loads));
+    }
+};
+
+TEST(EntriesExpire) {
+    PropertyChainCache cache(/*memoryLimit=*/1024 * 1024, /*maxAgeMs=*/100);
+    Loader loader;
+
+    auto chain = cache.Get(1, 1000, std::ref(loader));
+    CHECK_EQ(loader.loads, 1);
+    CHECK(cache.Get(1, 1100, std::ref(loader)) == chain);
+    CHECK(cache.Peek(1, 1100) == chain);
+    CHECK(cache.Contains(1, 1100));
+    CHECK_EQ(loader.loads, 1);
+
+    // Stale entries aren't returned by any of the lookups, and a reload
+    // restarts the age.
+    CHECK(!cache.Peek(1, 1101));
+    CHECK(!cache.Contains(1, 1101));
+    auto reloaded = cache.Get(1, 1101, std::ref(loader));
+    CHECK_EQ(loader.loads, 2);
+    CHECK(reloaded != chain);
+    CHECK(cache.Peek(1, 1201) == reloaded);
+
+    CHECK_EQ(cache.Hits(), std::uint64_t{1});
+    CHECK_EQ(cache.Misses(), std::uint64_t{2});
+}
+
+TEST(PutReplacesAndRestartsAge) {
+    PropertyChainCache cache(/*memoryLimit=*/1024 * 1024, /*maxAgeMs=*/100);
+    Loader loader;
+
+    cache.Get(1, 0, std::ref(loader));
+    auto fetched = MakeChain(L"Fetched");
+    cache.Put(1, fetched, 90);
+    CHECK(cache.Get(1, 150, std::ref(loader)) == fetched);
+    CHECK_EQ(loader.loads, 1);
+}
+
+TEST(InvalidationAndErrors) {
+    PropertyChainCache cache;
+    Loader loader;
+
+    for (PropertyChainCache::Handle handle = 1; handle <= 4; handle++) {
+        cache.Get(handle, 0, std::ref(loader));
+    }
+
+    cache.Invalidate(1);
+    cache.InvalidateIf(
+        [](PropertyChainCache::Handle handle) { return handle % 2 == 0; });
+    CHECK(!cache.Contains(1, 0));
+    CHECK(!cache.Contains(2, 0));
+    CHECK(cache.Contains(3, 0));
+    CHECK(!cache.Contains(4, 0));
+
+    cache.Clear();
+    CHECK(!cache.Contains(3, 0));
+    CHECK_EQ(cache.MemoryUsage(), size_t{0});
+
+    // Errors aren't cached, the next lookup retries.
+    int failures = 0;
+    auto fail = [&failures] {
+        failures++;
+        return ChainPtr();
+    };
+    CHECK(!cache.Get(5, 0, fail));
+    CHECK(!cache.Get(5, 0, fail));
+    CHECK_EQ(failures, 2);
+}
+
+}  // namespace
@@ -0,0 +1,119 @@
+#include "property_export.h"
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+// A chain with a single value, whose text is in the Value column.
+PropertyExporter::ChainPtr MakeChain(std::wstring_view value) {
+    auto chain = std::make_shared<PropertyChain>();
+    chain->AddSource({
+        .handle = 0,
+        .targetType = chain->AddText(L""),
+        .name = chain->AddText(L""),
+        .source = 1,
+    });
+    chain->AddValue({
+        .index = 7,
+        .sourceIndex = 0,
+        .type = chain->AddText(L"String"),
+        .declaringType = chain->AddText(L"TextBlock"),
+        .valueType = chain->AddText(L"String"),
+        .itemType = chain->AddText(L""),
+        .value = chain->AddText(value),
+        .propertyName = chain->AddText(L"Text"),
+        .metadataBits = 0,
+        .overridden = false,
+    });
+    return chain;
+}
+
+// Exports the elements as CSV and returns the rows without the header.
+std::string ExportCsv(std::vector<PropertyExporter::Element> elements,
+                      unsigned threadCount,
+                      size_t batchSize) {
+    std::string output;
+    PropertyExporter exporter(
+        PropertyExporter::Format::Csv,
+        [&output](const char* data, size_t size) {
+            output.append(data, size);
+            return true;
+        },
+        [](std::int32_t) { return std::wstring(L"Local"); }, threadCount,
+        batchSize);
+    for (auto& element : elements) {
+        exporter.Add(std::move(element));
+    }
+
+    CHECK(exporter.Finish());
+    return output.substr(output.find("\r\n") + 2);
+}
+
+std::string ExportValue(std::wstring_view value) {
+    std::vector<PropertyExporter::Element> elements;
+    elements.push_back({
+        .handle = 1,
+        .parentHandle = 0,
+        .typeName = L"TextBlock",
+        .chain = MakeChain(value),
+    });
+    return ExportCsv(std::move(elements), 1, 1);
+}
+
+std::string ExpectedRow(std::uint64_t handle, std::string_view value) {
+    return std::to_string(handle) + ",0,TextBlock,7,Text," +
+           std::string(value) + ",String,TextBlock,String,,0,0,Local,,\r\n";
+}
+
+TEST(CsvEncodesUtf8) {
+    CHECK_EQ(ExportValue(L"abc"), ExpectedRow(1, "abc"));
+    CHECK_EQ(ExportValue(L"\u00E9\u20AC"),
+             ExpectedRow(1, "\xC3\xA9\xE2\x82\xAC"));
+    CHECK_EQ(ExportValue(L"a,\"b\""), ExpectedRow(1, "\"a,\"\"b\"\"\""));
+
+    // A surrogate pair, as in UTF-16 strings.
+    std::wstring pair{static_cast<wchar_t>(0xD83D),
+                      static_cast<wchar_t>(0xDE00)};
+    CHECK_EQ(ExportValue(pair), ExpectedRow(1, "\xF0\x9F\x98\x80"));
+}
+
+TEST(CsvReplacesLoneSurrogates) {
+    constexpr std::string_view kReplacement = "\xEF\xBF\xBD";
+
+    std::wstring high{L'a', static_cast<wchar_t>(0xD83D), L'b'};
+    CHECK_EQ(ExportValue(high),
+             ExpectedRow(1, "a" + std::string(kReplacement) + "b"));
+
+    std::wstring low{static_cast<wchar_t>(0xDE00)};
+    CHECK_EQ(ExportValue(low), ExpectedRow(1, kReplacement));
+
+    // A high surrogate at the end of the text, and two high surrogates.
+    std::wstring trailing{static_cast<wchar_t>(0xD83D),
+                          static_cast<wchar_t>(0xD83D)};
+    CHECK_EQ(ExportValue(trailing),
+             ExpectedRow(1, std::string(kReplacement) +
+                                std::string(kReplacement)));
+}
+
+TEST(RowsAreWrittenInOrder) {
+    constexpr std::uint64_t kElementCount = 500;
+
+    auto chain = MakeChain(L"value");
+    std::vector<PropertyExporter::Element> elements;
+    std::string expected;
+    for (std::uint64_t handle = 1; handle <= kElementCount; handle++) {
+        elements.push_back({
+            .handle = handle,
+            .parentHandle = 0,
+            .typeName = L"TextBlock",
+            .chain = chain,
+        });
+        expected += ExpectedRow(handle, "value");
+    }
+
+    CHECK_EQ(ExportCsv(std::move(elements), 4, 3), expected);
+}
+
+}  // namespace
@@ -0,0 +1,220 @@
+#include "property_store.h"
+
+#include <map>
+#include <random>
+
+#include "test.h"
+
+namespace {
+
+using Handle = PropertyStore::Handle;
+using GroupBy = PropertyStore::GroupBy;
+using ValueOp = PropertyStore::ValueOp;
+
+struct Value {
+    std::wstring property;
+    std::wstring value;
+    std::wstring styleName;
+    std::int32_t source;
+};
+
+struct Element {
+    std::wstring typeName;
+    std::vector<Value> values;
+};
+
+PropertyChain MakeChain(const std::vector<Value>& values) {
+    PropertyChain chain;
+    for (std::uint32_t i = 0; i < values.size(); i++) {
+        chain.AddSource({
+            .handle = 0,
+            .targetType = chain.AddText(L""),
+            .name = chain.AddText(values[i].styleName),
+            .source = values[i].source,
+        });
+        chain.AddValue({
+            .index = i,
+            .sourceIndex = i,
+            .type = chain.AddText(L""),
+            .declaringType = chain.AddText(L""),
+            .valueType = chain.AddText(L""),
+            .itemType = chain.AddText(L""),
+            .value = chain.AddText(values[i].value),
+            .propertyName = chain.AddText(values[i].property),
+            .metadataBits = 0,
+            .overridden = false,
+        });
+    }
+
+    return chain;
+}
+
+// The group keys and counts, ordered for comparison. Sources are keyed by
+// their number.
+using Groups = std::map<std::wstring, size_t>;
+
+Groups StoreGroups(const PropertyStore::QueryResult& result,
+                   GroupBy groupBy) {
+    Groups groups;
+    for (const auto& group : result.groups) {
+        auto key = groupBy == GroupBy::Source ? std::to_wstring(group.source)
+                                              : group.key;
+        CHECK(groups.emplace(key, group.count).second);
+    }
+
+    return groups;
+}
+
+Groups NaiveGroups(const std::map<Handle, Element>& elements,
+                   const PropertyStore::Query& query) {
+    Groups groups;
+    for (const auto& [handle, element] : elements) {
+        if (!query.typeName.empty() && element.typeName != query.typeName) {
+            continue;
+        }
+
+        for (const auto& value : element.values) {
+            if (value.property != query.propertyName) {
+                continue;
+            }
+
+            bool matches = true;
+            switch (query.valueOp) {
+                case ValueOp::Any:
+                    break;
+                case ValueOp::Equals:
+                    matches = value.value == query.value;
+                    break;
+                case ValueOp::NotEquals:
+                    matches = value.value != query.value;
+                    break;
+                case ValueOp::Contains:
+                    matches = value.value.find(query.value) != value.value.npos;
+                    break;
+            }
+
+            if (!matches) {
+                continue;
+            }
+
+            switch (query.groupBy) {
+                case GroupBy::Value:
+                    groups[value.value]++;
+                    break;
+                case GroupBy::Source:
+                    groups[std::to_wstring(value.source)]++;
+                    break;
+                case GroupBy::StyleName:
+                    groups[value.styleName]++;
+                    break;
+                case GroupBy::Type:
+                    groups[element.typeName]++;
+                    break;
+            }
+        }
+    }
+
+    return groups;
+}
+
+TEST(GroupsBySourceNumber) {
+    PropertyStore store;
+    store.Put(1, L"Grid", MakeChain({{L"Width", L"10", L"", 5}}));
+    store.Put(2, L"Grid", MakeChain({{L"Width", L"20", L"", 5}}));
+    store.Put(3, L"Grid", MakeChain({{L"Width", L"10", L"", -1}}));
+
+    auto result = store.Run({
+        .typeName = L"",
+        .propertyName = L"Width",
+        .valueOp = ValueOp::Any,
+        .value = L"",
+        .groupBy = GroupBy::Source,
+    });
+    CHECK_EQ(result.groups.size(), size_t{2});
+    if (result.groups.size() == 2) {
+        CHECK_EQ(result.groups[0].source, 5);
+        CHECK_EQ(result.groups[0].count, size_t{2});
+        CHECK(result.groups[0].key.empty());
+        CHECK_EQ(result.groups[1].source, -1);
+        CHECK_EQ(result.groups[1].firstHandle, Handle{3});
+    }
+
+    result = store.Run({
+        .typeName = L"",
+        .propertyName = L"Width",
+        .valueOp = ValueOp::Any,
+        .value = L"",
+        .groupBy = GroupBy::Value,
+    });
+    CHECK_EQ(result.groups.front().key, L"10");
+    CHECK_EQ(result.groups.front().source, -1);
+}
+
+// Elements are replaced with new values over and over, which compacts the
+// store many times. Queries must match a scan of the current elements.
+TEST(RandomChurnMatchesElementScan) {
+    std::mt19937 random(40);
+    auto below = [&random](size_t bound) {
+        return std::uniform_int_distribution<size_t>(0, bound - 1)(random);
+    };
+
+    const std::wstring kProperties[] = {L"Width", L"Height", L"Text"};
+    const std::wstring kTypes[] = {L"Grid", L"Button", L"TextBlock"};
+
+    PropertyStore store;
+    std::map<Handle, Element> elements;
+
+    for (int step = 0; step < 30000; step++) {
+        Handle handle = 1 + below(200);
+        if (below(10) == 0) {
+            store.Erase(handle);
+            elements.erase(handle);
+        } else {
+            // Strings which are never seen again, and so have to be dropped
+            // from the dictionaries, in each column.
+            auto unique = [&] { return L"Unique" + std::to_wstring(step); };
+
+            Element element{
+                .typeName = below(20) ? kTypes[below(3)] : unique(),
+                .values = {},
+            };
+            for (const auto& property : kProperties) {
+                if (below(4) == 0) {
+                    continue;
+                }
+
+                element.values.push_back({
+                    .property = property,
+                    .value = below(3) ? unique() : std::to_wstring(below(5)),
+                    .styleName = below(10)
+                                     ? L"Style" + std::to_wstring(below(3))
+                                     : unique(),
+                    .source = static_cast<std::int32_t>(below(12)) - 1,
+                });
+            }
+
+            store.Put(handle, element.typeName, MakeChain(element.values));
+            elements[handle] = std::move(element);
+        }
+
+        if (step % 500 != 0) {
+            continue;
+        }
+
+        CHECK_EQ(store.ElementCount(), elements.size());
+
+        for (int i = 0; i < 8; i++) {
+            PropertyStore::Query query{
+                .typeName = below(2) ? L"" : kTypes[below(3)],
+                .propertyName = kProperties[below(3)],
+                .valueOp = static_cast<ValueOp>(below(4)),
+                .value = std::to_wstring(below(5)),
+                .groupBy = static_cast<GroupBy>(below(4)),
+            };
+            CHECK(StoreGroups(store.Run(query), query.groupBy) ==
+                  NaiveGroups(elements, query));
+        }
+    }
+}
+
+}  // namespace
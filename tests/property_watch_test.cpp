@@ -0,0 +1,125 @@
+#include "property_watch.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "test.h"
+
+namespace {
+
+using Handle = PropertyWatchEngine::Handle;
+using Key = std::pair<Handle, std::uint32_t>;
+
+// Samples every watch, so that the cursor of the current round is visible in
+// the order of the sampled keys.
+std::vector<Key> SampleAll(PropertyWatchEngine& engine) {
+    std::vector<Key> sampled;
+    engine.Step(
+        0,
+        [&sampled](const PropertyWatchEngine::Watch& watch) {
+            sampled.emplace_back(watch.handle, watch.propertyIndex);
+            return std::optional<std::wstring>();
+        },
+        [] { return false; });
+    return sampled;
+}
+
+TEST(FindLocatesPinnedWatches) {
+    PropertyWatchEngine engine;
+    CHECK(engine.Pin(2, 5, L"Width", 0));
+    CHECK(engine.Pin(1, 7, L"Height", 1));
+    CHECK(engine.Pin(2, 3, L"Opacity", 2));
+    CHECK(!engine.Pin(2, 5, L"Width", 0));
+
+    const auto* watch = engine.Find(2, 3);
+    CHECK(watch && watch->propertyName == L"Opacity");
+    CHECK(engine.Find(1, 7) && engine.Find(1, 7)->accessor == 1);
+    CHECK(!engine.Find(1, 5));
+    CHECK(!engine.Find(3, 0));
+
+    CHECK(engine.Unpin(2, 3));
+    CHECK(!engine.Unpin(2, 3));
+    CHECK(!engine.Find(2, 3));
+    CHECK_EQ(engine.Count(), size_t{2});
+}
+
+// Pins and unpins watches in the middle of a round, and checks that the rest
+// of the round continues where the sampling stopped.
+TEST(RandomPinsKeepRoundPosition) {
+    std::mt19937 random(38);
+    auto below = [&random](unsigned bound) {
+        return std::uniform_int_distribution<unsigned>(0, bound - 1)(random);
+    };
+
+    PropertyWatchEngine engine;
+    std::set<Key> pinned;
+
+    for (int i = 0; i < 2000; i++) {
+        // Sample part of a round, each round starts at the first watch.
+        std::vector<Key> sampled;
+        unsigned budget = below(4);
+        auto step = engine.Step(
+            0,
+            [&sampled](const PropertyWatchEngine::Watch& watch) {
+                sampled.emplace_back(watch.handle, watch.propertyIndex);
+                return std::optional<std::wstring>();
+            },
+            [&budget] { return budget-- == 0; });
+
+        // Watches pinned or unpinned during the round might be sampled or
+        // not, every other watch must be sampled exactly once per round.
+        std::set<Key> changed;
+        for (int j = 0; j < 3; j++) {
+            Key key(1 + below(8), below(4));
+            unsigned action = below(3);
+            if (action == 0) {
+                CHECK_EQ(engine.Pin(key.first, key.second, L"", 0),
+                         pinned.insert(key).second);
+                changed.insert(key);
+            } else if (action == 1) {
+                CHECK_EQ(engine.Unpin(key.first, key.second),
+                         pinned.erase(key) > 0);
+                changed.insert(key);
+            } else {
+                engine.UnpinElement(key.first);
+                std::erase_if(pinned, [&](const Key& watch) {
+                    if (watch.first != key.first) {
+                        return false;
+                    }
+
+                    changed.insert(watch);
+                    return true;
+                });
+            }
+        }
+
+        CHECK_EQ(engine.Count(), pinned.size());
+        for (Handle handle = 1; handle <= 8; handle++) {
+            for (std::uint32_t index = 0; index < 4; index++) {
+                CHECK_EQ(engine.Find(handle, index) != nullptr,
+                         pinned.contains({handle, index}));
+            }
+        }
+
+        auto rest = SampleAll(engine);
+        std::set<Key> restKeys(rest.begin(), rest.end());
+        CHECK_EQ(restKeys.size(), rest.size());
+        for (const auto& key : rest) {
+            CHECK(pinned.contains(key));
+        }
+
+        for (const auto& key : pinned) {
+            if (changed.contains(key)) {
+                continue;
+            }
+
+            bool sampledBefore = !step.roundComplete &&
+                                 std::find(sampled.begin(), sampled.end(),
+                                           key) != sampled.end();
+            CHECK(sampledBefore != restKeys.contains(key));
+        }
+    }
+}
+
+}  // namespace
@@ -0,0 +1,111 @@
+#include "row_diff.h"
+
+#include <random>
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+struct Row {
+    int key;
+    std::wstring content;
+};
+
+RowDiff Diff(const std::vector<Row>& oldRows, const std::vector<Row>& newRows) {
+    return DiffRows(
+        oldRows.size(), newRows.size(),
+        [&](size_t oldIndex, size_t newIndex) {
+            return oldRows[oldIndex].key == newRows[newIndex].key;
+        },
+        [&](size_t oldIndex, size_t newIndex) {
+            CHECK_EQ(oldRows[oldIndex].key, newRows[newIndex].key);
+            return oldRows[oldIndex].content == newRows[newIndex].content;
+        });
+}
+
+TEST(ReplacedRowDoesNotShiftTheRest) {
+    std::vector<Row> oldRows{{1, L"a"}, {2, L"b"}, {3, L"c"}, {4, L"d"}};
+    std::vector<Row> newRows{{1, L"a"}, {5, L"b"}, {3, L"c"}, {4, L"x"}};
+
+    auto diff = Diff(oldRows, newRows);
+    CHECK(!diff.LayoutChanged());
+    CHECK_EQ(diff.changedRows, (std::vector<size_t>{1, 3}));
+}
+
+TEST(InsertedRowShiftsTheRest) {
+    std::vector<Row> oldRows{{1, L"a"}, {2, L"b"}, {3, L"c"}};
+    std::vector<Row> newRows{{1, L"x"}, {2, L"b"}, {4, L"d"}, {3, L"c"}};
+
+    auto diff = Diff(oldRows, newRows);
+    CHECK(diff.LayoutChanged());
+    CHECK_EQ(diff.layoutChangedAt, size_t{2});
+    CHECK_EQ(diff.changedRows, std::vector<size_t>{0});
+}
+
+// Applying the diff to the displayed rows, the way the list redraws them,
+// must show the new rows.
+TEST(RandomEditsRedrawEveryDifferentRow) {
+    std::mt19937 random(36);
+    auto below = [&random](int bound) {
+        return std::uniform_int_distribution<int>(0, bound - 1)(random);
+    };
+
+    std::vector<Row> rows;
+    for (int i = 0; i < 20; i++) {
+        rows.push_back({i, std::to_wstring(i)});
+    }
+
+    for (int step = 0; step < 5000; step++) {
+        std::vector<Row> newRows = rows;
+        for (int edit = below(3); edit >= 0; edit--) {
+            int action = below(4);
+            size_t position = below(static_cast<int>(newRows.size()) + 1);
+            if (action == 0 || newRows.empty()) {
+                newRows.insert(newRows.begin() + position,
+                               {100 + step, std::to_wstring(below(5))});
+            } else if (position == newRows.size()) {
+                newRows.pop_back();
+            } else if (action == 1) {
+                newRows.erase(newRows.begin() + position);
+            } else if (action == 2) {
+                newRows[position].key = 100 + step;
+            } else {
+                newRows[position].content = std::to_wstring(below(5));
+            }
+        }
+
+        auto diff = Diff(rows, newRows);
+        CHECK_EQ(diff.LayoutChanged(), rows.size() != newRows.size());
+
+        // The displayed rows, with redrawn rows taken from the new rows.
+        std::vector<Row> shown = rows;
+        shown.resize(newRows.size());
+        for (size_t i : diff.changedRows) {
+            CHECK(i < diff.layoutChangedAt);
+            shown[i] = newRows[i];
+        }
+
+        for (size_t i = diff.layoutChangedAt; i < newRows.size(); i++) {
+            shown[i] = newRows[i];
+        }
+
+        for (size_t i = 0; i < newRows.size(); i++) {
+            CHECK(shown[i].key == newRows[i].key &&
+                  shown[i].content == newRows[i].content);
+        }
+
+        // Rows which show the same key and contents aren't redrawn.
+        for (size_t i : diff.changedRows) {
+            CHECK(rows[i].key != newRows[i].key ||
+                  rows[i].content != newRows[i].content);
+        }
+
+        rows = std::move(newRows);
+        if (rows.size() > 40) {
+            rows.resize(20);
+        }
+    }
+}
+
+}  // namespace
@@ -0,0 +1,15 @@
+#pragma once
+
+// Replaces UWPSpy/stdafx.h for the portable modules, see CMakeLists.txt. Only
+// the standard library part of the original is included.
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// A minimal test runner. A failed check reports the expression and the test
+// continues, the test executable fails if any check failed.
+//
+// TEST(Name) {
+//     CHECK(condition);
+//     CHECK_EQ(actual, expected);
+// }
+
+namespace test {
+
+struct TestCase {
+    const char* name;
+    void (*func)();
+};
+
+std::vector<TestCase>& Registry();
+void ReportFailure(const char* file, int line, const char* expression);
+
+struct Registrar {
+    Registrar(const char* name, void (*func)()) {
+        Registry().push_back({name, func});
+    }
+};
+
+}  // namespace test
+
+#define TEST(name)                                          \
+    static void name();                                     \
+    static test::Registrar name##Registrar(#name, &(name)); \
+    static void name()
+
+#define CHECK(expression)                                        \
+    do {                                                         \
+        if (!(expression)) {                                     \
+            test::ReportFailure(__FILE__, __LINE__, #expression); \
+        }                                                        \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) CHECK((actual) == (expected))
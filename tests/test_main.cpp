@@ -0,0 +1,34 @@
+#include "test.h"
+
+namespace {
+
+int g_failures = 0;
+
+}  // namespace
+
+namespace test {
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void ReportFailure(const char* file, int line, const char* expression) {
+    std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+    g_failures++;
+}
+
+}  // namespace test
+
+int main() {
+    for (const auto& testCase : test::Registry()) {
+        int failuresBefore = g_failures;
+        testCase.func();
+        bool passed = g_failures == failuresBefore;
+        std::printf("%s %s\n", passed ? "[ OK ]" : "[FAIL]", testCase.name);
+    }
+
+    std::printf("%zu tests, %d failed checks\n", test::Registry().size(),
+                g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#include "text_search.h"
+
+#include <random>
+#include <string>
+
+#include "attribute_filter_index.h"
+#include "test.h"
+
+namespace {
+
+using TextSearch::Utf16::Path;
+
+// Letters of both cases, including non-ASCII ones and the Kelvin sign, which
+// folds into ASCII with towlower.
+constexpr char16_t kAlphabet[] =
+    u"aAbBkKzZ09 _-\u00E9\u00C9\u00DF\u03A9\u03C9\u212A";
+
+std::u16string FoldCase(std::u16string_view text) {
+    std::u16string folded;
+    for (char16_t c : text) {
+        folded += static_cast<char16_t>(
+            TextSearch::FoldChar(static_cast<wchar_t>(c)));
+    }
+
+    return folded;
+}
+
+std::wstring ToWide(std::u16string_view text) {
+    return std::wstring(text.begin(), text.end());
+}
+
+// The reference: fold both sides and compare at each position.
+bool NaiveContains(std::u16string_view haystack,
+                   std::u16string_view foldedNeedle) {
+    return FoldCase(haystack).find(foldedNeedle) != std::u16string::npos;
+}
+
+bool NaiveStartsWith(std::u16string_view haystack,
+                     std::u16string_view foldedNeedle) {
+    return FoldCase(haystack).starts_with(foldedNeedle);
+}
+
+class RandomText {
+   public:
+    explicit RandomText(unsigned seed) : m_random(seed) {}
+
+    std::u16string Text(size_t maxLength) {
+        std::u16string text(Below(maxLength + 1), u'\0');
+        for (auto& c : text) {
+            c = kAlphabet[Below(std::size(kAlphabet) - 1)];
+        }
+
+        return text;
+    }
+
+    // Mostly a part of the haystack with changed case, so that there are
+    // matches at all positions, sometimes random text.
+    std::u16string Needle(std::u16string_view haystack) {
+        if (haystack.empty() || Below(4) == 0) {
+            return FoldCase(Text(6));
+        }
+
+        size_t start = Below(haystack.size());
+        size_t maxLength = std::min<size_t>(haystack.size() - start, 40);
+        size_t length = 1 + Below(maxLength);
+        std::u16string needle(haystack.substr(start, length));
+        if (Below(3) == 0) {
+            needle[Below(needle.size())] = kAlphabet[Below(4)];
+        }
+
+        return FoldCase(needle);
+    }
+
+    size_t Below(size_t bound) {
+        return std::uniform_int_distribution<size_t>(0, bound - 1)(m_random);
+    }
+
+   private:
+    std::mt19937 m_random;
+};
+
+std::vector<Path> SupportedPaths() {
+    std::vector<Path> paths;
+    for (Path path : {Path::Scalar, Path::Sse2, Path::Avx2}) {
+        if (TextSearch::Utf16::IsSupported(path)) {
+            paths.push_back(path);
+        }
+    }
+
+    return paths;
+}
+
+TEST(VectorPathsMatchScalarPath) {
+    RandomText random(29);
+    auto paths = SupportedPaths();
+    std::printf("Checking %zu paths\n", paths.size());
+
+    for (int i = 0; i < 20000; i++) {
+        // Long enough for several vector iterations and a scalar tail.
+        auto haystack = random.Text(i % 2 ? 16 : 100);
+        auto needle = random.Needle(haystack);
+
+        bool contains = NaiveContains(haystack, needle);
+        bool startsWith = NaiveStartsWith(haystack, needle);
+        for (Path path : paths) {
+            CHECK_EQ(TextSearch::Utf16::ContainsFolded(haystack, needle, path),
+                     contains);
+            CHECK_EQ(
+                TextSearch::Utf16::StartsWithFolded(haystack, needle, path),
+                startsWith);
+        }
+
+        // The prefix itself, which the vector prefix path compares 8
+        // characters at a time.
+        auto prefix = FoldCase(haystack.substr(0, random.Below(40)));
+        for (Path path : paths) {
+            CHECK(TextSearch::Utf16::StartsWithFolded(haystack, prefix, path));
+        }
+    }
+}
+
+TEST(MatchesAtEveryOffset) {
+    auto paths = SupportedPaths();
+
+    // A match which ends at each position, including the last one of a
+    // vector block and the scalar tail.
+    for (size_t length = 1; length <= 70; length++) {
+        for (size_t end = length; end <= 70; end++) {
+            std::u16string haystack(70, u'x');
+            for (size_t i = end - length; i < end; i++) {
+                haystack[i] = i % 2 ? u'A' : u'b';
+            }
+
+            auto needle = FoldCase(haystack.substr(end - length, length));
+            for (Path path : paths) {
+                CHECK(
+                    TextSearch::Utf16::ContainsFolded(haystack, needle, path));
+            }
+        }
+    }
+}
+
+TEST(WideFunctionsFoldCase) {
+    CHECK(TextSearch::ContainsFolded(L"TextBlock", L"block"));
+    CHECK(!TextSearch::ContainsFolded(L"TextBlock", L"blocks"));
+    CHECK(TextSearch::ContainsFolded(L"anything", L""));
+    CHECK(TextSearch::StartsWithFolded(L"TextBlock", L"text"));
+    CHECK(!TextSearch::StartsWithFolded(L"TextBlock", L"block"));
+
+    // The Kelvin sign isn't folded into the ASCII 'k'.
+    CHECK(!TextSearch::ContainsFolded(L"\u212A", L"k"));
+    CHECK_EQ(TextSearch::FoldCase(L"K\u212A"), std::wstring(L"k\u212A"));
+}
+
+TEST(PatternPrefix) {
+    using TextSearch::Pattern;
+    CHECK(Pattern(L"^But").FoundIn(L"Button"));
+    CHECK(!Pattern(L"^ton").FoundIn(L"Button"));
+    CHECK(Pattern(L"ton").FoundIn(L"Button"));
+    CHECK(Pattern(L"^").IsEmpty());
+    CHECK(!(Pattern(L"^a") == Pattern(L"a")));
+}
+
+// The filter index narrows down the previous matches as the filter text
+// grows, the result must be the same as checking every row.
+TEST(AttributeFilterMatchesEveryRowCheck) {
+    RandomText random(290);
+
+    std::vector<std::pair<std::wstring, std::wstring>> rows;
+    AttributeFilterIndex index;
+    for (int i = 0; i < 300; i++) {
+        auto name = ToWide(random.Text(12));
+        auto value = ToWide(random.Text(30));
+        index.Add(name, value);
+        rows.emplace_back(std::move(name), std::move(value));
+    }
+
+    std::wstring filter;
+    for (int i = 0; i < 3000; i++) {
+        // Typing, deleting and toggling the prefix anchor.
+        size_t action = random.Below(10);
+        if (action < 6 || filter.empty()) {
+            filter += static_cast<wchar_t>(kAlphabet[random.Below(8)]);
+        } else if (action < 9) {
+            filter.pop_back();
+        } else if (filter.front() == L'^') {
+            filter.erase(0, 1);
+        } else {
+            filter.insert(0, 1, L'^');
+        }
+
+        if (filter.size() > 4) {
+            filter.clear();
+        }
+
+        TextSearch::Pattern pattern(filter);
+        std::vector<std::uint32_t> expected;
+        for (std::uint32_t row = 0; row < rows.size(); row++) {
+            if (pattern.FoundIn(rows[row].first) ||
+                pattern.FoundIn(rows[row].second)) {
+                expected.push_back(row);
+            }
+        }
+
+        CHECK(index.Filter(pattern) == expected);
+    }
+}
+
+}  // namespace
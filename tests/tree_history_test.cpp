@@ -0,0 +1,166 @@
+#include "tree_history.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+using Handle = TreeHistory::Handle;
+
+// The tree with resolved titles, ordered for comparison.
+struct Snapshot {
+    std::map<Handle, std::pair<Handle, std::wstring>> elements;
+    std::map<Handle, std::vector<Handle>> children;
+
+    bool operator==(const Snapshot&) const = default;
+};
+
+// Applies mutations directly, the way the dialog updates its element maps.
+class NaiveTree {
+   public:
+    void Add(Handle handle,
+             Handle parent,
+             std::uint32_t childIndex,
+             const std::wstring& title) {
+        Remove(handle);
+
+        m_snapshot.elements[handle] = {parent, title};
+        auto& siblings = m_snapshot.children[parent];
+        if (parent && childIndex <= siblings.size()) {
+            siblings.insert(siblings.begin() + childIndex, handle);
+        } else {
+            siblings.push_back(handle);
+        }
+    }
+
+    void Remove(Handle handle) {
+        auto it = m_snapshot.elements.find(handle);
+        if (it == m_snapshot.elements.end()) {
+            return;
+        }
+
+        auto& siblings = m_snapshot.children[it->second.first];
+        std::erase(siblings, handle);
+        if (siblings.empty()) {
+            m_snapshot.children.erase(it->second.first);
+        }
+
+        m_snapshot.elements.erase(it);
+    }
+
+    const Snapshot& Current() const { return m_snapshot; }
+
+   private:
+    Snapshot m_snapshot;
+};
+
+Snapshot Resolve(const TreeHistory& history,
+                 const TreeHistory::TreeState& state) {
+    Snapshot snapshot;
+    for (const auto& [handle, element] : state.elements) {
+        snapshot.elements[handle] = {element.parent,
+                                     history.Title(element.title)};
+    }
+
+    for (const auto& [parent, children] : state.children) {
+        snapshot.children[parent] = children;
+    }
+
+    return snapshot;
+}
+
+TEST(ReconstructsEarlierStates) {
+    TreeHistory history;
+    history.RecordAdd(10, 1, 0, 0, L"Root");
+    history.RecordAdd(20, 2, 1, 0, L"Second");
+    history.RecordAdd(20, 3, 1, 0, L"First");
+    history.RecordRemove(30, 2);
+    history.RecordAdd(40, 3, 1, 0, L"Renamed");
+
+    CHECK(!history.Reconstruct(9));
+    CHECK(history.OldestTime() == 10u);
+
+    auto state = history.Reconstruct(20);
+    CHECK(state && state->children[1] == (std::vector<Handle>{3, 2}));
+
+    state = history.Reconstruct(35);
+    CHECK(state && state->elements.size() == 2);
+    CHECK(state && history.Title(state->elements[3].title) == L"First");
+
+    state = history.Reconstruct(40);
+    CHECK(state && history.Title(state->elements[3].title) == L"Renamed");
+}
+
+TEST(RandomMutationsMatchSnapshots) {
+    constexpr Handle kMaxHandle = 400;
+    constexpr int kSteps = 40000;
+    constexpr int kSnapshotInterval = 97;
+
+    std::mt19937 random(30);
+    auto below = [&random](size_t bound) {
+        return std::uniform_int_distribution<size_t>(0, bound - 1)(random);
+    };
+
+    // A small limit, so that segments are dropped and titles released while
+    // other segments still refer to them.
+    TreeHistory history(/*memoryLimit=*/512 * 1024);
+    NaiveTree tree;
+    std::map<std::uint64_t, Snapshot> snapshots;
+
+    std::uint64_t timeMs = 0;
+    for (int step = 0; step < kSteps; step++) {
+        // Several mutations can have the same time.
+        timeMs += below(3);
+
+        Handle handle = 1 + below(kMaxHandle);
+        if (below(100) < 60) {
+            Handle parent = below(4) == 0 ? 0 : 1 + below(kMaxHandle);
+            auto childIndex = static_cast<std::uint32_t>(below(6));
+
+            // Titles repeat between elements, and some are only used once.
+            std::wstring title =
+                below(10) == 0 ? L"Unique " + std::to_wstring(step)
+                               : L"Shared " + std::to_wstring(below(40));
+
+            history.RecordAdd(timeMs, handle, parent, childIndex, title);
+            tree.Add(handle, parent, childIndex, title);
+        } else {
+            history.RecordRemove(timeMs, handle);
+            tree.Remove(handle);
+        }
+
+        if (step % kSnapshotInterval == 0) {
+            // Mutations with the same time which follow are part of the
+            // state at that time, so the snapshot is replaced until the time
+            // changes.
+            snapshots[timeMs] = tree.Current();
+        } else if (auto it = snapshots.find(timeMs); it != snapshots.end()) {
+            it->second = tree.Current();
+        }
+    }
+
+    auto oldestTime = history.OldestTime();
+    CHECK(oldestTime && *oldestTime > 0);
+
+    size_t checked = 0;
+    for (const auto& [snapshotTime, snapshot] : snapshots) {
+        auto state = history.Reconstruct(snapshotTime);
+        if (snapshotTime < *oldestTime) {
+            CHECK(!state);
+            continue;
+        }
+
+        CHECK(state && Resolve(history, *state) == snapshot);
+        checked++;
+    }
+
+    CHECK(checked > 10);
+
+    auto state = history.Reconstruct(timeMs);
+    CHECK(state && Resolve(history, *state) == tree.Current());
+}
+
+}  // namespace